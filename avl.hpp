@@ -6,45 +6,165 @@
 #include <iostream>
 #include <cstdint>
 #include <cstddef>
+#include <vector>
+#include <utility>
+#include <new>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+
+#ifdef ADS_COMPACT_NODES
+// link to another node of the same tree (the distance to the target in units of 4 bytes, 0 is NULL)
+// all nodes of a tree live in one array, so the links stay valid when the array is moved as a whole
+template <typename T>
+class AVL_Link {
+    private:
+        int32_t delta;
+
+    public:
+        AVL_Link() : delta(0) {}
+        AVL_Link(const AVL_Link &) = delete;
+
+        AVL_Link &operator=(T *node) {
+            delta = node ? (reinterpret_cast<char *>(node) - reinterpret_cast<char *>(this)) / 4 : 0;
+            return *this;
+        }
+
+        AVL_Link &operator=(const AVL_Link &other) {
+            return *this = static_cast<T *>(other);
+        }
+
+        operator T *() const {
+            if (!delta)
+                return NULL;
+            const char *target = reinterpret_cast<const char *>(this) + 4 * (ptrdiff_t) delta;
+            return reinterpret_cast<T *>(const_cast<char *>(target));
+        }
+
+        T *operator->() const {
+            return *this;
+        }
+
+        T &operator*() const {
+            return *static_cast<T *>(*this);
+        }
+};
+#endif
 
 // encapsualte the base members that are needed for a tree structure
+// with ADS_COMPACT_NODES the children are linked by 32 bit links and there is no parent link (the tree records the
+// paths of its descents instead, see AVL::record)
 template <typename T>
 struct Node {
+    #ifdef ADS_COMPACT_NODES
+    AVL_Link<T> l;
+    AVL_Link<T> r;
+    #else
     T *p;
     T *l;
     T *r;
+    #endif
     uint8_t height;
+    #ifdef ADS_WAVL
+    uint8_t rank;   // rank for the rank balanced rebalancing (0 for leaves, the height is still kept up to date)
+    #endif
+    bool pooled;    // the node lives in a slab of the tree and is not allocated individually
+                    // (with ADS_COMPACT_NODES every node lives in the node array, only its payload is pooled)
 
     Node() {
+        #ifndef ADS_COMPACT_NODES
         p = NULL;
+        #endif
         l = NULL;
         r = NULL;
         height = 1;
+        #ifdef ADS_WAVL
+        rank = 0;
+        #endif
+        pooled = false;
     }
 
+    #ifndef ADS_COMPACT_NODES
     ~Node() {
-        delete l;
-        delete r;
+        release(l);
+        release(r);
+    }
+
+    // destroy the node (and its subtree); the memory of pooled nodes is freed together with their slab
+    static void release(T *node) {
+        if (!node)
+            return;
+        if (node->pooled)
+            node->~T();
+        else
+            delete node;
     }
+    #endif
+};
+
+// a path from the root (or the top of a subtree) down to a node
+template <typename T>
+using AVL_Path = std::vector<T *>;
+
+// work done to keep the tree balanced since the counters were last reset
+struct AVL_Stats {
+    uint64_t rotations;     // single rotations (a double rotation counts twice)
+    uint64_t visited;       // nodes whose balance was checked while walking up from a split or merge
+};
+
+// a bulk allocation of a tree (align is 0 for the default alignment)
+struct AVL_Slab {
+    void *memory;
+    size_t bytes;
+    size_t align;
+};
+
+// the nodes of a tree with ADS_COMPACT_NODES: a single array that grows by doubling, released slots are reused
+template <typename T>
+struct AVL_Arena {
+    T *nodes = NULL;
+    uint32_t capacity = 0;
+    uint32_t used = 0;                  // slots handed out so far (the released ones among them are listed in spare)
+    std::vector<uint32_t> spare;
 };
 
 // AVL tree that allows for a template node type and customizable merge/steal/rotate actions
+// with ADS_WAVL the tree is rebalanced as a weak AVL (rank balanced) tree instead
+// with ADS_COMPACT_NODES the nodes have no parent link: the descents record their path (see record) and the walks up
+// the tree look the parent up on the recorded paths; the rebalancing keeps these paths up to date
 template <typename T>
 class AVL {
     protected:
         bool is_leaf(T *);
-        void split_block(T *);
-        uint32_t node_depth(T *);
+        T *split_block(T *);
         uint32_t tree_size(T *);
 
+        T *create();
+        void release(T *);
+        void reserve(uint32_t);
+        T *parent(T *);
+        void set_parent(T *, T *);
+        void record(T *);
+        void follow(T *);
+        void follow(const AVL_Path<T> &);
+        bool trace(T *, AVL_Path<T> *);
+
         T *next_leaf(T *);
         T *prev_leaf(T *);
+        T *first_leaf(T *, AVL_Path<T> *);
+        T *next_leaf(AVL_Path<T> *);
+        T *prev_leaf(AVL_Path<T> *);
         T *merge_left(T *, T *);
         T *merge_right(T *, T *);
+        bool fix_underflow(T *, size_t, size_t);
         T *fix_tree(T *);
+        template <typename Count>
+        void propagate(T *, T *, Count);
 
         T *rotate_right(T *);
         T *rotate_left(T *);
+        T *rotate_right(T *, T *);
+        T *rotate_left(T *, T *);
         T *rotate_right_left(T *);
         T *rotate_left_right(T *);
         uint32_t height(T *);
@@ -52,6 +172,15 @@ class AVL {
         T *balance(T *);
         T *build_balanced_tree(T *, uint32_t);
 
+        #ifdef ADS_WAVL
+        T *fix_removal(T *);
+        void update_heights(T *);
+        void rank_by_height(T *);
+        #ifdef ADS_DEBUG
+        bool rank_balanced(T *);
+        #endif
+        #endif
+
         virtual void split_block_update(T *, T *, T *) = 0;
 
         virtual void steal_left(T *, T *) = 0;
@@ -61,27 +190,356 @@ class AVL {
         virtual void merge_right_pre_update(T *, T *) = 0;
         virtual void merge_post_update(T *) = 0;
 
+        // move the counters of the old top into the new top (the heights are recomputed by the rotation)
         virtual void rotate_left_update(T *) = 0;
         virtual void rotate_right_update(T *) = 0;
 
+        template <typename U>
+        U *allocate_slab(size_t, size_t = 0);
+        void free_slabs();
+
         T *root;
+        std::vector<AVL_Slab> slabs;    // bulk allocations owned by the tree
+        AVL_Stats stats;
+
+        #ifdef ADS_COMPACT_NODES
+        T *allocate_nodes(uint32_t);
+
+        AVL_Arena<T> arena;
+        AVL_Path<T> trail;              // path of the last descent (see record)
+        AVL_Path<T> side;               // path of the 'neighbour' leaf looked up last (see next_leaf)
+        size_t hint;                    // position of the node whose parent was looked up last
+        #endif
+
+    private:
+        #ifdef ADS_COMPACT_NODES
+        void grow(uint32_t);
+        size_t locate(const AVL_Path<T> &, T *);
+        void rotated(T *, T *);
+        void lift(T *, T *);
+        #endif
 
     public:
         AVL();
         ~AVL();
+        AVL(const AVL &) = delete;
+        AVL &operator=(const AVL &) = delete;
+        AVL(AVL &&);
+        AVL &operator=(AVL &&);
         uint32_t tree_size();
+        AVL_Stats rebalance_stats();
+        void reset_rebalance_stats();
+
+        #if defined(ADS_WAVL) && defined(ADS_DEBUG)
+        bool rank_balanced();
+        #endif
 };
 
 // create the root node of the tree
 template <class T>
 AVL<T>::AVL() {
-    root = new T;
+    #ifdef ADS_COMPACT_NODES
+    hint = 0;
+    #endif
+    root = create();
+    stats = {0, 0};
 }
 
 // deconstruct the full tree
 template <class T>
 AVL<T>::~AVL() {
-    delete root;
+    release(root);
+    free_slabs();
+    #ifdef ADS_COMPACT_NODES
+    ::operator delete(arena.nodes);
+    #endif
+}
+
+// take over the tree of other; other is left with an empty tree
+template <class T>
+AVL<T>::AVL(AVL &&other) : slabs(std::move(other.slabs)) {
+    root = other.root;
+    stats = other.stats;
+    #ifdef ADS_COMPACT_NODES
+    arena = std::move(other.arena);
+    trail = std::move(other.trail);
+    side = std::move(other.side);
+    hint = 0;
+    other.arena = AVL_Arena<T>();
+    other.trail.clear();
+    other.side.clear();
+    #endif
+    other.root = other.create();
+    other.slabs.clear();
+}
+
+// exchange the trees; the previous tree is released together with other
+template <class T>
+AVL<T> &AVL<T>::operator=(AVL &&other) {
+    std::swap(root, other.root);
+    std::swap(slabs, other.slabs);
+    std::swap(stats, other.stats);
+    #ifdef ADS_COMPACT_NODES
+    std::swap(arena, other.arena);
+    std::swap(trail, other.trail);
+    std::swap(side, other.side);
+    #endif
+    return *this;
+}
+
+// create a node that is released together with the tree
+// with ADS_COMPACT_NODES the node array may have to grow, which moves all nodes (see reserve)
+template <class T>
+T *AVL<T>::create() {
+    #ifdef ADS_COMPACT_NODES
+    reserve(1);
+    uint32_t slot;
+    if (arena.spare.empty()) {
+        slot = arena.used++;
+    } else {
+        slot = arena.spare.back();
+        arena.spare.pop_back();
+    }
+    return new (arena.nodes + slot) T;
+    #else
+    return new T;
+    #endif
+}
+
+// destroy the node and its subtree (with ADS_COMPACT_NODES their slots are reused by later nodes)
+template <class T>
+void AVL<T>::release(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    if (!node)
+        return;
+    release(node->l);
+    release(node->r);
+    node->~T();
+    arena.spare.push_back(node - arena.nodes);
+    #else
+    T::release(node);
+    #endif
+}
+
+// make sure that the next count nodes can be created without moving the others
+// with ADS_COMPACT_NODES growing the node array moves all nodes: the root and the recorded paths are adjusted, every
+// other node pointer (including the paths held by cursors and iterators) is invalid afterwards
+template <class T>
+void AVL<T>::reserve(uint32_t count) {
+    #ifdef ADS_COMPACT_NODES
+    uint32_t room = arena.capacity - arena.used + arena.spare.size();
+    if (room < count)
+        grow(std::max({2 * arena.capacity, arena.capacity + count - room, (uint32_t) 16}));
+    #endif
+}
+
+#ifdef ADS_COMPACT_NODES
+// uninitialized slots for count nodes in a row at the end of the node array (e.g. to lay out a copy of a tree)
+template <class T>
+T *AVL<T>::allocate_nodes(uint32_t count) {
+    if (arena.capacity - arena.used < count)
+        grow(std::max(2 * arena.capacity, arena.used + count));
+    T *nodes = arena.nodes + arena.used;
+    arena.used += count;
+    return nodes;
+}
+
+// move the nodes into a new array with room for capacity nodes (the nodes are relocated bitwise, the links between
+// them are relative)
+template <class T>
+void AVL<T>::grow(uint32_t capacity) {
+    T *nodes = static_cast<T *>(::operator new((size_t) capacity * sizeof(T)));
+    if (arena.used)
+        std::memcpy(static_cast<void *>(nodes), static_cast<void *>(arena.nodes), (size_t) arena.used * sizeof(T));
+    auto moved = [&](T *node) -> T * {
+        return node ? nodes + (node - arena.nodes) : NULL;
+    };
+    root = moved(root);
+    for (T *&node : trail)
+        node = moved(node);
+    for (T *&node : side)
+        node = moved(node);
+    ::operator delete(arena.nodes);
+    arena.nodes = nodes;
+    arena.capacity = capacity;
+}
+
+// position of node on path (the size of the path if it is not on it)
+// the walks up the tree look up the parent of the previous node next, so the position in front of it is tried first
+template <class T>
+size_t AVL<T>::locate(const AVL_Path<T> &path, T *node) {
+    if (hint < path.size() && path[hint] == node)
+        return hint;
+    if (hint > 0 && hint <= path.size() && path[hint - 1] == node)
+        return --hint;
+    for (size_t i = path.size(); i-- > 0;) {
+        if (path[i] == node)
+            return hint = i;
+    }
+    return path.size();
+}
+
+// keep the recorded paths through node valid after node was rotated below top (its former child)
+template <class T>
+void AVL<T>::rotated(T *node, T *top) {
+    for (AVL_Path<T> *path : {&trail, &side}) {
+        auto it = std::find(path->begin(), path->end(), node);
+        if (it == path->end())
+            continue;
+        if (it + 1 == path->end() || it[1] != top)
+            path->insert(it, top);
+        else if (it + 2 != path->end() && (node->l == it[2] || node->r == it[2]))
+            std::swap(it[0], it[1]);
+        else
+            path->erase(it);
+    }
+}
+
+// keep the recorded paths through node valid after child took the place of node (which is removed from the tree)
+template <class T>
+void AVL<T>::lift(T *node, T *child) {
+    for (AVL_Path<T> *path : {&trail, &side}) {
+        auto it = std::find(path->begin(), path->end(), node);
+        if (it == path->end())
+            continue;
+        if (it + 1 != path->end() && it[1] == child) {
+            path->erase(it);
+        } else {
+            *it = child;
+            path->erase(it + 1, path->end());
+        }
+    }
+}
+#endif
+
+// return the parent of node (NULL for the root)
+// with ADS_COMPACT_NODES node has to be on a recorded path (of the last descent or of the last 'neighbour' leaf)
+template <class T>
+T *AVL<T>::parent(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    if (node == root)
+        return NULL;
+    for (AVL_Path<T> *path : {&trail, &side}) {
+        size_t i = locate(*path, node);
+        if (i < path->size())
+            return i ? (*path)[i - 1] : NULL;
+    }
+    #ifdef ADS_DEBUG
+    std::cout << "Node is not on a recorded path (no parent)" << std::endl;
+    #endif
+    return NULL;
+    #else
+    return node->p;
+    #endif
+}
+
+// attach node to parent (without ADS_COMPACT_NODES; otherwise the parent is only known from the recorded paths)
+template <class T>
+void AVL<T>::set_parent(T *node, T *parent) {
+    #ifndef ADS_COMPACT_NODES
+    node->p = parent;
+    #endif
+}
+
+// record a step of a descent (with ADS_COMPACT_NODES): every descent that is followed by a walk up the tree or to a
+// 'neighbour' leaf calls this for every node on its way, starting at the root or at a node of the current path
+template <class T>
+void AVL<T>::record(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    if (node == root) {
+        trail.clear();
+        side.clear();
+    } else {
+        while (!trail.empty() && trail.back()->l != node && trail.back()->r != node)
+            trail.pop_back();
+        #ifdef ADS_DEBUG
+        if (trail.empty())
+            std::cout << "Descent does not continue the recorded path" << std::endl;
+        #endif
+    }
+    trail.push_back(node);
+    #endif
+}
+
+// continue from node (with ADS_COMPACT_NODES it has to be on a recorded path, the path to it becomes the one of the
+// last descent)
+template <class T>
+void AVL<T>::follow(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    size_t i = locate(trail, node);
+    if (i < trail.size()) {
+        trail.resize(i + 1);
+        return;
+    }
+    i = locate(side, node);
+    if (i < side.size()) {
+        trail.assign(side.begin(), side.begin() + i + 1);
+        return;
+    }
+    #ifdef ADS_DEBUG
+    std::cout << "Node is not on a recorded path (cannot follow)" << std::endl;
+    #endif
+    #endif
+}
+
+// continue from the end of path (a path from the root, e.g. of a cursor) as if it was the last descent
+template <class T>
+void AVL<T>::follow(const AVL_Path<T> &path) {
+    #ifdef ADS_COMPACT_NODES
+    trail = path;
+    #endif
+}
+
+// set path to the way from the root to node (see first_leaf)
+// with ADS_COMPACT_NODES node has to be on a recorded path, otherwise false is returned and path is left as it is
+template <class T>
+bool AVL<T>::trace(T *node, AVL_Path<T> *path) {
+    #ifdef ADS_COMPACT_NODES
+    AVL_Path<T> *recorded = &trail;
+    size_t i = locate(trail, node);
+    if (i == trail.size()) {
+        recorded = &side;
+        i = locate(side, node);
+    }
+    if (i == recorded->size())
+        return false;
+    if (recorded == path)
+        path->resize(i + 1);
+    else
+        path->assign(recorded->begin(), recorded->begin() + i + 1);
+    #else
+    path->assign(1, node);
+    #endif
+    return true;
+}
+
+// allocate uninitialized memory for count objects of type U that is released together with the tree
+// an aligned slab is rounded up to a multiple of align, so it owns all of its pages (e.g. to place them)
+template <class T>
+template <typename U>
+U *AVL<T>::allocate_slab(size_t count, size_t align) {
+    size_t bytes = count * sizeof(U);
+    void *slab;
+    if (align) {
+        bytes = (bytes + align - 1) / align * align;
+        slab = ::operator new(bytes, std::align_val_t(align));
+    } else {
+        slab = ::operator new(bytes);
+    }
+    slabs.push_back({slab, bytes, align});
+    return static_cast<U *>(slab);
+}
+
+// free all slabs (only allowed once no pooled node is part of the tree anymore)
+template <class T>
+void AVL<T>::free_slabs() {
+    for (auto &slab : slabs) {
+        if (slab.align)
+            ::operator delete(slab.memory, std::align_val_t(slab.align));
+        else
+            ::operator delete(slab.memory);
+    }
+    slabs.clear();
 }
 
 // calcuale the size (number of nodes) of the tree
@@ -90,6 +548,16 @@ uint32_t AVL<T>::tree_size() {
     return tree_size(root);
 }
 
+template <class T>
+AVL_Stats AVL<T>::rebalance_stats() {
+    return stats;
+}
+
+template <class T>
+void AVL<T>::reset_rebalance_stats() {
+    stats = {0, 0};
+}
+
 // return whether or not this node is a leaf (has no child nodes)
 template <class T>
 bool AVL<T>::is_leaf(T *node) {
@@ -98,21 +566,22 @@ bool AVL<T>::is_leaf(T *node) {
 
 // split the provided node (is a leaf)
 // replace the leaf with an 'inner' node and attach two new leaves as childs
+// returns the node (with ADS_COMPACT_NODES it may have been moved to make room for the leaves)
 template <class T>
-void AVL<T>::split_block(T *node) {
-    T *new_left = new T;
-    T *new_right = new T;
+T *AVL<T>::split_block(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    size_t slot = node - arena.nodes;
+    reserve(2);
+    node = arena.nodes + slot;
+    #endif
+    T *new_left = create();
+    T *new_right = create();
     node->l = new_left;
     node->r = new_right;
-    new_left->p = node;
-    new_right->p = node;
+    set_parent(new_left, node);
+    set_parent(new_right, node);
     split_block_update(node, new_left, new_right);
-}
-
-// calculates the number of edges on the direct path to the root node
-template <class T>
-uint32_t AVL<T>::node_depth(T *node) {
-    return !node->p ? 0 : 1 + node_depth(node->p);
+    return node;
 }
 
 // calculates the tree size (the number of nodes in the tree)
@@ -121,36 +590,86 @@ uint32_t AVL<T>::tree_size(T *node) {
     return 1 + (is_leaf(node) ? 0 : tree_size(node->l) + tree_size(node->r));
 }
 
+// walk from node (reached from its child prev, NULL if node is where the change happened) up to the root and
+// recompute the heights; count(n, left) adjusts the counters of every node on the way, left is set if the change
+// lies in the part the counters of n describe (the leaf itself or the left subtree of an inner node)
+template <class T>
+template <typename Count>
+void AVL<T>::propagate(T *node, T *prev, Count count) {
+    for (; node; prev = node, node = parent(node)) {
+        count(node, node->l == prev);
+        node->height = height(node);
+    }
+}
+
+// restore the lower bound of a leaf that has at most lower_bound elements (counted by nums) left
+// steal from a 'neighbour' leaf with at least split_bound elements (the fuller one if both qualify), otherwise merge
+// with the emptier 'neighbour' leaf; returns whether the tree was changed
+template <class T>
+bool AVL<T>::fix_underflow(T *leaf, size_t lower_bound, size_t split_bound) {
+    if (leaf->nums > lower_bound)
+        return false;
+
+    T *prev = prev_leaf(leaf);
+    T *next = next_leaf(leaf);
+
+    // if there are no other leafs just return; nothing to do
+    if (!prev && !next)
+        return false;
+
+    bool left;                                  // use the previous leaf (otherwise the next one)
+    if (!next || !prev)                         // use the only 'neighbour' leaf
+        left = !next;
+    else if (prev->nums >= split_bound || next->nums >= split_bound)
+        left = prev->nums > next->nums;         // one of them has enough elements, steal from the fuller one
+    else
+        left = prev->nums < next->nums;         // both have only few elements, merge with the emptier one
+
+    #ifdef ADS_COMPACT_NODES
+    if (left)
+        prev_leaf(leaf);                        // record the path of the previous leaf again (next replaced it)
+    #endif
+    if (left && prev->nums >= split_bound)
+        steal_left(leaf, prev);
+    else if (left)
+        root = merge_left(leaf, prev);
+    else if (next->nums >= split_bound)
+        steal_right(leaf, next);
+    else
+        root = merge_right(leaf, next);
+    return true;
+}
+
 // merge the leaf with the left 'neighbour' leaf
 // this ensures that the tree remains compact; afterwards propagate the changes
 template <class T>
 T *AVL<T>::merge_left(T *node, T* prev_leaf) {
     merge_left_pre_update(node, prev_leaf);
 
-    T *node_p;
-    T *update_node;
-    if (node->p == prev_leaf->p) {
-        node_p = node->p;
-        node->p = node_p->p;
-        if (node_p->p)
-            node_p->p->r == node_p ? node_p->p->r = node : node_p->p->l = node;
-        update_node = node;
-    } else {
-        node_p = prev_leaf->p;
-        T *leaf_neighbour = node_p->l == prev_leaf ? node_p->r : node_p->l;
-        leaf_neighbour->p = node_p->p;
-        if (node_p->p)
-            node_p->p->r == node_p ? node_p->p->r = leaf_neighbour : node_p->p->l = leaf_neighbour;
-        update_node = leaf_neighbour;
-    }
+    // the parent of the merged away leaf is removed, its other child takes its place
+    T *node_p = parent(prev_leaf);
+    T *update_node = node_p->l == prev_leaf ? node_p->r : node_p->l;
+    T *node_pp = parent(node_p);
+    set_parent(update_node, node_pp);
+    if (node_pp)
+        node_pp->r == node_p ? node_pp->r = update_node : node_pp->l = update_node;
+    #ifdef ADS_COMPACT_NODES
+    lift(node_p, update_node);
+    #endif
 
     merge_post_update(update_node);
 
+    #ifdef ADS_WAVL
+    if (!parent(update_node))
+        root = update_node;
+    node = fix_removal(update_node);
+    #else
     node = fix_tree(node);
+    #endif
     node_p->l = NULL;
     node_p->r = NULL;
-    delete prev_leaf;
-    delete node_p;
+    release(prev_leaf);
+    release(node_p);
     return node;
 }
 
@@ -160,47 +679,180 @@ template <class T>
 T *AVL<T>::merge_right(T *node, T* next_leaf) {
     merge_right_pre_update(node, next_leaf);
 
-    T *node_p;
-    T *update_node;
-    if (node->p == next_leaf->p) {
-        node_p = node->p;
-        node->p = node_p->p;
-        if (node_p->p)
-            node_p->p->r == node_p ? node_p->p->r = node : node_p->p->l = node;
-        update_node = node;
-    } else {
-        node_p = next_leaf->p;
-        T *leaf_neighbour = node_p->r == next_leaf ? node_p->l : node_p->r;
-        leaf_neighbour->p = node_p->p;
-        if (node_p->p)
-            node_p->p->r == node_p ? node_p->p->r = leaf_neighbour : node_p->p->l = leaf_neighbour;
-        update_node = leaf_neighbour;
-    }
+    // the parent of the merged away leaf is removed, its other child takes its place
+    T *node_p = parent(next_leaf);
+    T *update_node = node_p->r == next_leaf ? node_p->l : node_p->r;
+    T *node_pp = parent(node_p);
+    set_parent(update_node, node_pp);
+    if (node_pp)
+        node_pp->r == node_p ? node_pp->r = update_node : node_pp->l = update_node;
+    #ifdef ADS_COMPACT_NODES
+    lift(node_p, update_node);
+    #endif
 
     merge_post_update(update_node);
 
+    #ifdef ADS_WAVL
+    if (!parent(update_node))
+        root = update_node;
+    node = fix_removal(update_node);
+    #else
     node = fix_tree(node);
+    #endif
     node_p->l = NULL;
     node_p->r = NULL;
-    delete next_leaf;
-    delete node_p;
+    release(next_leaf);
+    release(node_p);
     return node;
 }
 
+#ifndef ADS_WAVL
 // iterate the tree from the provided node up to the root
 // in case a node is unbalanced rebalance the tree
+// (the heights on the path are recomputed on the way, so the rotations only have to update the rotated nodes)
 template <class T>
 T *AVL<T>::fix_tree(T *node) {
-    while (node->p) {
-        node = node->p;
+    for (T *p = parent(node); p; p = parent(node)) {
+        node = p;
+        stats.visited++;
         node = balance(node);
+        node->height = height(node);
     }
     return node;
 }
+#else
+// restore the rank rule after a leaf was split (node is the split leaf or one of its two new leaves)
+// a child with the same rank as its parent (0-child) is fixed by promoting the parent, which may turn the parent into
+// a 0-child; the walk stops at the first parent that is not promoted (after at most two rotations)
+template <class T>
+T *AVL<T>::fix_tree(T *node) {
+    T *x = node;
+    if (!is_leaf(x)) {
+        x = x->l;
+        record(x);
+    }
+    for (T *p = parent(x); p && p->rank == x->rank; p = parent(x)) {
+        T *y = p->l == x ? p->r : p->l;
+        stats.visited++;
+        if (p->rank - y->rank <= 1) {
+            p->rank++;
+            x = p;
+            continue;
+        }
+
+        // the sibling is a 2-child; x was just promoted, so one of its children is a 1-child
+        T *top;
+        T *inner = p->l == x ? x->r : x->l;
+        if (x->rank - inner->rank == 1) {
+            top = p->l == x ? rotate_left_right(p) : rotate_right_left(p);
+            top->rank++;
+            x->rank--;
+        } else {
+            top = p->l == x ? rotate_right(p) : rotate_left(p);
+        }
+        p->rank--;
+        if (!parent(top))
+            root = top;
+        update_heights(parent(top));
+        break;
+    }
+    return root;
+}
+
+// restore the rank rule after a merge moved x up (x took the place of its removed parent)
+// a child whose rank is 3 or more below its parent is fixed by demoting the parent (and the sibling) which may
+// move the violation up; the walk stops at the first parent that is not demoted (after at most two rotations)
+template <class T>
+T *AVL<T>::fix_removal(T *x) {
+    for (T *p = parent(x); p && p->rank - x->rank >= 3; p = parent(x)) {
+        T *y = p->l == x ? p->r : p->l;
+        stats.visited++;
+        if (p->rank - y->rank >= 2) {
+            p->rank--;
+        } else if (y->rank - y->l->rank >= 2 && y->rank - y->r->rank >= 2) {
+            p->rank--;
+            y->rank--;
+        } else {
+            // the sibling is a 1-child with a 1-child; rotate it (or its inner child) to the top
+            T *top;
+            T *outer = p->l == x ? y->r : y->l;
+            if (y->rank - outer->rank == 1) {
+                top = p->l == x ? rotate_left(p) : rotate_right(p);
+                y->rank++;
+                p->rank--;
+            } else {
+                top = p->l == x ? rotate_right_left(p) : rotate_left_right(p);
+                top->rank += 2;
+                y->rank--;
+                p->rank -= 2;
+            }
+            if (!parent(top))
+                root = top;
+            update_heights(parent(top));
+            continue;   // x is still below p, but at most two ranks less than before
+        }
+        if (p->rank - x->rank < 3)
+            x = p;
+    }
+    return root;
+}
+
+// recompute the heights from node upwards after a rotation below it (the rotations only update the rotated nodes)
+// stops at the first node whose height does not change
+template <class T>
+void AVL<T>::update_heights(T *node) {
+    for (; node; node = parent(node)) {
+        uint8_t h = height(node);
+        if (h == node->height)
+            break;
+        node->height = h;
+    }
+}
+
+// assign every node of a tree that was built without the rebalancing the rank height - 1
+// (valid for every AVL tree; other shapes may be left with rank differences above 2)
+template <class T>
+void AVL<T>::rank_by_height(T *node) {
+    node->rank = node->height - 1;
+    if (!is_leaf(node)) {
+        rank_by_height(node->l);
+        rank_by_height(node->r);
+    }
+}
+
+#ifdef ADS_DEBUG
+template <class T>
+bool AVL<T>::rank_balanced() {
+    return rank_balanced(root);
+}
+
+// check the rank rule (leaves have rank 0, the rank difference between a node and its children is 1 or 2)
+template <class T>
+bool AVL<T>::rank_balanced(T *node) {
+    if (is_leaf(node))
+        return node->rank == 0;
+    int32_t diff_l = node->rank - node->l->rank;
+    int32_t diff_r = node->rank - node->r->rank;
+    if (diff_l < 1 || diff_l > 2 || diff_r < 1 || diff_r > 2)
+        return false;
+    return rank_balanced(node->l) && rank_balanced(node->r);
+}
+#endif
+#endif
 
 // find the left 'neighbour' leaf and return it
+// with ADS_COMPACT_NODES node has to be on a recorded path, the path to the returned leaf is recorded as well
 template <class T>
 T *AVL<T>::prev_leaf(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    if (!trace(node, &side)) {
+        #ifdef ADS_DEBUG
+        std::cout << "Node is not on a recorded path (no 'neighbour' leaf)" << std::endl;
+        #endif
+        return NULL;
+    }
+    return prev_leaf(&side);
+    #else
     T *curr = NULL;
     T *next = node;
 
@@ -216,11 +868,22 @@ T *AVL<T>::prev_leaf(T *node) {
     while (curr && curr->r)
         curr = curr->r;
     return curr;
+    #endif
 }
 
 // find the right 'neighbour' leaf and return it
+// with ADS_COMPACT_NODES node has to be on a recorded path, the path to the returned leaf is recorded as well
 template <class T>
 T *AVL<T>::next_leaf(T *node) {
+    #ifdef ADS_COMPACT_NODES
+    if (!trace(node, &side)) {
+        #ifdef ADS_DEBUG
+        std::cout << "Node is not on a recorded path (no 'neighbour' leaf)" << std::endl;
+        #endif
+        return NULL;
+    }
+    return next_leaf(&side);
+    #else
     T *curr = NULL;
     T *next = node;
 
@@ -236,45 +899,139 @@ T *AVL<T>::next_leaf(T *node) {
     while (curr && curr->l)
         curr = curr->l;
     return curr;
+    #endif
+}
+
+// descend from node (the root of the tree) to the first leaf and set path to the way down
+// paths are used by the leaf walks that are interrupted by other operations; with ADS_COMPACT_NODES a path holds all
+// nodes from the root to the leaf, otherwise only the leaf (its parent links are used instead)
+template <class T>
+T *AVL<T>::first_leaf(T *node, AVL_Path<T> *path) {
+    #ifdef ADS_COMPACT_NODES
+    path->assign(1, node);
+    while (node->l) {
+        node = node->l;
+        path->push_back(node);
+    }
+    #else
+    while (node->l)
+        node = node->l;
+    path->assign(1, node);
+    #endif
+    return node;
+}
+
+// move path on to the following leaf and return it (NULL if there is none, the path is left as it is then)
+template <class T>
+T *AVL<T>::next_leaf(AVL_Path<T> *path) {
+    #ifdef ADS_COMPACT_NODES
+    size_t i = path->size() - 1;
+    while (i > 0 && (*path)[i - 1]->r == (*path)[i])
+        i--;
+    if (i == 0)
+        return NULL;
+
+    T *node = (*path)[i - 1]->r;
+    path->resize(i);
+    path->push_back(node);
+    while (node->l) {
+        node = node->l;
+        path->push_back(node);
+    }
+    return node;
+    #else
+    T *node = next_leaf(path->back());
+    if (node)
+        path->back() = node;
+    return node;
+    #endif
+}
+
+// move path on to the preceding leaf and return it (see next_leaf)
+template <class T>
+T *AVL<T>::prev_leaf(AVL_Path<T> *path) {
+    #ifdef ADS_COMPACT_NODES
+    size_t i = path->size() - 1;
+    while (i > 0 && (*path)[i - 1]->l == (*path)[i])
+        i--;
+    if (i == 0)
+        return NULL;
+
+    T *node = (*path)[i - 1]->l;
+    path->resize(i);
+    path->push_back(node);
+    while (node->r) {
+        node = node->r;
+        path->push_back(node);
+    }
+    return node;
+    #else
+    T *node = prev_leaf(path->back());
+    if (node)
+        path->back() = node;
+    return node;
+    #endif
 }
 
 // perform a single left rotation on the provided node in order to balance the tree
 // update the content of the involved noes accordingly
 template <class T>
 T *AVL<T>::rotate_left(T *node) {
+    return rotate_left(node, parent(node));
+}
+
+// perform a single right rotation on the provided node in order to balance the tree
+// update the content of the involved noes accordingly
+template <class T>
+T *AVL<T>::rotate_right(T *node) {
+    return rotate_right(node, parent(node));
+}
+
+// left rotation of node below node_p (given by the double rotations, the inner node may not be on a recorded path)
+template <class T>
+T *AVL<T>::rotate_left(T *node, T *node_p) {
+    stats.rotations++;
     T *r = node->r;
-    T *node_p = node->p;
 
     node->r = r->l;
     if (node_p)
         node_p->r == node ? node_p->r = r : node_p->l = r;
-    node->r->p = node;
-    node->p = r;
+    set_parent(node->r, node);
+    set_parent(node, r);
 
     r->l = node;
-    r->p = node_p;
+    set_parent(r, node_p);
+    #ifdef ADS_COMPACT_NODES
+    rotated(node, r);
+    #endif
 
     rotate_left_update(r);
+    node->height = height(node);
+    r->height = height(r);
     return r;
 }
 
-// perform a single right rotation on the provided node in order to balance the tree
-// update the content of the involved noes accordingly
+// right rotation of node below node_p (see rotate_left)
 template <class T>
-T *AVL<T>::rotate_right(T *node) {
+T *AVL<T>::rotate_right(T *node, T *node_p) {
+    stats.rotations++;
     T *l = node->l;
-    T *node_p = node->p;
 
     node->l = l->r;
     if (node_p)
         node_p->r == node ? node_p->r = l : node_p->l = l;
-    node->l->p = node;
-    node->p = l;
+    set_parent(node->l, node);
+    set_parent(node, l);
 
     l->r = node;
-    l->p = node_p;
+    set_parent(l, node_p);
+    #ifdef ADS_COMPACT_NODES
+    rotated(node, l);
+    #endif
 
     rotate_right_update(l);
+    node->height = height(node);
+    l->height = height(l);
     return l;
 }
 
@@ -283,7 +1040,7 @@ T *AVL<T>::rotate_right(T *node) {
 template <class T>
 T *AVL<T>::rotate_left_right(T *node) {
     T *l = node->l;
-    node->l = rotate_left(l);
+    node->l = rotate_left(l, node);
     return rotate_right(node);
 }
 
@@ -292,7 +1049,7 @@ T *AVL<T>::rotate_left_right(T *node) {
 template <class T>
 T *AVL<T>::rotate_right_left(T *node) {
     T *r = node->r;
-    node->r = rotate_right(r);
+    node->r = rotate_right(r, node);
     return rotate_left(node);
 }
 
@@ -340,11 +1097,15 @@ T *AVL<T>::build_balanced_tree(T *parent, uint32_t num_leafs) {
 
     T *node;
     if (parent) {
-        node = new T;
-        node->p = parent;
+        node = create();
+        set_parent(node, parent);
     } else {
+        reserve(2 * num_leafs - 2);     // make room for all nodes, so the nodes held by the recursion stay in place
         node = root;
     }
+    #ifdef ADS_WAVL
+    node->rank = std::bit_width(num_leafs - 1);     // the height of the subtree - 1
+    #endif
 
     if (num_leafs == 1)
         return node;
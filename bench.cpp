@@ -0,0 +1,407 @@
+#include "bit_vector.cpp"
+#include "buffered_bit_vector.cpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <fstream>
+#include <unistd.h>
+#include <malloc.h>
+
+// sizes of the bitvectors that are benchmarked are 2^MIN_LOG .. 2^MAX_LOG (stepping by LOG_STEP)
+uint32_t MIN_LOG = 14;
+uint32_t MAX_LOG = 20;
+uint32_t LOG_STEP = 3;
+// maximal number of timed operations per (workload, pattern) pair
+uint32_t MAX_OPS = 200000;
+
+const uint64_t SEED = 0x5eed;
+
+// statistics over the latencies of individually timed operations
+struct Stats {
+    uint64_t ops;
+    double mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+};
+
+Stats summarize(std::vector<uint64_t> &samples) {
+    Stats stats = {samples.size(), 0, 0, 0, 0, 0};
+    if (samples.empty())
+        return stats;
+    std::sort(samples.begin(), samples.end());
+    uint64_t total = 0;
+    for (auto sample : samples)
+        total += sample;
+    stats.mean = (double) total / samples.size();
+    stats.p50 = samples[samples.size() * 50 / 100];
+    stats.p90 = samples[samples.size() * 90 / 100];
+    stats.p99 = samples[samples.size() * 99 / 100];
+    stats.max = samples.back();
+    return stats;
+}
+
+// number of bytes of resident memory of the process (read from /proc)
+uint64_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// number of bytes currently handed out by the heap allocator
+uint64_t heap_bytes() {
+    return mallinfo2().uordblks;
+}
+
+// bytes per bit that a counter grew by since start (0 if it shrank, e.g. memory of a previous configuration that
+// malloc_trim returned only now)
+double growth_per_bit(uint64_t now, uint64_t start, uint32_t n) {
+    return (double) std::max<int64_t>((int64_t) now - (int64_t) start, 0) / n;
+}
+
+// generates the positions at which the operations are applied
+// random: uniform over the full range, sequential: a cursor that moves over the full range
+// skewed: zipf distributed over a fixed number of buckets that are scattered over the full range
+class Pattern {
+    private:
+        static const uint32_t BUCKETS = 1024;
+
+        std::string kind;
+        std::mt19937_64 rng;
+        std::vector<double> cdf;
+        uint64_t cursor;
+
+    public:
+        Pattern(std::string kind) : kind(kind), rng(SEED), cursor(0) {
+            double sum = 0;
+            for (uint32_t i = 1; i <= BUCKETS; i++) {
+                sum += 1.0 / i;
+                cdf.push_back(sum);
+            }
+            for (auto &c : cdf)
+                c /= sum;
+        }
+
+        std::string name() {
+            return kind;
+        }
+
+        // return the next position in [0, bound)
+        uint32_t next(uint32_t bound) {
+            if (bound == 0)
+                return 0;
+            if (kind == "sequential")
+                return cursor++ % bound;
+            if (kind == "skewed") {
+                double u = std::uniform_real_distribution<double>(0, 1)(rng);
+                uint64_t bucket = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+                bucket = (bucket * 617) % BUCKETS;  // scatter the hot buckets over the vector
+                uint64_t lo = bucket * bound / BUCKETS;
+                uint64_t hi = std::max(lo + 1, (bucket + 1) * bound / BUCKETS);
+                return std::min<uint64_t>(bound - 1, lo + rng() % (hi - lo));
+            }
+            return rng() % bound;
+        }
+
+        bool coin(double probability) {
+            return std::uniform_real_distribution<double>(0, 1)(rng) < probability;
+        }
+};
+
+void print_header() {
+    std::cout << "block_size,n,workload,pattern,ops,ns_per_op,p50_ns,p90_ns,p99_ns,max_ns,"
+              << "rss_bytes_per_bit,heap_bytes_per_bit,accounted_bytes_per_bit" << std::endl;
+}
+
+void print_row(size_t block_size, uint32_t n, std::string workload, std::string pattern, Stats stats,
+               double rss_per_bit, double heap_per_bit, double accounted_per_bit) {
+    std::cout << block_size << "," << n << "," << workload << "," << pattern << ","
+              << stats.ops << "," << stats.mean << ","
+              << stats.p50 << "," << stats.p90 << "," << stats.p99 << "," << stats.max << ","
+              << rss_per_bit << "," << heap_per_bit << "," << accounted_per_bit << std::endl;
+}
+
+// rebalancing work per update (rotations and nodes visited while walking up) as a comment line
+void print_rebalance(size_t block_size, uint32_t n, std::string workload, std::string pattern, AVL_Stats stats, uint64_t ops) {
+    std::cout << "# rebalance," << block_size << "," << n << "," << workload << "," << pattern << ","
+              << (double) stats.rotations / std::max<uint64_t>(ops, 1) << ","
+              << (double) stats.visited / std::max<uint64_t>(ops, 1) << std::endl;
+}
+
+// time a single operation in nanoseconds
+template <typename F>
+inline uint64_t timed(F op) {
+    auto start = std::chrono::steady_clock::now();
+    op();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// accumulates query results so that the queries are not optimized away
+uint64_t sink = 0;
+
+// run all workloads for one block size, one size and one access pattern
+template <size_t S>
+void bench_config(uint32_t n, std::string pattern_name) {
+    Pattern pattern(pattern_name);
+    std::vector<uint64_t> samples;
+    samples.reserve(n);
+    uint32_t ops = std::min(n, MAX_OPS);
+
+    // build the bitvector by inserting n bits; the memory is measured afterwards
+    malloc_trim(0);
+    uint64_t rss_start = resident_bytes();
+    uint64_t heap_start = heap_bytes();
+    BitVector<S> bv;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t index = pattern.next(i + 1);
+        bool value = pattern.coin(0.5);
+        samples.push_back(timed([&] { bv.insert(index, value); }));
+    }
+    double rss_per_bit = growth_per_bit(resident_bytes(), rss_start, n);
+    double heap_per_bit = growth_per_bit(heap_bytes(), heap_start, n);
+    double accounted_per_bit = bv.memory_usage().bytes_per_bit();
+    print_row(S, n, "insert", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+    print_rebalance(S, n, "insert", pattern.name(), bv.rebalance_stats(), n);
+
+    // read only operations
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n);
+        samples.push_back(timed([&] { sink += bv.access(index); }));
+    }
+    print_row(S, n, "access", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n + 1);
+        bool value = i % 2;
+        samples.push_back(timed([&] { sink += bv.rank(index, value); }));
+    }
+    print_row(S, n, "rank", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    uint32_t ones = bv.rank(n, true);
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        bool value = i % 2;
+        uint32_t count = value ? ones : n - ones;
+        if (count == 0)
+            continue;
+        uint32_t num = 1 + pattern.next(count);
+        samples.push_back(timed([&] { sink += bv.select(num, value); }));
+    }
+    print_row(S, n, "select", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n);
+        samples.push_back(timed([&] { sink += bv.next_one(index); }));
+    }
+    print_row(S, n, "next_one", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    // allocation bitmap: claim the first free run and release it again (the release is not timed)
+    // (on a copy with the run summaries)
+    {
+        BitVector<S, BV_RUNS> bitmap(bv.extract());
+        samples.clear();
+        for (uint32_t i = 0; i < ops; i++) {
+            uint32_t k = 1 + pattern.next(16);
+            uint32_t start = 0;
+            samples.push_back(timed([&] { start = bitmap.claim_run(k); }));
+            for (uint32_t j = 0; start != (uint32_t) -1 && j < k; j++)
+                bitmap.unset(start + j);
+        }
+        print_row(S, n, "claim_run", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+    }
+
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n);
+        samples.push_back(timed([&] { bv.flip(index); }));
+    }
+    print_row(S, n, "flip", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    // read only operations after rewriting the tree into contiguous memory
+    bv.relayout();
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n);
+        samples.push_back(timed([&] { sink += bv.access(index); }));
+    }
+    print_row(S, n, "access_relayout", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n + 1);
+        bool value = i % 2;
+        samples.push_back(timed([&] { sink += bv.rank(index, value); }));
+    }
+    print_row(S, n, "rank_relayout", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    // read only operations on a copy that counts the queries and reshapes its tree after every ops queries
+    // (the first pass only trains the shape; the timed passes include the counting and the later reshapes)
+    {
+        BitVector<S, BV_ADAPT> adaptive(bv.extract());
+        adaptive.relayout();
+        adaptive.adapt_every(ops);
+        for (uint32_t i = 0; i < ops; i++)
+            sink += adaptive.access(pattern.next(n));
+
+        samples.clear();
+        for (uint32_t i = 0; i < ops; i++) {
+            uint32_t index = pattern.next(n);
+            samples.push_back(timed([&] { sink += adaptive.access(index); }));
+        }
+        print_row(S, n, "access_adaptive", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+        samples.clear();
+        for (uint32_t i = 0; i < ops; i++) {
+            uint32_t index = pattern.next(n + 1);
+            bool value = i % 2;
+            samples.push_back(timed([&] { sink += adaptive.rank(index, value); }));
+        }
+        print_row(S, n, "rank_adaptive", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+    }
+
+    // navigation with a cursor (sequential steps and finger searches to the pattern positions)
+    auto cursor = bv.cursor(0);
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++)
+        samples.push_back(timed([&] { sink += cursor.access(); cursor.next() || (cursor.seek(0), true); }));
+    print_row(S, n, "cursor_next", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    samples.clear();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = pattern.next(n);
+        samples.push_back(timed([&] { cursor.seek(index); sink += cursor.access(); }));
+    }
+    print_row(S, n, "cursor_seek", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+    // mixed workloads with different read ratios (the size of the bitvector stays roughly constant)
+    uint32_t size = n;
+    for (uint32_t read_percent : {90, 50, 10}) {
+        samples.clear();
+        bv.reset_rebalance_stats();
+        uint32_t updates = 0;
+        for (uint32_t i = 0; i < ops; i++) {
+            if (pattern.coin(read_percent / 100.0)) {
+                uint32_t index = pattern.next(size + 1);
+                bool value = i % 2;
+                samples.push_back(timed([&] { sink += bv.rank(index, value); }));
+            } else if (i % 2 == 0 || size == 0) {
+                uint32_t index = pattern.next(size + 1);
+                bool value = pattern.coin(0.5);
+                samples.push_back(timed([&] { bv.insert(index, value); }));
+                size++;
+                updates++;
+            } else {
+                uint32_t index = pattern.next(size);
+                samples.push_back(timed([&] { bv.del(index); }));
+                size--;
+                updates++;
+            }
+        }
+        std::string workload = "mixed_r" + std::to_string(read_percent);
+        print_row(S, n, workload, pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+        print_rebalance(S, n, workload, pattern.name(), bv.rebalance_stats(), updates);
+    }
+
+    // ingest: 90% inserts and deletes, 10% accesses; the same operations on a copy and on a copy with a write buffer
+    // (the merges of the buffer are part of the latencies of the updates that trigger them)
+    {
+        struct Op {
+            uint8_t kind;   // 0: access, 1: insert, 2: delete
+            uint32_t index;
+            bool value;
+        };
+        std::vector<Op> trace;
+        uint32_t current = size;
+        for (uint32_t i = 0; i < ops; i++) {
+            if (pattern.coin(0.1) && current > 0) {
+                trace.push_back({0, pattern.next(current), false});
+            } else if (i % 2 == 0 || current == 0) {
+                trace.push_back({1, pattern.next(current + 1), pattern.coin(0.5)});
+                current++;
+            } else {
+                trace.push_back({2, pattern.next(current), false});
+                current--;
+            }
+        }
+
+        std::vector<bool> bits = bv.extract();
+        BitVector<S> plain(bits);
+        samples.clear();
+        for (const Op &op : trace) {
+            if (op.kind == 0)
+                samples.push_back(timed([&] { sink += plain.access(op.index); }));
+            else if (op.kind == 1)
+                samples.push_back(timed([&] { plain.insert(op.index, op.value); }));
+            else
+                samples.push_back(timed([&] { plain.del(op.index); }));
+        }
+        print_row(S, n, "ingest", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+
+        BufferedBitVector<S> buffered(bits);
+        samples.clear();
+        for (const Op &op : trace) {
+            if (op.kind == 0)
+                samples.push_back(timed([&] { sink += buffered.access(op.index); }));
+            else if (op.kind == 1)
+                samples.push_back(timed([&] { buffered.insert(op.index, op.value); }));
+            else
+                samples.push_back(timed([&] { buffered.del(op.index); }));
+        }
+        samples.push_back(timed([&] { buffered.flush(); }));
+        print_row(S, n, "ingest_buffered", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+    }
+
+    // remove all bits again
+    samples.clear();
+    bv.reset_rebalance_stats();
+    for (; size > 0; size--) {
+        uint32_t index = pattern.next(size);
+        samples.push_back(timed([&] { bv.del(index); }));
+    }
+    print_row(S, n, "del", pattern.name(), summarize(samples), rss_per_bit, heap_per_bit, accounted_per_bit);
+    print_rebalance(S, n, "del", pattern.name(), bv.rebalance_stats(), samples.size());
+
+}
+
+template <size_t S>
+void bench_block_size() {
+    for (uint32_t log = MIN_LOG; log <= MAX_LOG; log += LOG_STEP)
+        for (std::string pattern : {"random", "sequential", "skewed"})
+            bench_config<S>(1u << log, pattern);
+}
+
+template <size_t... S>
+void sweep() {
+    (bench_block_size<S>(), ...);
+}
+
+// usage: bench [min_log] [max_log] [log_step] [max_ops]
+// prints one csv line per (block size, size, workload, pattern)
+int main(int argc, char *argv[]) {
+    if (argc > 1)
+        MIN_LOG = std::stoul(argv[1]);
+    if (argc > 2)
+        MAX_LOG = std::stoul(argv[2]);
+    if (argc > 3)
+        LOG_STEP = std::max(1ul, std::stoul(argv[3]));
+    if (argc > 4)
+        MAX_OPS = std::stoul(argv[4]);
+
+    // the latencies include the overhead of reading the clock twice
+    std::vector<uint64_t> overhead;
+    for (uint32_t i = 0; i < 100000; i++)
+        overhead.push_back(timed([] {}));
+    std::cout << "# timer_overhead_p50_ns=" << summarize(overhead).p50 << std::endl;
+
+    print_header();
+    std::cout << "# rebalance lines: block_size,n,workload,pattern,rotations_per_update,visited_per_update" << std::endl;
+    sweep<64, 256, 512, 1024, 4096>();
+    std::cout << "# checksum=" << sink << std::endl;
+}
@@ -1,14 +1,102 @@
+#ifndef BITVECTOR_IMPL
+#define BITVECTOR_IMPL
+
 #include "bit_vector.hpp"
 
 #include <algorithm>   // used for the std::min operation
+#include <array>
+#include <climits>
 
-template <size_t S>
-BitVector<S>::BitVector() : AVL<BV_Node<S>>() {
+#ifdef __GLIBC__
+#include <malloc.h>    // used for malloc_usable_size
+#endif
+
+// excess summaries of all bytes (the most significant bit is the first parenthesis)
+inline const BP_Excess *bp_byte_table() {
+    static const std::array<BP_Excess, 256> table = [] {
+        std::array<BP_Excess, 256> table;
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            BP_Excess bp = {0, 0, 0};
+            for (int32_t bit = 7; bit >= 0; bit--) {
+                bp.excess += (byte >> bit) & 1 ? 1 : -1;
+                bp.min = std::min(bp.min, bp.excess);
+                bp.max = std::max(bp.max, bp.excess);
+            }
+            table[byte] = bp;
+        }
+        return table;
+    }();
+    return table.data();
+}
+
+// the hash of a bit sequence b_0 ... b_n-1 is the polynomial sum (b_i + 1) * X^(n-1-i) modulo the mersenne prime 2^61 - 1
+// (the hash of a concatenation A B is hash(A) * X^|B| + hash(B), so it does not depend on the shape of the tree)
+const uint64_t HASH_PRIME = (1ULL << 61) - 1;
+const uint64_t HASH_BASE = 0x1b873593a5b2c3dULL;
+
+inline uint64_t hash_add(uint64_t a, uint64_t b) {
+    uint64_t sum = a + b;
+    return sum >= HASH_PRIME ? sum - HASH_PRIME : sum;
+}
+
+inline uint64_t hash_mul(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t) a * b;
+    return hash_add((uint64_t) product & HASH_PRIME, (uint64_t) (product >> 61));
+}
+
+// X^len (multiplies the precomputed powers X^(2^i) of the set bits of len)
+inline uint64_t hash_pow(uint32_t len) {
+    static const std::array<uint64_t, 32> powers = [] {
+        std::array<uint64_t, 32> powers;
+        powers[0] = HASH_BASE;
+        for (uint32_t i = 1; i < 32; i++)
+            powers[i] = hash_mul(powers[i - 1], powers[i - 1]);
+        return powers;
+    }();
+    uint64_t result = 1;
+    for (; len; len &= len - 1)
+        result = hash_mul(result, powers[std::countr_zero(len)]);
+    return result;
+}
+
+// hashes of all bytes (the most significant bit is the first bit of the sequence)
+inline const uint64_t *hash_byte_table() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> table;
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint64_t hash = 0;
+            for (int32_t bit = 7; bit >= 0; bit--)
+                hash = hash_add(hash_mul(hash, HASH_BASE), ((byte >> bit) & 1) + 1);
+            table[byte] = hash;
+        }
+        return table;
+    }();
+    return table.data();
+}
+
+// number of bytes the allocator reserves for an allocation of requested bytes at ptr
+// (glibc reports the size of ptr, other allocators are estimated from requested)
+inline uint64_t allocated_bytes([[maybe_unused]] void *ptr, [[maybe_unused]] size_t requested) {
+    #ifdef __GLIBC__
+    return malloc_usable_size(ptr) + sizeof(size_t);     // usable size plus the chunk header
+    #else
+    size_t align = 2 * sizeof(void *);                   // estimate for a typical size class allocator
+    return (requested + sizeof(size_t) + align - 1) / align * align;
+    #endif
+}
+
+template <size_t S, uint8_t F>
+BitVector<S, F>::BitVector() : AVL<BV_Node<S, F>>() {
     BLOCK_SIZE = S;
     TARGET_SIZE = BLOCK_SIZE / 2;
     SPLIT_BOUND = (BLOCK_SIZE * 3) / 4;
     LOWER_BOUND = BLOCK_SIZE / 4;
 
+    compact_cursor = 0;
+    adapt_period = 0;
+    adapt_queries = 0;
+    slab_placement = {NumaPolicy::local, 0, 1, 1};
+
     std::string fmask = std::string(BLOCK_SIZE, '1');
     std::string mmask = std::string(TARGET_SIZE, '1') + std::string(TARGET_SIZE, '0');
     std::string lmask = std::string(TARGET_SIZE, '0') + std::string(TARGET_SIZE, '1');
@@ -19,198 +107,931 @@ BitVector<S>::BitVector() : AVL<BV_Node<S>>() {
 }
 
 // construct the bitvector tree structure from the provided bool vector
-template <size_t S>
-BitVector<S>::BitVector(std::vector<bool> bits) : BitVector() {
+template <size_t S, uint8_t F>
+BitVector<S, F>::BitVector(std::vector<bool> bits) : BitVector() {
     uint32_t num_leafs = (bits.size() + TARGET_SIZE - 1) / TARGET_SIZE;
 
     this->build_balanced_tree(NULL, num_leafs);
-    BV_Node<S> *leaf = this->root;
-    while (leaf->l)
-        leaf = leaf->l;
+    AVL_Path<BV_Node<S, F>> path;
+    BV_Node<S, F> *leaf = this->first_leaf(this->root, &path);
     for (uint32_t i = 0; i < num_leafs; i++) {
         uint32_t count = 0;
         for (uint32_t j = 0; j < TARGET_SIZE && i * TARGET_SIZE + j < bits.size(); j++,count++)
             (*leaf->data)[BLOCK_SIZE - j - 1] = bits[(i * TARGET_SIZE) + j];
-        propagate_update(leaf, NULL, count, (*leaf->data).count());
-        leaf = this->next_leaf(leaf);
+        leaf->nums = count;
+        leaf->ones = (*leaf->data).count();
+        leaf = this->next_leaf(&path);
     }
+    uint32_t nums, ones;
+    recount(this->root, &nums, &ones);
 }
 
-template <size_t S>
-void BitVector<S>::insert(uint32_t index, bool value) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::insert(uint32_t index, bool value) {
     this->root = insert(this->root, index, value);
 }
 
-template <size_t S>
-void BitVector<S>::del(uint32_t index) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::del(uint32_t index) {
     this->root = del(this->root, index);
 }
 
-template <size_t S>
-void BitVector<S>::flip(uint32_t index) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::flip(uint32_t index) {
     flip(this->root, index);
 }
 
-template <size_t S>
-void BitVector<S>::set(uint32_t index) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::set(uint32_t index) {
     set(this->root, index);
 }
 
-template <size_t S>
-void BitVector<S>::unset(uint32_t index) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::unset(uint32_t index) {
     unset(this->root, index);
 }
 
-template <size_t S>
-uint32_t BitVector<S>::rank(uint32_t index, bool value) {
-    return rank(this->root, index, value);
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::rank(uint32_t index, bool value) {
+    uint32_t result = rank(this->root, index, value);
+    count_query();
+    return result;
 }
 
-template <size_t S>
-uint32_t BitVector<S>::select(uint32_t index, bool value) {
-    return select(this->root, index, value);
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::select(uint32_t index, bool value) {
+    uint32_t result = select(this->root, index, value);
+    count_query();
+    return result;
 }
 
-template <size_t S>
-bool BitVector<S>::access(uint32_t index) {
-    return access(this->root, index);
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::access(uint32_t index) {
+    bool result = access(this->root, index);
+    count_query();
+    return result;
 }
 
-template <size_t S>
-void BitVector<S>::complement() {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::complement() {
     complement(this->root);
 }
 
-template <size_t S>
-uint32_t BitVector<S>::size() {
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::size() {
     return size(this->root);
 }
 
 // collect all the bits in the bitvector and return it as one consecutive bool vector
-template <size_t S>
-std::vector<bool> BitVector<S>::extract() {
-    BV_Node<S> *node = this->root;
-    while (node->l)
-        node = node->l;
+template <size_t S, uint8_t F>
+std::vector<bool> BitVector<S, F>::extract() {
+    AVL_Path<BV_Node<S, F>> path;
+    BV_Node<S, F> *node = this->first_leaf(this->root, &path);
     std::vector<bool> bits;
     while (node) {
         for (uint32_t i = 0; i < node->nums; i++)
             bits.push_back((*node->data)[BLOCK_SIZE - i - 1]);
-        node = this->next_leaf(node);
+        node = this->next_leaf(&path);
     }
     return bits;
 }
 
-template <size_t S>
-uint32_t BitVector<S>::operator[](uint32_t index) {
-    return access(this->root, index);
+// account for all memory used by the bitvector and report the fill levels of the leaves
+template <size_t S, uint8_t F>
+BV_Memory BitVector<S, F>::memory_usage() {
+    BV_Memory memory = {};
+    memory.object_bytes = sizeof(*this);
+    for (auto &slab : this->slabs)
+        memory.allocator_overhead_bytes += allocated_bytes(slab.memory, slab.bytes);
+    #ifdef ADS_COMPACT_NODES
+    // the node array is accounted as a whole as well (its unused slots count as overhead)
+    size_t array_bytes = this->arena.capacity * sizeof(BV_Node<S, F>);
+    if (this->arena.nodes)
+        memory.allocator_overhead_bytes += allocated_bytes(this->arena.nodes, array_bytes);
+    #endif
+    memory_usage(this->root, &memory);
+    memory.total_bytes = memory.object_bytes + memory.inner_node_bytes + memory.leaf_node_bytes
+                       + memory.leaf_payload_bytes + memory.inner_payload_bytes + memory.allocator_overhead_bytes;
+    return memory;
 }
 
-template <size_t S>
-void BitVector<S>::operator~() {
+// copy the bitvector in a single pass over the tree (the structure is kept as is)
+// all nodes of the copy are allocated in one slab (the inner nodes in van Emde Boas order followed by the leaves
+// from left to right) and all blocks in another (from left to right)
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::clone() {
+    return clone(this->slab_placement);
+}
+
+// copy the bitvector with the slabs of the copy placed on the memory nodes as given by placement
+// (with ADS_COMPACT_NODES the nodes are laid out the same way at the end of the node array of the copy, which is placed
+// by first touch)
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::clone(NumaPlacement placement) {
+    BitVector<S, F> copy;
+    copy.slab_placement = placement;
+    std::vector<BV_Node<S, F> *> order;
+    veb_order(this->root, this->root->height - 1, &order);
+    std::unordered_map<BV_Node<S, F> *, BV_Node<S, F> *> slots;
+
+    uint32_t nodes = this->tree_size();
+    copy.release(copy.root);
+    #ifdef ADS_COMPACT_NODES
+    BV_Node<S, F> *slab = copy.allocate_nodes(nodes);
+    #else
+    BV_Node<S, F> *slab = copy.template allocate_placed_slab<BV_Node<S, F>>(nodes);
+    #endif
+    std::bitset<S> *blocks = copy.template allocate_placed_slab<std::bitset<S>>((nodes + 1) / 2);
+
+    for (uint32_t i = 0; i < order.size(); i++)
+        slots[order[i]] = slab + i;
+    BV_Node<S, F> *leaves = slab + order.size();
+
+    copy.root = clone(this->root, NULL, slots, &leaves, &blocks);
+    copy.compact_cursor = compact_cursor;
+    copy.adapt_period = adapt_period;
+    copy.adapt_queries = adapt_queries;
+    return copy;
+}
+
+// copy node and its subtree; inner nodes go to their slot, leaves and blocks to the next free slot of the slabs
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::clone(BV_Node<S, F> *node, BV_Node<S, F> *parent, std::unordered_map<BV_Node<S, F> *, BV_Node<S, F> *> &slots,
+                                BV_Node<S, F> **leaves, std::bitset<S> **blocks) {
+    bool leaf = this->is_leaf(node);
+    BV_Node<S, F> *copy = leaf ? new ((*leaves)++) BV_Node<S, F>(new ((*blocks)++) std::bitset<S>(*node->data))
+                            : new (slots[node]) BV_Node<S, F>(NULL);
+    copy->pooled = true;
+    this->set_parent(copy, parent);
+    copy->height = node->height;
+    #ifdef ADS_WAVL
+    copy->rank = node->rank;
+    #endif
+    copy->nums = node->nums;
+    copy->ones = node->ones;
+    static_cast<BV_Summaries<F> &>(*copy) = *node;
+    if (!leaf) {
+        copy->l = clone(node->l, copy, slots, leaves, blocks);
+        copy->r = clone(node->r, copy, slots, leaves, blocks);
+    }
+    return copy;
+}
+
+// append the inner nodes of the top levels of the subtree below node to order (in van Emde Boas order)
+// the top half of the levels is laid out first, followed by the subtrees hanging below it from left to right
+template <size_t S, uint8_t F>
+void BitVector<S, F>::veb_order(BV_Node<S, F> *node, uint32_t levels, std::vector<BV_Node<S, F> *> *order) {
+    if (levels == 0 || this->is_leaf(node))
+        return;
+    if (levels == 1) {
+        order->push_back(node);
+        return;
+    }
+
+    uint32_t top = levels / 2;
+    veb_order(node, top, order);
+    std::vector<BV_Node<S, F> *> bottom;
+    veb_roots(node, top, &bottom);
+    for (auto root : bottom)
+        veb_order(root, levels - top, order);
+}
+
+// collect the inner nodes depth levels below node from left to right
+template <size_t S, uint8_t F>
+void BitVector<S, F>::veb_roots(BV_Node<S, F> *node, uint32_t depth, std::vector<BV_Node<S, F> *> *roots) {
+    if (this->is_leaf(node))
+        return;
+    if (depth == 0) {
+        roots->push_back(node);
+        return;
+    }
+    veb_roots(node->l, depth - 1, roots);
+    veb_roots(node->r, depth - 1, roots);
+}
+
+// rewrite the tree into contiguous memory (see clone) so that descents touch fewer cache lines and pages
+// the bitvector stays fully dynamic; nodes created by later updates are allocated individually again
+template <size_t S, uint8_t F>
+void BitVector<S, F>::relayout() {
+    *this = clone();
+}
+
+// allocate a slab with the placement of the bitvector; placed slabs own their pages, which are placed before the
+// slab is written (slabs without a placement are allocated as usual)
+template <size_t S, uint8_t F>
+template <typename U>
+U *BitVector<S, F>::allocate_placed_slab(size_t count) {
+    if (slab_placement.policy == NumaPolicy::local)
+        return this->template allocate_slab<U>(count);
+    U *slab = this->template allocate_slab<U>(count, NUMA_PAGE);
+    numa_place(slab, this->slabs.back().bytes, slab_placement);
+    return slab;
+}
+
+// placement of the slabs of the tree (individually allocated nodes are placed by first touch)
+template <size_t S, uint8_t F>
+NumaPlacement BitVector<S, F>::placement() {
+    return slab_placement;
+}
+
+// move all nodes and blocks into slabs with the placement (see relayout); later relayouts and clones keep it
+template <size_t S, uint8_t F>
+void BitVector<S, F>::place(NumaPlacement placement) {
+    *this = clone(placement);
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::compact() {
+    compact(BLOCK_SIZE);
+}
+
+// repack all bits into as few leaves as possible (each holding at most fill bits)
+// and replace the tree by a perfectly balanced one; runs in a single pass over the leaves
+template <size_t S, uint8_t F>
+void BitVector<S, F>::compact(uint32_t fill) {
+    fill = std::clamp(fill, (uint32_t) LOWER_BOUND + 1, (uint32_t) BLOCK_SIZE);
+    uint32_t bits = size();
+    uint32_t num_leafs = (bits + fill - 1) / fill;
+    if (num_leafs <= 1 && this->is_leaf(this->root))
+        return;
+
+    this->reserve(2 * num_leafs);   // the old and the new tree share the node array, which must not move
+    BV_Node<S, F> *old_root = this->root;
+    AVL_Path<BV_Node<S, F>> old_path;
+    BV_Node<S, F> *old_leaf = this->first_leaf(old_root, &old_path);
+    uint32_t offset = 0;
+
+    this->root = this->create();
+    this->build_balanced_tree(NULL, num_leafs);
+    AVL_Path<BV_Node<S, F>> path;
+    BV_Node<S, F> *leaf = this->first_leaf(this->root, &path);
+
+    // distribute the bits evenly over the new leaves; copy them block wise from the old leaves
+    for (uint32_t i = 0; i < num_leafs; i++) {
+        uint32_t nums = (uint64_t) bits * (i + 1) / num_leafs - (uint64_t) bits * i / num_leafs;
+        while (leaf->nums < nums) {
+            if (offset == old_leaf->nums) {
+                old_leaf->release_data();   // release the payload as early as possible
+                old_leaf = this->next_leaf(&old_path);
+                offset = 0;
+                continue;
+            }
+            uint32_t count = std::min(nums - leaf->nums, old_leaf->nums - offset);
+            std::bitset<S> chunk = (*old_leaf->data << offset) & ~(FULL_MASK >> count);
+            *leaf->data |= chunk >> leaf->nums;
+            leaf->nums += count;
+            offset += count;
+        }
+        leaf->ones = (*leaf->data).count();
+        leaf = this->next_leaf(&path);
+    }
+    this->release(old_root);
+    this->free_slabs();
+
+    uint32_t nums, ones;
+    recount(this->root, &nums, &ones);
+    compact_cursor = 0;
+}
+
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::compact_step(uint32_t max_leaves) {
+    return compact_step(max_leaves, BLOCK_SIZE);
+}
+
+// incrementally repack the leaves so that each holds up to fill bits
+// at most max_leaves leaves are processed per call, the next call continues where this one stopped
+// returns true once a full pass over the bitvector has been completed
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::compact_step(uint32_t max_leaves, uint32_t fill) {
+    fill = std::clamp(fill, (uint32_t) LOWER_BOUND + 1, (uint32_t) BLOCK_SIZE);
+    if (compact_cursor >= size())
+        compact_cursor = 0;
+
+    uint32_t index = compact_cursor;
+    BV_Node<S, F> *leaf = find_block(this->root, &index);
+    compact_cursor -= index;
+
+    for (uint32_t step = 0; step < max_leaves; step++) {
+        BV_Node<S, F> *next = this->next_leaf(leaf);
+        if (!next) {
+            compact_cursor = 0;
+            return true;
+        }
+
+        if (leaf->nums + next->nums <= fill) {
+            this->root = this->merge_right(leaf, next);
+            continue;
+        }
+        // fill up the leaf, but leave enough bits in the next leaf to keep it above the lower bound
+        uint32_t spare = next->nums > LOWER_BOUND ? next->nums - LOWER_BOUND - 1 : 0;
+        if (leaf->nums < fill)
+            move_left(leaf, next, std::min(fill - leaf->nums, spare));
+        compact_cursor += leaf->nums;
+        leaf = next;
+        this->follow(leaf);
+    }
+    return false;
+}
+
+// reshape the tree so that frequently queried leaves move closer to the root (weight balanced by the query counts)
+// every leaf gets the weight hits * leaves + total hits, so half of the weight is spread evenly over all leaves;
+// splitting every subtree where its weight is halved puts a leaf at depth at most log2(total weight / its weight) + 2,
+// which is at most log2(leaves) + 3 for every leaf and close to the entropy of the query distribution on average
+// only the inner nodes are rewired (the leaves stay as they are, so cursors remain valid unless ADS_COMPACT_NODES is
+// set); afterwards the counts are halved so that the shape follows hot spots that move; later updates rebalance their
+// paths with the usual rotations
+template <size_t S, uint8_t F>
+void BitVector<S, F>::adapt() {
+    static_assert(F & BV_ADAPT, "reshaping by the queries needs a bitvector with BV_ADAPT");
+    adapt_queries = 0;
+    if (this->is_leaf(this->root))
+        return;
+
+    std::vector<BV_Node<S, F> *> leaves;
+    std::vector<BV_Node<S, F> *> inner;
+    std::vector<BV_Node<S, F> *> stack = {this->root};
+    uint64_t total = 0;
+    while (!stack.empty()) {
+        BV_Node<S, F> *node = stack.back();
+        stack.pop_back();
+        if (this->is_leaf(node)) {
+            leaves.push_back(node);
+            total += node->hits;
+        } else {
+            inner.push_back(node);
+            stack.push_back(node->r);
+            stack.push_back(node->l);
+        }
+    }
+
+    std::vector<uint64_t> prefix = {0};
+    for (auto leaf : leaves) {
+        prefix.push_back(prefix.back() + leaf->hits * leaves.size() + std::max<uint64_t>(total, 1));
+        leaf->hits /= 2;
+    }
+    this->root = reshape(leaves, prefix, 0, leaves.size(), NULL, &inner);
+
+    uint32_t nums, ones;
+    recount(this->root, &nums, &ones);
+    #ifdef ADS_WAVL
+    this->rank_by_height(this->root);
+    #endif
+}
+
+// count the queries (and the leaves they end in) and reshape the tree after every period queries
+// a period of 0 stops counting; the shape stays as it is until the next update rebalances it
+template <size_t S, uint8_t F>
+void BitVector<S, F>::adapt_every(uint32_t period) {
+    static_assert(F & BV_ADAPT, "reshaping by the queries needs a bitvector with BV_ADAPT");
+    adapt_period = period;
+    adapt_queries = 0;
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::count_query() {
+    if constexpr ((F & BV_ADAPT) != 0)
+        if (adapt_period && ++adapt_queries >= adapt_period)
+            adapt();
+}
+
+// count a query that ended in leaf
+template <size_t S, uint8_t F>
+void BitVector<S, F>::count_hit(BV_Node<S, F> *leaf) {
+    if constexpr ((F & BV_ADAPT) != 0)
+        if (adapt_period)
+            leaf->hits++;
+}
+
+// build a weight balanced tree over the leaves [lo, hi) out of the inner nodes in spare and return its root
+// prefix[i] is the total weight of the first i leaves
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::reshape(std::vector<BV_Node<S, F> *> &leaves, std::vector<uint64_t> &prefix, uint32_t lo,
+                                  uint32_t hi, BV_Node<S, F> *parent, std::vector<BV_Node<S, F> *> *spare) {
+    BV_Node<S, F> *node;
+    if (hi - lo == 1) {
+        node = leaves[lo];
+    } else {
+        // split in front of the leaf that contains the middle of the weight or right behind it (whichever is closer)
+        uint64_t middle = prefix[lo] + prefix[hi];
+        uint32_t split = std::lower_bound(prefix.begin() + lo + 1, prefix.begin() + hi, (middle + 1) / 2) - prefix.begin();
+        if (split == hi || (split > lo + 1 && middle - 2 * prefix[split - 1] < 2 * prefix[split] - middle))
+            split--;
+
+        node = spare->back();
+        spare->pop_back();
+        node->l = reshape(leaves, prefix, lo, split, node, spare);
+        node->r = reshape(leaves, prefix, split, hi, node, spare);
+    }
+    this->set_parent(node, parent);
+    return node;
+}
+
+// return the bit at index and store the number of occurrences of that bit in front of index in rank
+// (access and rank with a single descent)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::access_rank(uint32_t index, uint32_t *rank) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    BV_Node<S, F> *leaf = query_block(this->root, &offset, &ones);
+    bool value = (*leaf->data)[BLOCK_SIZE - offset - 1];
+    ones += (*leaf->data & ~(FULL_MASK >> offset)).count();
+    *rank = value ? ones : index - ones;
+    return value;
+}
+
+// insert value at index and return the number of occurrences of value in front of index
+// (insert and rank with a single descent)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::insert_rank(uint32_t index, bool value) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset, &ones);
+
+    if (offset > BLOCK_SIZE) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return -1;
+    }
+
+    ones += (*leaf->data & ~(FULL_MASK >> offset)).count();
+    insert_block(leaf, offset, value);
+    return value ? ones : index - ones;
+}
+
+// remove the bit at index, return it and store the number of occurrences of that bit in front of index in rank
+// (delete and rank with a single descent)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::del_rank(uint32_t index, uint32_t *rank) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset, &ones);
+
+    if (offset >= leaf->nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return false;
+    }
+
+    bool value = (*leaf->data)[BLOCK_SIZE - offset - 1];
+    ones += (*leaf->data & ~(FULL_MASK >> offset)).count();
+    *rank = value ? ones : index - ones;
+    del_block(leaf, offset);
+    return value;
+}
+
+// number of occurrences of value in front of to, the number in front of from (from <= to) is stored in from_rank
+// (both ranks with a single descent that only splits where the paths to the two positions part)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::rank_pair(uint32_t from, uint32_t to, bool value, uint32_t *from_rank) {
+    uint32_t from_offset = from;
+    uint32_t to_offset = to;
+    uint32_t ones = 0;
+    BV_Node<S, F> *node = this->root;
+    while (!this->is_leaf(node) && (from_offset < node->nums) == (to_offset < node->nums)) {
+        if (to_offset < node->nums) {
+            node = node->l;
+        } else {
+            from_offset -= node->nums;
+            to_offset -= node->nums;
+            ones += node->ones;
+            node = node->r;
+        }
+    }
+
+    uint32_t from_ones = ones;
+    uint32_t to_ones = ones;
+    BV_Node<S, F> *from_leaf = query_block(node, &from_offset, &from_ones);
+    BV_Node<S, F> *to_leaf = query_block(node, &to_offset, &to_ones);
+    from_ones += (*from_leaf->data & ~(FULL_MASK >> from_offset)).count();
+    to_ones += (*to_leaf->data & ~(FULL_MASK >> to_offset)).count();
+    *from_rank = value ? from_ones : from - from_ones;
+    return value ? to_ones : to - to_ones;
+}
+
+// position of the first one at or after index (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::next_one(uint32_t index) {
+    return next_bit(index, true);
+}
+
+// position of the last one at or before index (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::prev_one(uint32_t index) {
+    return prev_bit(index, true);
+}
+
+// position of the first zero at or after index (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::next_zero(uint32_t index) {
+    return next_bit(index, false);
+}
+
+// position of the last zero at or before index (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::prev_zero(uint32_t index) {
+    return prev_bit(index, false);
+}
+
+template <size_t S, uint8_t F>
+typename BitVector<S, F>::OnesIterator BitVector<S, F>::ones_begin() {
+    return OnesIterator(this, this->root);
+}
+
+template <size_t S, uint8_t F>
+typename BitVector<S, F>::OnesIterator BitVector<S, F>::ones_end() {
+    return OnesIterator(this, NULL);
+}
+
+// interpret the bitvector as balanced parentheses (1 is an opening, 0 a closing parenthesis)
+// excess(i) is the number of opening minus the number of closing parentheses up to and including i
+template <size_t S, uint8_t F>
+int32_t BitVector<S, F>::excess(uint32_t index) {
+    return 2 * (int32_t) rank(index + 1, true) - (int32_t) (index + 1);
+}
+
+// find the smallest j > index with excess(j) = excess(index) + diff (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::fwd_search(uint32_t index, int32_t diff) {
+    uint32_t boundary = fwd_boundary(index + 1, excess(index) + diff);
+    return boundary == (uint32_t) -1 ? -1 : boundary - 1;
+}
+
+// find the largest j < index with excess(j) = excess(index) + diff (-1 if there is none or if j = -1)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::bwd_search(uint32_t index, int32_t diff) {
+    uint32_t boundary = bwd_boundary(index + 1, excess(index) + diff);
+    return boundary == (uint32_t) -1 ? -1 : boundary - 1;
+}
+
+// position of the closing parenthesis that matches the opening one at index
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::find_close(uint32_t index) {
+    return fwd_search(index, -1);
+}
+
+// position of the opening parenthesis that matches the closing one at index
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::find_open(uint32_t index) {
+    return bwd_boundary(index + 1, excess(index));
+}
+
+// position of the opening parenthesis of the closest pair that encloses the opening one at index
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::enclose(uint32_t index) {
+    return bwd_boundary(index + 1, excess(index) - 2);
+}
+
+// minimum of excess(k) for all k in [from, to]
+template <size_t S, uint8_t F>
+int32_t BitVector<S, F>::min_excess(uint32_t from, uint32_t to) {
+    refresh_excess(this->root);
+    return min_boundary(this->root, 0, size(), 0, from + 1, to + 1);
+}
+
+// position of the first run of k consecutive bits with the given value (-1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::find_first_run(uint32_t k, bool value) {
+    if (k == 0) {
+        std::cout << "Invalid length for run operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+    uint32_t nums = size();
+    uint32_t carry = 0;
+    refresh_runs(this->root, nums);
+    return fwd_run(this->root, 0, nums, 0, k, value, &carry);
+}
+
+// position of the run of k consecutive bits with the given value whose start is closest to index
+// (-1 if there is none; on a tie the run behind index is preferred)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::find_run_near(uint32_t index, uint32_t k, bool value) {
+    if (k == 0) {
+        std::cout << "Invalid length for run operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+    uint32_t nums = size();
+    index = std::min(index, nums);
+    refresh_runs(this->root, nums);
+
+    uint32_t carry = 0;
+    uint32_t after = fwd_run(this->root, 0, nums, index, k, value, &carry);
+    carry = 0;
+    uint32_t before = bwd_run(this->root, 0, nums, std::min((uint64_t) index + k, (uint64_t) nums), k, value, &carry);
+    if (before == (uint32_t) -1)
+        return after;
+    if (after == (uint32_t) -1)
+        return before;
+    return after - index <= index - before ? after : before;
+}
+
+// find the first run of k zeros and set all of its bits (allocation in a bitmap of free zeros)
+// returns the start of the run or -1 if there is no run of k zeros
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::claim_run(uint32_t k) {
+    uint32_t start = find_first_run(k, false);
+    if (start != (uint32_t) -1)
+        fill(start, k, true);
+    return start;
+}
+
+// hash of all bits of the bitvector; bitvectors with the same bits have the same hash regardless of their tree
+template <size_t S, uint8_t F>
+uint64_t BitVector<S, F>::hash() {
+    refresh_hash(this->root, size());
+    return this->root->hash;
+}
+
+// check whether both bitvectors hold the same bits by comparing their hashes
+// (constant time once the hashes of the updated subtrees were recomputed)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::equals(BitVector<S, F> &other) {
+    return size() == other.size() && hash() == other.hash();
+}
+
+// ranges [from, to) of the positions in which the bitvectors differ (bits behind the end of the shorter one differ)
+// only subtrees whose hash differs from the hash of the same range of the other bitvector are visited
+template <size_t S, uint8_t F>
+std::vector<std::pair<uint32_t, uint32_t>> BitVector<S, F>::diff(BitVector<S, F> &other) {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    uint32_t nums = size();
+    uint32_t other_nums = other.size();
+    refresh_hash(this->root, nums);
+    refresh_hash(other.root, other_nums);
+
+    uint32_t common = std::min(nums, other_nums);
+    diff(this->root, 0, nums, other, common, &ranges);
+    if (nums != other_nums) {
+        if (!ranges.empty() && ranges.back().second == common)
+            ranges.back().second = std::max(nums, other_nums);
+        else
+            ranges.push_back({common, std::max(nums, other_nums)});
+    }
+    return ranges;
+}
+
+// bitwise operations with another bitvector of the same size; the result is stored in this bitvector
+template <size_t S, uint8_t F>
+void BitVector<S, F>::and_with(const BitVector<S, F> &other) {
+    combine(other, [](std::bitset<S> &x, const std::bitset<S> &y) { x &= y; });
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::or_with(const BitVector<S, F> &other) {
+    combine(other, [](std::bitset<S> &x, const std::bitset<S> &y) { x |= y; });
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::xor_with(const BitVector<S, F> &other) {
+    combine(other, [](std::bitset<S> &x, const std::bitset<S> &y) { x ^= y; });
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::andnot_with(const BitVector<S, F> &other) {
+    combine(other, [](std::bitset<S> &x, const std::bitset<S> &y) { x &= ~y; });
+}
+
+// bitwise operations of two bitvectors of the same size; the result is a new bitvector (a and b are not changed)
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::and_of(const BitVector<S, F> &a, const BitVector<S, F> &b) {
+    BitVector<S, F> result;
+    result.combine(a, b, [](std::bitset<S> &x, const std::bitset<S> &y) { x &= y; });
+    return result;
+}
+
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::or_of(const BitVector<S, F> &a, const BitVector<S, F> &b) {
+    BitVector<S, F> result;
+    result.combine(a, b, [](std::bitset<S> &x, const std::bitset<S> &y) { x |= y; });
+    return result;
+}
+
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::xor_of(const BitVector<S, F> &a, const BitVector<S, F> &b) {
+    BitVector<S, F> result;
+    result.combine(a, b, [](std::bitset<S> &x, const std::bitset<S> &y) { x ^= y; });
+    return result;
+}
+
+template <size_t S, uint8_t F>
+BitVector<S, F> BitVector<S, F>::andnot_of(const BitVector<S, F> &a, const BitVector<S, F> &b) {
+    BitVector<S, F> result;
+    result.combine(a, b, [](std::bitset<S> &x, const std::bitset<S> &y) { x &= ~y; });
+    return result;
+}
+
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::operator[](uint32_t index) {
+    return access(index);
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::operator~() {
     complement(this->root);
 }
 
 // nserts the provided value (either 0 or 1) into the bitvector at the given index
 // in case the leaf of the insertion block is full this node needs to be split
-template <size_t S>
-BV_Node<S> *BitVector<S>::insert(BV_Node<S> *node, uint32_t index, bool value) {
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::insert(BV_Node<S, F> *node, uint32_t index, bool value) {
     if (!node)
-        node = new BV_Node<S>;
+        node = this->create();
 
     // find the block where the index is located (updates index accordingly)
-    BV_Node<S> *leaf = find_block(node, &index);
+    BV_Node<S, F> *leaf = find_block(node, &index);
 
     if (index > BLOCK_SIZE) {
         std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
         return node;
     }
-    
+
+    this->root = node;
+    insert_block(leaf, index, value);
+    return this->root;
+}
+
+// insert the value at index into the leaf
+// returns true if the leaf had to be split (the tree structure changed)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::insert_block(BV_Node<S, F> *leaf, uint32_t index, bool value) {
+    bool split = false;
+
     // block is full; a split is required
     // it might be necessary to balance the tree afterwards
     if (leaf->nums >= BLOCK_SIZE) {
-        this->split_block(leaf);
+        leaf = this->split_block(leaf);
         leaf = find_block(leaf, &index);
-        node = this->fix_tree(leaf);
+        this->root = this->fix_tree(leaf);
+        split = true;
     }
 
     // update the data of the node to include the new bit
     // propagate the changes up the tree
-    std::bitset<S> msb = *leaf->data & ~(FULL_MASK >> index);
-    std::bitset<S> lsb = *leaf->data & (FULL_MASK >> index);
-    std::bitset<S> new_bit;
-    if (value)
-        new_bit.set(BLOCK_SIZE - index - 1);
-    *leaf->data = msb | new_bit | (lsb >> 1);
+    shift_in(leaf, index, value);
     propagate_update(leaf, NULL, (uint64_t) 1 + std::max((int64_t) 0, (int64_t) index-leaf->nums), value ? 1 : 0);
-    return node;
+    return split;
+}
+
+// shift the bits at and behind index one position to the back and store value at index
+// only the words between index and the end of the leaf are touched (one bit is carried across word boundaries)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::shift_in(BV_Node<S, F> *leaf, uint32_t index, bool value) {
+    uint64_t *words = block_words(leaf->data);
+    uint32_t bit = BLOCK_SIZE - index - 1;
+    uint32_t top = bit / 64;
+    uint32_t low = (BLOCK_SIZE - std::max<uint32_t>(leaf->nums, index) - 1) / 64;
+
+    uint64_t word = words[top];
+    uint64_t keep = bit % 64 == 63 ? 0 : ~0ULL << (bit % 64 + 1);
+    uint64_t carry = word & 1;
+    words[top] = (word & keep) | ((word & ~keep) >> 1) | ((uint64_t) value << (bit % 64));
+    for (uint32_t i = top; i-- > low;) {
+        word = words[i];
+        words[i] = (word >> 1) | (carry << 63);
+        carry = word & 1;
+    }
+}
+
+// remove the bit at index by shifting the bits behind it one position to the front; returns the removed bit
+// only the words between index and the end of the leaf are touched (one bit is carried across word boundaries)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::shift_out(BV_Node<S, F> *leaf, uint32_t index) {
+    uint64_t *words = block_words(leaf->data);
+    uint32_t bit = BLOCK_SIZE - index - 1;
+    uint32_t top = bit / 64;
+    uint32_t low = (BLOCK_SIZE - leaf->nums) / 64;
+
+    uint64_t carry = 0;
+    for (uint32_t i = low; i < top; i++) {
+        uint64_t word = words[i];
+        words[i] = (word << 1) | carry;
+        carry = word >> 63;
+    }
+    uint64_t word = words[top];
+    uint64_t keep = bit % 64 == 63 ? 0 : ~0ULL << (bit % 64 + 1);
+    uint64_t below = word & ((1ULL << (bit % 64)) - 1);
+    words[top] = (word & keep) | (below << 1) | carry;
+    return (word >> (bit % 64)) & 1;
 }
 
 // remove the bit specified by the index from the bitvector 
 // in case the resulting leaf has too few elements it is required to steal bits or merge with another leaf
-template <size_t S>
-BV_Node<S> *BitVector<S>::del(BV_Node<S> *node, uint32_t index) {
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::del(BV_Node<S, F> *node, uint32_t index) {
     // finds the block where the index is located (updates index accordingly)
-    BV_Node<S> *leaf = find_block(node, &index);
+    BV_Node<S, F> *leaf = find_block(node, &index);
 
     if (index < 0 || index >= BLOCK_SIZE) {
         std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
         return node;
     }
 
+    this->root = node;
+    del_block(leaf, index);
+    return this->root;
+}
+
+// remove the bit at index from the leaf
+// returns true if bits were stolen from or merged with a 'neighbour' leaf (the tree structure changed)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::del_block(BV_Node<S, F> *leaf, uint32_t index) {
     // update the data of the node to exclude the bit
     // propagate the changes up the tree
-    std::bitset<S> msb = *leaf->data & ~(FULL_MASK >> index);
-    std::bitset<S> lsb = *leaf->data & (FULL_MASK >> (index + 1));
-    int8_t value  = (*leaf->data)[BLOCK_SIZE - index - 1] == 0 ? 0 : -1;
-    *leaf->data = msb | (lsb << 1);
+    int8_t value = shift_out(leaf, index) ? -1 : 0;
     propagate_update(leaf, NULL, -1, value);
+    return this->fix_underflow(leaf, LOWER_BOUND, SPLIT_BOUND);
+}
 
-    if (leaf->nums > LOWER_BOUND)
-        return node;
-
-    BV_Node<S> *prev = this->prev_leaf(leaf);
-    BV_Node<S> *next = this->next_leaf(leaf);
-
-    // if there are no other leafs just return; nothing to do
-    if (!prev && !next)
-        return node;
-
-    if (prev && !next) {                     // use the previous leaf for stealing / merging
-        if (prev->nums >= SPLIT_BOUND)
-            steal_left(leaf, prev);          // steal from the previous leaf (since it has sufficient bits)
-        else
-            return this->merge_left(leaf, prev);   // merge with previous leaf
-        return node;
-    } else if (!prev && next) {              // use the next leaf for stealing / merging
-        if (next->nums >= SPLIT_BOUND)
-            steal_right(leaf, next);         // steal from the next leaf (since it has sufficient bits)
-        else
-            return this->merge_right(leaf, next);  // merge with next leaf
-        return node;
+// apply a batch of inserts and deletes that is sorted by index
+// the index of every update refers to the bitvector with all previous updates of the batch applied
+// the batch is distributed over the tree in a single descent (the updates of a leaf are shifted into its block one after
+// another and every counter on the way is corrected once); only a full leaf or a leaf that has to be refilled interrupts
+// the descent, the structure is fixed and the remaining updates are applied with a new descent
+template <size_t S, uint8_t F>
+void BitVector<S, F>::apply(const std::vector<BV_Update> &updates) {
+    for (uint32_t k = 0; k < updates.size();) {
+        uint32_t first = k;
+        BV_Node<S, F> *pending = NULL;
+        int32_t nums = 0;
+        int32_t ones = 0;
+        if (this->root)
+            apply(this->root, updates, &k, 0, size(), &nums, &ones, &pending);
+
+        if (pending && pending->nums <= LOWER_BOUND) {
+            this->fix_underflow(pending, LOWER_BOUND, SPLIT_BOUND);
+        } else if (k == first) {
+            // the leaf of the update is full (or the update is out of range)
+            if (updates[k].insert && updates[k].index <= size())
+                this->root = insert(this->root, updates[k].index, updates[k].value);
+            else
+                std::cout << "Invalid index for apply operation (skipping operation)" << std::endl;
+            k++;
+        }
     }
+}
 
-    if (prev->nums >= SPLIT_BOUND || next->nums >= SPLIT_BOUND) { // steal bits since both 'neighbour' leafs have enought bits
-        if (prev->nums > next->nums) {
-            steal_left(leaf, prev);                               // steal left since it has more bits
-        } else {
-            steal_right(leaf, next);                              // steal right since it has more bits
+// apply the updates from *k on that fall into the subtree of node (which holds the bits start .. start + size - 1)
+// *nums and *ones are set to the change of the counters of the subtree; pending is set to a leaf that is full
+// or that has to be refilled, the descent stops there since fixing the leaf changes the structure of the tree
+template <size_t S, uint8_t F>
+void BitVector<S, F>::apply(BV_Node<S, F> *node, const std::vector<BV_Update> &updates, uint32_t *k, uint32_t start,
+                            uint32_t size, int32_t *nums, int32_t *ones, BV_Node<S, F> **pending) {
+    // inserts may append to the subtree, deletes have to address one of its bits
+    auto fits = [&](uint32_t begin, uint32_t length) {
+        const BV_Update &update = updates[*k];
+        if (update.index < begin)
+            return false;
+        return update.insert ? update.index - begin <= length : update.index - begin < length;
+    };
+    uint32_t first = *k;
+
+    this->record(node);
+    if (this->is_leaf(node)) {
+        for (; *k < updates.size() && fits(start, node->nums); (*k)++) {
+            uint32_t offset = updates[*k].index - start;
+            if (updates[*k].insert) {
+                if (node->nums >= BLOCK_SIZE) {
+                    *pending = node;
+                    break;
+                }
+                shift_in(node, offset, updates[*k].value);
+                node->nums++;
+                node->ones += updates[*k].value;
+                (*nums)++;
+                *ones += updates[*k].value;
+            } else {
+                bool value = shift_out(node, offset);
+                node->nums--;
+                node->ones -= value;
+                (*nums)--;
+                *ones -= value;
+            }
         }
-        return node;
-    } else {                                                      // both 'neighbour' leafs have only few bits
-        if (prev->nums < next->nums) {
-            return this->merge_left(leaf, prev);                        // merge left since it has less bits
-        } else {
-            return this->merge_right(leaf, next);                       // merge right since it has less bits
+        if (*k > first) {
+            node->invalidate();
+            if (node->nums <= LOWER_BOUND && node != this->root)
+                *pending = node;
         }
+        return;
     }
-    return node;
+
+    uint32_t left_size = node->nums;
+    if (*k < updates.size() && fits(start, left_size)) {
+        int32_t left_nums = 0;
+        int32_t left_ones = 0;
+        apply(node->l, updates, k, start, left_size, &left_nums, &left_ones, pending);
+        node->nums += left_nums;
+        node->ones += left_ones;
+        *nums += left_nums;
+        *ones += left_ones;
+    }
+    if (!*pending && *k < updates.size() && fits(start + node->nums, size - left_size))
+        apply(node->r, updates, k, start + node->nums, size - left_size, nums, ones, pending);
+    if (*k > first)
+        node->invalidate();
 }
 
 // flip the content of the bit addressed by index
-template <size_t S>
-void BitVector<S>::flip(BV_Node<S> *node, uint32_t index) {
-    BV_Node<S> *leaf = find_block(node, &index);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::flip(BV_Node<S, F> *node, uint32_t index) {
+    BV_Node<S, F> *leaf = find_block(node, &index);
 
     int8_t value = (*leaf->data)[BLOCK_SIZE - index - 1] > 0 ? -1 : 1;
     (*leaf->data).flip(BLOCK_SIZE - index - 1);
@@ -218,9 +1039,9 @@ void BitVector<S>::flip(BV_Node<S> *node, uint32_t index) {
 }
 
 // set the bit addressed by index
-template <size_t S>
-void BitVector<S>::set(BV_Node<S> *node, uint32_t index) {
-    BV_Node<S> *leaf = find_block(node, &index);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::set(BV_Node<S, F> *node, uint32_t index) {
+    BV_Node<S, F> *leaf = find_block(node, &index);
 
     int8_t value = (*leaf->data)[BLOCK_SIZE - index - 1] > 0 ? 0 : 1;
     (*leaf->data).set(BLOCK_SIZE - index - 1);
@@ -228,9 +1049,9 @@ void BitVector<S>::set(BV_Node<S> *node, uint32_t index) {
 }
 
 // unset the bit addressed by index
-template <size_t S>
-void BitVector<S>::unset(BV_Node<S> *node, uint32_t index) {
-    BV_Node<S> *leaf = find_block(node, &index);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::unset(BV_Node<S, F> *node, uint32_t index) {
+    BV_Node<S, F> *leaf = find_block(node, &index);
 
     int8_t value = (*leaf->data)[BLOCK_SIZE - index - 1] > 0 ? -1 : 0;
     (*leaf->data).reset(BLOCK_SIZE - index - 1);
@@ -238,9 +1059,10 @@ void BitVector<S>::unset(BV_Node<S> *node, uint32_t index) {
 }
 
 // calculate the number of occurrences of value in the bitvector up to index
-template <size_t S>
-uint32_t BitVector<S>::rank(BV_Node<S> *node, uint32_t index, bool value) {
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::rank(BV_Node<S, F> *node, uint32_t index, bool value) {
     if (this->is_leaf(node)) {
+        count_hit(node);
         std::bitset<S> data = *node->data & ~(FULL_MASK >> index);
         return value ? data.count() : std::min(node->nums, (uint32_t) index) - data.count();
     }
@@ -254,20 +1076,16 @@ uint32_t BitVector<S>::rank(BV_Node<S> *node, uint32_t index, bool value) {
 }
 
 // calculate the index of the num'th occurrence of value in the bitvector
-template <size_t S>
-uint32_t BitVector<S>::select(BV_Node<S> *node, uint32_t num, bool value) {
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::select(BV_Node<S, F> *node, uint32_t num, bool value) {
     if (this->is_leaf(node)) {
-        if ((value ? node->ones : node->nums - node->ones) < num) {
+        if (num == 0 || (value ? node->ones : node->nums - node->ones) < num) {
             std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
             return -1;
         }
 
-        uint32_t count = 0;
-        std::bitset<S> data = *node->data;
-        for (uint32_t i = 0; i < node->nums; i++) {
-            if (((data[BLOCK_SIZE - i - 1] > 0) == value) && ++count == num)
-                return i;
-        }
+        count_hit(node);
+        return select_block(node, num, value);
     }
 
     uint32_t num_val = value ? node->ones : node->nums - node->ones;
@@ -279,19 +1097,22 @@ uint32_t BitVector<S>::select(BV_Node<S> *node, uint32_t num, bool value) {
 }
 
 // return the bit that is located at index in the bitvector
-template <size_t S>
-bool BitVector<S>::access(BV_Node<S> *node, uint32_t index) {
-    node = find_block(node, &index);
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::access(BV_Node<S, F> *node, uint32_t index) {
+    uint32_t ones = 0;
+    node = query_block(node, &index, &ones);
+    count_hit(node);
     return (*node->data)[BLOCK_SIZE - index - 1] > 0;
 }
 
 // invert the bitvector so that each 0 becomes a 1 and vice versa
-template <size_t S>
-void BitVector<S>::complement(BV_Node<S> *node) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::complement(BV_Node<S, F> *node) {
     if (!node)
         return;
 
     node->ones = node->nums - node->ones;
+    node->invalidate();
     if (this->is_leaf(node)) {
         *node->data = (*node->data).flip() & ~(FULL_MASK >> node->nums);
     } else {
@@ -301,8 +1122,8 @@ void BitVector<S>::complement(BV_Node<S> *node) {
 }
 
 // calculate the number of bits that are stored in the structure
-template <size_t S>
-uint32_t BitVector<S>::size(BV_Node<S> *node) {
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::size(BV_Node<S, F> *node) {
     if (!node)
         return 0;
     return node->nums + size(node->r);
@@ -310,8 +1131,9 @@ uint32_t BitVector<S>::size(BV_Node<S> *node) {
 
 // find the node (always a leaf) that contains the bit at the position index
 // index is updated as well to locate the bit inside the leaf block
-template <size_t S>
-BV_Node<S> *BitVector<S>::find_block(BV_Node<S> *node, uint32_t* index) {
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::find_block(BV_Node<S, F> *node, uint32_t* index) {
+    this->record(node);
     if (this->is_leaf(node))
         return node;
     if (*index < node->nums)
@@ -320,133 +1142,1156 @@ BV_Node<S> *BitVector<S>::find_block(BV_Node<S> *node, uint32_t* index) {
     return find_block(node->r, index);
 }
 
-// propagate changes in nodes up the tree to keep the navigation structure correct
-template <size_t S>
-void BitVector<S>::propagate_update(BV_Node<S> *node, BV_Node<S> *prev_node, int32_t nums, int32_t ones) {
+// find the leaf that contains the bit at the position index and count the ones in front of that leaf
+// index is updated as well to locate the bit inside the leaf block
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::find_block(BV_Node<S, F> *node, uint32_t* index, uint32_t* ones) {
+    this->record(node);
+    if (this->is_leaf(node))
+        return node;
+    if (*index < node->nums)
+        return find_block(node->l, index, ones);
+    *index -= node->nums;
+    *ones += node->ones;
+    return find_block(node->r, index, ones);
+}
+
+// find_block for the queries: the descent is not recorded (see AVL::record), so queries from several threads do not
+// write to the tree
+template <size_t S, uint8_t F>
+BV_Node<S, F> *BitVector<S, F>::query_block(BV_Node<S, F> *node, uint32_t *index, uint32_t *ones) {
+    while (!this->is_leaf(node)) {
+        if (*index < node->nums) {
+            node = node->l;
+        } else {
+            *index -= node->nums;
+            *ones += node->ones;
+            node = node->r;
+        }
+    }
+    return node;
+}
+
+// add the memory used by node and its subtree to memory
+template <size_t S, uint8_t F>
+void BitVector<S, F>::memory_usage(BV_Node<S, F> *node, BV_Memory *memory) {
     if (!node)
         return;
 
-    if (node->l == prev_node) {
-        node->nums += nums;
-        node->ones += ones;
+    // the slabs (and the node array) are accounted as a whole, only their unused part counts as overhead
+    #ifdef ADS_COMPACT_NODES
+    memory->allocator_overhead_bytes -= sizeof(BV_Node<S, F>);
+    if (node->pooled && node->data)
+        memory->allocator_overhead_bytes -= sizeof(std::bitset<S>);
+    #else
+    if (node->pooled)
+        memory->allocator_overhead_bytes -= sizeof(BV_Node<S, F>) + (node->data ? sizeof(std::bitset<S>) : 0);
+    else
+        memory->allocator_overhead_bytes += allocated_bytes(node, sizeof(BV_Node<S, F>)) - sizeof(BV_Node<S, F>);
+    #endif
+    if (!node->pooled && node->data)
+        memory->allocator_overhead_bytes += allocated_bytes(node->data, sizeof(std::bitset<S>)) - sizeof(std::bitset<S>);
+
+    if (this->is_leaf(node)) {
+        memory->leaves++;
+        memory->bits += node->nums;
+        memory->slack_bits += BLOCK_SIZE - node->nums;
+        memory->leaf_node_bytes += sizeof(BV_Node<S, F>);
+        memory->leaf_payload_bytes += sizeof(std::bitset<S>);
+        memory->fill_histogram[std::min((size_t) 9, node->nums * 10 / BLOCK_SIZE)]++;
+        return;
+    }
+
+    memory->inner_nodes++;
+    memory->inner_node_bytes += sizeof(BV_Node<S, F>);
+    if (node->data)
+        memory->inner_payload_bytes += sizeof(std::bitset<S>);
+    memory_usage(node->l, memory);
+    memory_usage(node->r, memory);
+}
+
+// copy count bits (at most one block) starting at offset in the leaf at the end of path and continuing in the
+// following leaves to the front of block; path and offset are advanced behind the copied bits
+template <size_t S, uint8_t F>
+void BitVector<S, F>::read_block(AVL_Path<BV_Node<S, F>> *path, uint32_t *offset, uint32_t count, std::bitset<S> *block) {
+    BV_Node<S, F> *leaf = path->back();
+    // the leaves are aligned, the block can be copied as a whole
+    if (*offset == 0 && leaf->nums == count) {
+        *block = *leaf->data;
+        *offset = count;
+        return;
+    }
+
+    block->reset();
+    uint32_t filled = 0;
+    while (filled < count) {
+        if (*offset == leaf->nums) {
+            leaf = this->next_leaf(path);
+            *offset = 0;
+            continue;
+        }
+        uint32_t bits = std::min(count - filled, leaf->nums - *offset);
+        *block |= ((*leaf->data << *offset) & ~(FULL_MASK >> bits)) >> filled;
+        filled += bits;
+        *offset += bits;
+    }
+}
+
+// find the first occurrence of value at or after offset inside the leaf (returns nums if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::next_in_block(BV_Node<S, F> *leaf, uint32_t offset, bool value) {
+    if (offset >= leaf->nums)
+        return leaf->nums;
+
+    // increasing positions are stored at decreasing bit indices
+    uint64_t *words = block_words(leaf->data);
+    uint32_t bit = BLOCK_SIZE - offset - 1;
+    int32_t w = bit / 64;
+    uint64_t word = (value ? words[w] : ~words[w]) & (~0ULL >> (63 - bit % 64));
+    while (!word && --w >= 0)
+        word = value ? words[w] : ~words[w];
+    if (!word)
+        return leaf->nums;
+
+    uint32_t pos = BLOCK_SIZE - 1 - (w * 64 + 63 - std::countl_zero(word));
+    return std::min(pos, leaf->nums);           // the unused bits count as zeros
+}
+
+// find the last occurrence of value at or before offset inside the leaf (returns -1 if there is none)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::prev_in_block(BV_Node<S, F> *leaf, uint32_t offset, bool value) {
+    if (leaf->nums == 0)
+        return -1;
+    offset = std::min(offset, leaf->nums - 1);
+
+    const uint32_t WORDS = (S + 63) / 64;
+    uint64_t *words = block_words(leaf->data);
+    uint32_t bit = BLOCK_SIZE - offset - 1;
+    uint32_t w = bit / 64;
+    uint64_t word = (value ? words[w] : ~words[w]) & (~0ULL << (bit % 64));
+    while (!word && ++w < WORDS)
+        word = value ? words[w] : ~words[w];
+    if (!word)
+        return -1;
+
+    uint32_t index = w * 64 + std::countr_zero(word);
+    return index < BLOCK_SIZE ? BLOCK_SIZE - 1 - index : -1;
+}
+
+// find the position of the num'th occurrence of value inside the leaf using word wise popcounts
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::select_block(BV_Node<S, F> *leaf, uint32_t num, bool value) {
+    const uint32_t WORDS = (S + 63) / 64;
+    uint64_t *words = block_words(leaf->data);
+    for (int32_t w = WORDS - 1; w >= 0; w--) {
+        uint64_t word = value ? words[w] : ~words[w];
+        if (w == WORDS - 1 && S % 64)
+            word &= (1ULL << (S % 64)) - 1;     // drop the bits above the block
+        uint32_t count = std::popcount(word);
+        if (num > count) {
+            num -= count;
+            continue;
+        }
+        while (--num)
+            word &= ~(1ULL << (63 - std::countl_zero(word)));
+        return BLOCK_SIZE - 1 - (w * 64 + 63 - std::countl_zero(word));
+    }
+    return -1;
+}
+
+// find the first occurrence of value at or after index
+// the containing leaf and its successor are scanned word wise, beyond that the counters in the tree are used
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::next_bit(uint32_t index, bool value) {
+    uint32_t offset = index;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset);
+    if (offset >= leaf->nums)
+        return -1;
+
+    uint32_t start = index - offset;
+    uint32_t pos = next_in_block(leaf, offset, value);
+    if (pos < leaf->nums)
+        return start + pos;
+
+    start += leaf->nums;
+    leaf = this->next_leaf(leaf);
+    if (!leaf)
+        return -1;
+    pos = next_in_block(leaf, 0, value);
+    if (pos < leaf->nums)
+        return start + pos;
+
+    start += leaf->nums;
+    uint32_t bits = size();
+    uint32_t before = rank(start, value);
+    uint32_t total = rank(bits, value);
+    return before < total ? select(before + 1, value) : -1;
+}
+
+// find the last occurrence of value at or before index
+// the containing leaf and its predecessor are scanned word wise, beyond that the counters in the tree are used
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::prev_bit(uint32_t index, bool value) {
+    uint32_t bits = size();
+    if (bits == 0)
+        return -1;
+    index = std::min(index, bits - 1);
+
+    uint32_t offset = index;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset);
+    uint32_t start = index - offset;
+    uint32_t pos = prev_in_block(leaf, offset, value);
+    if (pos != (uint32_t) -1)
+        return start + pos;
+
+    leaf = this->prev_leaf(leaf);
+    if (!leaf)
+        return -1;
+    start -= leaf->nums;
+    pos = prev_in_block(leaf, leaf->nums - 1, value);
+    if (pos != (uint32_t) -1)
+        return start + pos;
+
+    uint32_t before = rank(start, value);
+    return before > 0 ? select(before, value) : -1;
+}
+
+// iterate over the ones in the subtree of top (the end iterator if top is NULL)
+template <size_t S, uint8_t F>
+BitVector<S, F>::OnesIterator::OnesIterator(BitVector<S, F> *bv, BV_Node<S, F> *top) : bv(bv), offset(0), start(0) {
+    leaf = top ? bv->first_leaf(top, &path) : NULL;
+    skip();
+}
+
+// move to the next one at or after the current position; leaves without ones are skipped entirely
+template <size_t S, uint8_t F>
+void BitVector<S, F>::OnesIterator::skip() {
+    while (leaf) {
+        if (leaf->ones > 0) {
+            offset = bv->next_in_block(leaf, offset, true);
+            if (offset < leaf->nums)
+                return;
+        }
+        start += leaf->nums;
+        offset = 0;
+        leaf = bv->next_leaf(&path);
     }
+}
+
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::OnesIterator::operator*() {
+    return start + offset;
+}
+
+template <size_t S, uint8_t F>
+typename BitVector<S, F>::OnesIterator &BitVector<S, F>::OnesIterator::operator++() {
+    offset++;
+    skip();
+    return *this;
+}
+
+template <size_t S, uint8_t F>
+typename BitVector<S, F>::OnesIterator BitVector<S, F>::OnesIterator::operator++(int) {
+    OnesIterator it = *this;
+    ++*this;
+    return it;
+}
+
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::OnesIterator::operator==(const OnesIterator &other) {
+    return leaf == other.leaf && (!leaf || offset == other.offset);
+}
+
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::OnesIterator::operator!=(const OnesIterator &other) {
+    return !(*this == other);
+}
+
+// apply op to the blocks of this bitvector and the position wise matching bits of other
+// (the unused bits of all blocks are zero, so none of the operations can set them)
+// the counters of the inner nodes are recomputed afterwards in a single bottom up pass
+template <size_t S, uint8_t F>
+template <typename Op>
+void BitVector<S, F>::combine(const BitVector<S, F> &other, Op op) {
+    if (size() != size(other.root)) {
+        std::cout << "Bitvectors of different size for bitwise operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    AVL_Path<BV_Node<S, F>> path;
+    AVL_Path<BV_Node<S, F>> other_path;
+    BV_Node<S, F> *leaf = this->first_leaf(this->root, &path);
+    this->first_leaf(other.root, &other_path);
+    uint32_t offset = 0;
+
+    std::bitset<S> block;
+    for (; leaf; leaf = this->next_leaf(&path)) {
+        read_block(&other_path, &offset, leaf->nums, &block);
+        op(*leaf->data, block);
+        leaf->ones = (*leaf->data).count();
+    }
+
+    uint32_t nums, ones;
+    recount(this->root, &nums, &ones);
+}
+
+// replace the content of this bitvector by the result of applying op to the bits of a and b
+// the result is built with evenly filled leaves in a perfectly balanced tree
+template <size_t S, uint8_t F>
+template <typename Op>
+void BitVector<S, F>::combine(const BitVector<S, F> &a, const BitVector<S, F> &b, Op op) {
+    uint32_t bits = size(a.root);
+    if (bits != size(b.root)) {
+        std::cout << "Bitvectors of different size for bitwise operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    // locate the first leaves of a and b before the tree of this bitvector is replaced
+    AVL_Path<BV_Node<S, F>> path_a;
+    AVL_Path<BV_Node<S, F>> path_b;
+    this->first_leaf(a.root, &path_a);
+    this->first_leaf(b.root, &path_b);
+    uint32_t offset_a = 0;
+    uint32_t offset_b = 0;
+
+    uint32_t num_leafs = (bits + TARGET_SIZE - 1) / TARGET_SIZE;
+    this->reserve(2 * num_leafs);   // the old root has to stay in place while the new tree is built
+    BV_Node<S, F> *old_root = this->root;
+    this->root = this->create();
+    this->build_balanced_tree(NULL, num_leafs);
+    AVL_Path<BV_Node<S, F>> path;
+    BV_Node<S, F> *leaf = this->first_leaf(this->root, &path);
+
+    std::bitset<S> block;
+    for (uint32_t i = 0; i < num_leafs; i++) {
+        leaf->nums = (uint64_t) bits * (i + 1) / num_leafs - (uint64_t) bits * i / num_leafs;
+        read_block(&path_a, &offset_a, leaf->nums, leaf->data);
+        read_block(&path_b, &offset_b, leaf->nums, &block);
+        op(*leaf->data, block);
+        leaf->ones = (*leaf->data).count();
+        leaf = this->next_leaf(&path);
+    }
+    this->release(old_root);
+    this->free_slabs();
+
+    uint32_t nums, ones;
+    recount(this->root, &nums, &ones);
+    compact_cursor = 0;
+}
+
+// recompute the excess summaries of all nodes in the subtree that were marked dirty by updates
+template <size_t S, uint8_t F>
+void BitVector<S, F>::refresh_excess(BV_Node<S, F> *node) {
+    static_assert(F & BV_EXCESS, "the balanced parentheses searches need a bitvector with BV_EXCESS");
+    if (!node->dirty)
+        return;
+
     if (this->is_leaf(node)) {
-        node->height = 1;
+        excess_block(node);
     } else {
-        uint8_t height_l = node->l->height;
-        uint8_t height_r = node->r->height;
-        node->height = 1 + (height_l > height_r ? height_l : height_r);
+        refresh_excess(node->l);
+        refresh_excess(node->r);
+        BP_Excess &l = node->l->bp;
+        BP_Excess &r = node->r->bp;
+        node->bp.excess = l.excess + r.excess;
+        node->bp.min = std::min(l.min, l.excess + r.min);
+        node->bp.max = std::max(l.max, l.excess + r.max);
     }
-    propagate_update(node->p, node, nums, ones);
+    node->dirty = false;
 }
 
-// update the data in the three nodes (parent and both child nodes) involved in the operation
+// return the byte of the block that holds the positions [pos, pos + 8) (pos is a multiple of 8)
 template <size_t S>
-void BitVector<S>::split_block_update(BV_Node<S> *node, BV_Node<S> *left, BV_Node<S> *right) {
+inline uint8_t block_byte(std::bitset<S> *block, uint32_t pos) {
+    uint32_t bit = S - 8 - pos;
+    return block_words(block)[bit / 64] >> (bit % 64);
+}
+
+// compute the excess summary of the leaf (bytewise using the lookup table)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::excess_block(BV_Node<S, F> *leaf) {
+    BP_Excess bp = {0, 0, 0};
+    uint32_t pos = 0;
+    if (S % 8 == 0) {
+        const BP_Excess *table = bp_byte_table();
+        for (; pos + 8 <= leaf->nums; pos += 8) {
+            const BP_Excess &byte = table[block_byte(leaf->data, pos)];
+            bp.min = std::min(bp.min, bp.excess + byte.min);
+            bp.max = std::max(bp.max, bp.excess + byte.max);
+            bp.excess += byte.excess;
+        }
+    }
+    for (; pos < leaf->nums; pos++) {
+        bp.excess += (*leaf->data)[BLOCK_SIZE - pos - 1] ? 1 : -1;
+        bp.min = std::min(bp.min, bp.excess);
+        bp.max = std::max(bp.max, bp.excess);
+    }
+    leaf->bp = bp;
+}
+
+// scan the leaf from offset onwards until the excess reaches target; cur is the excess in front of offset
+// returns the position after which target is reached (nums if it is not reached, cur is then the excess at the end)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::fwd_block(BV_Node<S, F> *leaf, uint32_t offset, int32_t *cur, int32_t target) {
+    const BP_Excess *table = bp_byte_table();
+    uint32_t pos = offset;
+    while (pos < leaf->nums) {
+        // skip whole bytes that can not contain target
+        if (S % 8 == 0 && pos % 8 == 0 && pos + 8 <= leaf->nums) {
+            const BP_Excess &byte = table[block_byte(leaf->data, pos)];
+            if (target < *cur + byte.min || target > *cur + byte.max) {
+                *cur += byte.excess;
+                pos += 8;
+                continue;
+            }
+        }
+        *cur += (*leaf->data)[BLOCK_SIZE - pos - 1] ? 1 : -1;
+        if (*cur == target)
+            return pos;
+        pos++;
+    }
+    return leaf->nums;
+}
+
+// scan the leaf backwards from end (exclusive) until the excess reaches target; cur is the excess in front of end
+// returns the position in front of which target is reached (-1 if it is not reached, cur is then the excess at the start)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::bwd_block(BV_Node<S, F> *leaf, uint32_t end, int32_t *cur, int32_t target) {
+    const BP_Excess *table = bp_byte_table();
+    uint32_t pos = end;
+    while (pos > 0) {
+        // skip whole bytes that can not contain target
+        if (S % 8 == 0 && pos % 8 == 0) {
+            const BP_Excess &byte = table[block_byte(leaf->data, pos - 8)];
+            int32_t start = *cur - byte.excess;
+            if (target < start + byte.min || target > start + byte.max) {
+                *cur = start;
+                pos -= 8;
+                continue;
+            }
+        }
+        pos--;
+        *cur -= (*leaf->data)[BLOCK_SIZE - pos - 1] ? 1 : -1;
+        if (*cur == target)
+            return pos;
+    }
+    return -1;
+}
+
+// calculate the position of the first bit of the leaf
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::leaf_start(BV_Node<S, F> *node) {
+    uint32_t start = 0;
+    for (BV_Node<S, F> *parent = this->parent(node); parent; node = parent, parent = this->parent(node))
+        if (parent->r == node)
+            start += parent->nums;
+    return start;
+}
+
+// find the smallest boundary (number of bits in front of a position) after boundary at which the excess equals target
+// the leaf is scanned first, afterwards the tree is climbed until a right sibling subtree contains target and then descended
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::fwd_boundary(uint32_t boundary, int32_t target) {
+    refresh_excess(this->root);
+
+    uint32_t offset = boundary;
+    uint32_t ones = 0;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset, &ones);
+    if (offset >= leaf->nums)
+        return -1;
+    ones += (*leaf->data & ~(FULL_MASK >> offset)).count();
+    int32_t cur = 2 * (int32_t) ones - (int32_t) boundary;
+
+    uint32_t pos = fwd_block(leaf, offset, &cur, target);
+    if (pos < leaf->nums)
+        return boundary - offset + pos + 1;
+
+    for (BV_Node<S, F> *node = leaf, *parent = this->parent(leaf); parent; node = parent, parent = this->parent(node)) {
+        BV_Node<S, F> *sibling = parent->r;
+        if (sibling == node)
+            continue;
+        if (target < cur + sibling->bp.min || target > cur + sibling->bp.max) {
+            cur += sibling->bp.excess;
+            continue;
+        }
+
+        node = sibling;
+        this->record(node);
+        while (!this->is_leaf(node)) {
+            BP_Excess &l = node->l->bp;
+            if (target >= cur + l.min && target <= cur + l.max) {
+                node = node->l;
+            } else {
+                cur += l.excess;
+                node = node->r;
+            }
+            this->record(node);
+        }
+        return leaf_start(node) + fwd_block(node, 0, &cur, target) + 1;
+    }
+    return -1;
+}
+
+// find the largest boundary in front of boundary at which the excess equals target
+// works like fwd_boundary but climbs until a left sibling subtree contains target
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::bwd_boundary(uint32_t boundary, int32_t target) {
+    if (boundary == 0)
+        return -1;
+    refresh_excess(this->root);
+
+    uint32_t offset = boundary - 1;
+    uint32_t ones = 0;
+    BV_Node<S, F> *leaf = find_block(this->root, &offset, &ones);
+    ones += (*leaf->data & ~(FULL_MASK >> (offset + 1))).count();
+    int32_t cur = 2 * (int32_t) ones - (int32_t) boundary;
+
+    uint32_t pos = bwd_block(leaf, offset + 1, &cur, target);
+    if (pos != (uint32_t) -1)
+        return boundary - 1 - offset + pos;
+
+    for (BV_Node<S, F> *node = leaf, *parent = this->parent(leaf); parent; node = parent, parent = this->parent(node)) {
+        BV_Node<S, F> *sibling = parent->l;
+        if (sibling == node)
+            continue;
+        int32_t start = cur - sibling->bp.excess;
+        if (target < start + sibling->bp.min || target > start + sibling->bp.max) {
+            cur = start;
+            continue;
+        }
+
+        node = sibling;
+        this->record(node);
+        while (!this->is_leaf(node)) {
+            BP_Excess &r = node->r->bp;
+            if (target >= cur - r.excess + r.min && target <= cur - r.excess + r.max) {
+                node = node->r;
+            } else {
+                cur -= r.excess;
+                node = node->l;
+            }
+            this->record(node);
+        }
+        return leaf_start(node) + bwd_block(node, node->nums, &cur, target);
+    }
+    return -1;
+}
+
+// minimum excess at the boundaries in [lo, hi] inside the subtree of node
+// the subtree holds nums bits starting at boundary start and the excess at start is cur
+template <size_t S, uint8_t F>
+int32_t BitVector<S, F>::min_boundary(BV_Node<S, F> *node, uint32_t start, uint32_t nums, int32_t cur, uint32_t lo, uint32_t hi) {
+    if (hi < start || lo > start + nums)
+        return INT32_MAX;
+    if (lo <= start && start + nums <= hi)
+        return cur + node->bp.min;
+
+    if (this->is_leaf(node)) {
+        int32_t min = lo <= start ? cur : INT32_MAX;
+        for (uint32_t pos = 0; pos < nums && start + pos + 1 <= hi; pos++) {
+            cur += (*node->data)[BLOCK_SIZE - pos - 1] ? 1 : -1;
+            if (start + pos + 1 >= lo)
+                min = std::min(min, cur);
+        }
+        return min;
+    }
+
+    return std::min(min_boundary(node->l, start, node->nums, cur, lo, hi),
+                    min_boundary(node->r, start + node->nums, nums - node->nums, cur + node->l->bp.excess, lo, hi));
+}
+
+// recompute the run summaries of all nodes in the subtree that were marked dirty by updates
+// (inner nodes only store the number of bits of their left subtree, so the size of the subtree is passed along)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::refresh_runs(BV_Node<S, F> *node, uint32_t nums) {
+    static_assert(F & BV_RUNS, "the run searches need a bitvector with BV_RUNS");
+    if (!node->runs_dirty)
+        return;
+
+    if (this->is_leaf(node)) {
+        runs_block(node);
+    } else {
+        uint32_t nums_l = node->nums;
+        uint32_t nums_r = nums - node->nums;
+        refresh_runs(node->l, nums_l);
+        refresh_runs(node->r, nums_r);
+        BV_Runs &l = node->l->runs;
+        BV_Runs &r = node->r->runs;
+        for (uint32_t v = 0; v < 2; v++) {
+            node->runs.prefix[v] = l.prefix[v] == nums_l ? nums_l + r.prefix[v] : l.prefix[v];
+            node->runs.suffix[v] = r.suffix[v] == nums_r ? nums_r + l.suffix[v] : r.suffix[v];
+            node->runs.max[v] = std::max({l.max[v], r.max[v], l.suffix[v] + r.prefix[v]});
+        }
+    }
+    node->runs_dirty = false;
+}
+
+// compute the run summary of the leaf (one step per run, the runs are measured word wise)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::runs_block(BV_Node<S, F> *leaf) {
+    BV_Runs runs = {{0, 0}, {0, 0}, {0, 0}};
+    uint64_t *words = block_words(leaf->data);
+    uint32_t start = 0;                                     // start of the current run
+    bool value = leaf->nums && (*leaf->data)[BLOCK_SIZE - 1];
+    for (uint32_t pos = 0; pos < leaf->nums; pos += 64) {
+        uint32_t len = std::min(leaf->nums - pos, 64u);
+        // the bit at position pos becomes the most significant bit of the word
+        uint64_t word = read_bits(words, BLOCK_SIZE - pos - len, len) << (64 - len);
+        for (uint32_t i = 0; i < len;) {
+            i += std::min((uint32_t) std::countl_one((value ? word : ~word) << i), len - i);
+            if (i == len)
+                break;
+            if (start == 0)
+                runs.prefix[value] = pos + i;
+            runs.max[value] = std::max(runs.max[value], pos + i - start);
+            start = pos + i;
+            value = !value;
+        }
+    }
+    if (leaf->nums) {
+        if (start == 0)
+            runs.prefix[value] = leaf->nums;
+        runs.suffix[value] = leaf->nums - start;
+        runs.max[value] = std::max(runs.max[value], leaf->nums - start);
+    }
+    leaf->runs = runs;
+}
+
+// scan the leaf (which starts at position start) from offset onwards for the end of a run of k bits with value
+// carry is the length of the run that ends in front of offset; returns the start of the run or -1 if the leaf ends
+// first (carry is then the length of the run at the end of the leaf)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::fwd_run_block(BV_Node<S, F> *leaf, uint32_t start, uint32_t offset, uint32_t k, bool value, uint32_t *carry) {
+    uint64_t *words = block_words(leaf->data);
+    for (uint32_t pos = offset; pos < leaf->nums;) {
+        uint32_t len = std::min(leaf->nums - pos, 64u);
+        uint64_t word = read_bits(words, BLOCK_SIZE - pos - len, len) << (64 - len);
+        word = value ? word : ~word;
+        uint32_t run = std::min((uint32_t) std::countl_one(word), len);
+        if (*carry + run >= k)
+            return start + pos - *carry;
+        if (run == len) {
+            *carry += len;
+            pos += len;
+            continue;
+        }
+        // skip the run and the following bits with the other value
+        *carry = 0;
+        pos += run + std::min((uint32_t) std::countl_zero(word << run), len - run);
+    }
+    return -1;
+}
+
+// scan the leaf (which starts at position start) backwards from end (exclusive) for the start of a run of k bits
+// with value; carry is the length of the run that starts at end; returns the start of the run or -1 if the leaf
+// starts first (carry is then the length of the run at the start of the leaf)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::bwd_run_block(BV_Node<S, F> *leaf, uint32_t start, uint32_t end, uint32_t k, bool value, uint32_t *carry) {
+    uint64_t *words = block_words(leaf->data);
+    for (uint32_t pos = end; pos > 0;) {
+        uint32_t len = std::min(pos, 64u);
+        // the bit at position pos - 1 becomes the least significant bit of the word
+        uint64_t word = read_bits(words, BLOCK_SIZE - pos, len);
+        word = value ? word : ~word;
+        uint32_t run = std::min((uint32_t) std::countr_one(word), len);
+        if (*carry + run >= k)
+            return start + pos + *carry - k;
+        if (run == len) {
+            *carry += len;
+            pos -= len;
+            continue;
+        }
+        *carry = 0;
+        pos -= run + std::min((uint32_t) std::countr_zero(word >> run), len - run);
+    }
+    return -1;
+}
+
+// find the first run of k bits with value that starts at or behind position from inside the subtree of node
+// the subtree holds nums bits starting at position start, carry is the length of the run in front of the subtree
+// (counted from position from onwards); subtrees whose longest run is too short are skipped using their summary
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::fwd_run(BV_Node<S, F> *node, uint32_t start, uint32_t nums, uint32_t from, uint32_t k, bool value, uint32_t *carry) {
+    if (start + nums <= from)
+        return -1;
+    if (start >= from) {
+        BV_Runs &runs = node->runs;
+        if (*carry + runs.prefix[value] >= k)
+            return start - *carry;
+        if (runs.max[value] < k) {
+            *carry = runs.prefix[value] == nums ? *carry + nums : runs.suffix[value];
+            return -1;
+        }
+    }
+
+    if (this->is_leaf(node))
+        return fwd_run_block(node, start, from > start ? from - start : 0, k, value, carry);
+
+    uint32_t found = fwd_run(node->l, start, node->nums, from, k, value, carry);
+    if (found != (uint32_t) -1)
+        return found;
+    return fwd_run(node->r, start + node->nums, nums - node->nums, from, k, value, carry);
+}
+
+// find the last run of k bits with value that ends in front of position end inside the subtree of node
+// the subtree holds nums bits starting at position start, carry is the length of the run behind the subtree
+// (counted up to position end)
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::bwd_run(BV_Node<S, F> *node, uint32_t start, uint32_t nums, uint32_t end, uint32_t k, bool value, uint32_t *carry) {
+    if (start >= end)
+        return -1;
+    if (start + nums <= end) {
+        BV_Runs &runs = node->runs;
+        if (*carry + runs.suffix[value] >= k)
+            return start + nums + *carry - k;
+        if (runs.max[value] < k) {
+            *carry = runs.suffix[value] == nums ? *carry + nums : runs.prefix[value];
+            return -1;
+        }
+    }
+
+    if (this->is_leaf(node))
+        return bwd_run_block(node, start, std::min(end - start, nums), k, value, carry);
+
+    uint32_t found = bwd_run(node->r, start + node->nums, nums - node->nums, end, k, value, carry);
+    if (found != (uint32_t) -1)
+        return found;
+    return bwd_run(node->l, start, node->nums, end, k, value, carry);
+}
+
+// overwrite len bits starting at index with value (word wise, one propagation per touched leaf)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::fill(uint32_t index, uint32_t len, bool value) {
+    BV_Node<S, F> *leaf = find_block(this->root, &index);
+    while (len > 0 && leaf) {
+        uint32_t count = std::min(len, leaf->nums - index);
+        uint64_t *words = block_words(leaf->data);
+        int32_t ones = 0;
+        for (uint32_t pos = index; pos < index + count; pos += 64) {
+            uint32_t chunk = std::min(index + count - pos, 64u);
+            uint32_t lo = BLOCK_SIZE - pos - chunk;
+            uint64_t bits = value ? (chunk == 64 ? ~0ULL : (1ULL << chunk) - 1) : 0;
+            ones += std::popcount(bits) - std::popcount(read_bits(words, lo, chunk));
+            write_bits(words, lo, chunk, bits);
+        }
+        propagate_update(leaf, NULL, 0, ones);
+        len -= count;
+        index = 0;
+        leaf = this->next_leaf(leaf);
+    }
+}
+
+// recompute the hashes of all nodes in the subtree that were marked dirty by updates
+template <size_t S, uint8_t F>
+void BitVector<S, F>::refresh_hash(BV_Node<S, F> *node, uint32_t nums) {
+    static_assert(F & BV_HASH, "the comparisons need a bitvector with BV_HASH");
+    if (!node->hash_dirty)
+        return;
+
+    if (this->is_leaf(node)) {
+        node->hash = hash_block(node, 0, node->nums);
+    } else {
+        refresh_hash(node->l, node->nums);
+        refresh_hash(node->r, nums - node->nums);
+        node->hash = hash_add(hash_mul(node->l->hash, hash_pow(nums - node->nums)), node->r->hash);
+    }
+    node->hash_dirty = false;
+}
+
+// hash of the positions [from, to) of the leaf (bytewise using the lookup table)
+template <size_t S, uint8_t F>
+uint64_t BitVector<S, F>::hash_block(BV_Node<S, F> *leaf, uint32_t from, uint32_t to) {
+    uint64_t hash = 0;
+    uint32_t pos = from;
+    if (S % 8 == 0) {
+        for (; pos < to && pos % 8; pos++)
+            hash = hash_add(hash_mul(hash, HASH_BASE), (*leaf->data)[BLOCK_SIZE - pos - 1] + 1);
+        const uint64_t *table = hash_byte_table();
+        const uint64_t step = hash_pow(8);
+        for (; pos + 8 <= to; pos += 8)
+            hash = hash_add(hash_mul(hash, step), table[block_byte(leaf->data, pos)]);
+    }
+    for (; pos < to; pos++)
+        hash = hash_add(hash_mul(hash, HASH_BASE), (*leaf->data)[BLOCK_SIZE - pos - 1] + 1);
+    return hash;
+}
+
+// hash of the positions [lo, hi) inside the subtree of node which holds nums bits starting at position start
+// (the hashes of the updated subtrees have to be recomputed already)
+template <size_t S, uint8_t F>
+uint64_t BitVector<S, F>::hash_range(BV_Node<S, F> *node, uint32_t start, uint32_t nums, uint32_t lo, uint32_t hi) {
+    uint32_t from = std::max(lo, start);
+    uint32_t to = std::min(hi, start + nums);
+    if (from >= to)
+        return 0;
+    if (from == start && to == start + nums)
+        return node->hash;
+    if (this->is_leaf(node))
+        return hash_block(node, from - start, to - start);
+
+    uint32_t mid = start + node->nums;
+    uint64_t l = hash_range(node->l, start, node->nums, lo, hi);
+    uint64_t r = hash_range(node->r, mid, nums - node->nums, lo, hi);
+    return hash_add(hash_mul(l, hash_pow(to > mid ? to - std::max(from, mid) : 0)), r);
+}
+
+// collect the differing positions in front of common inside the subtree of node (which holds nums bits starting at
+// position start); subtrees whose hash matches the hash of the same range of the other bitvector are skipped
+template <size_t S, uint8_t F>
+void BitVector<S, F>::diff(BV_Node<S, F> *node, uint32_t start, uint32_t nums, BitVector<S, F> &other, uint32_t common,
+                        std::vector<std::pair<uint32_t, uint32_t>> *ranges) {
+    uint32_t to = std::min(start + nums, common);
+    if (start >= to)
+        return;
+    uint64_t hash = to == start + nums ? node->hash : hash_range(node, start, nums, start, to);
+    if (hash == other.hash_range(other.root, 0, other.size(), start, to))
+        return;
+
+    if (!this->is_leaf(node)) {
+        diff(node->l, start, node->nums, other, common, ranges);
+        diff(node->r, start + node->nums, nums - node->nums, other, common, ranges);
+        return;
+    }
+
+    auto cursor = other.cursor(start);
+    for (uint32_t pos = start; pos < to; pos++, cursor.next()) {
+        if ((*node->data)[BLOCK_SIZE - (pos - start) - 1] == cursor.access())
+            continue;
+        if (!ranges->empty() && ranges->back().second == pos)
+            ranges->back().second++;
+        else
+            ranges->push_back({pos, pos + 1});
+    }
+}
+
+// recompute the navigation data (nums, ones, height) of all inner nodes from the leaves in one bottom up pass
+// the total number of bits and ones in the subtree are returned via nums and ones
+template <size_t S, uint8_t F>
+void BitVector<S, F>::recount(BV_Node<S, F> *node, uint32_t *nums, uint32_t *ones) {
+    node->invalidate();
+    if (this->is_leaf(node)) {
+        node->height = 1;
+        *nums = node->nums;
+        *ones = node->ones;
+        return;
+    }
+
+    uint32_t nums_r, ones_r;
+    recount(node->l, &node->nums, &node->ones);
+    recount(node->r, &nums_r, &ones_r);
+    node->release_data();   // inner nodes created by build_balanced_tree still carry a block
+    node->height = 1 + std::max(node->l->height, node->r->height);
+    *nums = node->nums + nums_r;
+    *ones = node->ones + ones_r;
+}
+
+// propagate changes in nodes up the tree to keep the navigation structure correct
+template <size_t S, uint8_t F>
+void BitVector<S, F>::propagate_update(BV_Node<S, F> *node, BV_Node<S, F> *prev_node, int32_t nums, int32_t ones) {
+    this->propagate(node, prev_node, [&](BV_Node<S, F> *node, bool left) {
+        if (left) {
+            node->nums += nums;
+            node->ones += ones;
+        }
+        node->invalidate();
+    });
+}
+
+// update the data in the three nodes (parent and both child nodes) involved in the operation
+template <size_t S, uint8_t F>
+void BitVector<S, F>::split_block_update(BV_Node<S, F> *node, BV_Node<S, F> *left, BV_Node<S, F> *right) {
     *left->data = *node->data & MSB_MASK;
     *right->data = (*node->data & LSB_MASK) << TARGET_SIZE;
-    delete node->data;
-    node->data = NULL;
+    node->release_data();
     left->nums = TARGET_SIZE;
     right->nums = TARGET_SIZE;
     node->nums = TARGET_SIZE;
     left->ones = (*left->data).count();
     right->ones = (*right->data).count();
     node->ones = left->ones;
+    if constexpr ((F & BV_ADAPT) != 0) {
+        left->hits = node->hits / 2;
+        right->hits = node->hits - left->hits;
+    }
     propagate_update(node, NULL, 0, 0);
 }
 
 // take some bits from the left 'neighbour' leaf and add them to node
 // this ensures that the tree remains balanced; afterwards propagate the changes
-template <size_t S>
-void BitVector<S>::steal_left(BV_Node<S> *node, BV_Node<S> *prev_leaf) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::steal_left(BV_Node<S, F> *node, BV_Node<S, F> *prev_leaf) {
     uint32_t steal_bits = (prev_leaf->nums - node->nums) / 2;
-    std::bitset<S> steal_data = (*prev_leaf->data) >> (BLOCK_SIZE - prev_leaf->nums) & (FULL_MASK >> (BLOCK_SIZE - steal_bits));
+    uint64_t *words = block_words(node->data);
+    uint64_t *prev_words = block_words(prev_leaf->data);
 
-    *prev_leaf->data &= (FULL_MASK << (BLOCK_SIZE - (prev_leaf->nums - steal_bits)));
-    *node->data = (steal_data << (BLOCK_SIZE - steal_bits)) | (*node->data >> steal_bits);
+    copy_bits(words, BLOCK_SIZE - node->nums - steal_bits, words, BLOCK_SIZE - node->nums, node->nums);
+    uint32_t ones = copy_bits(words, BLOCK_SIZE - steal_bits, prev_words, BLOCK_SIZE - prev_leaf->nums, steal_bits);
+    clear_bits(prev_words, BLOCK_SIZE - prev_leaf->nums, steal_bits);
 
-    uint32_t ones = steal_data.count();
     propagate_update(node, NULL, steal_bits, ones);
     propagate_update(prev_leaf, NULL, -steal_bits, -ones);
 }
 
 // take some bits from the right 'neighbour' leaf and add them to node
 // this ensures that the tree remains balanced; afterwards propagate the changes
-template <size_t S>
-void BitVector<S>::steal_right(BV_Node<S> *node, BV_Node<S> *next_leaf) {
-    uint32_t steal_bits = (next_leaf->nums - node->nums) / 2;
-    std::bitset<S> steal_data  = *next_leaf->data >> (BLOCK_SIZE - steal_bits);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::steal_right(BV_Node<S, F> *node, BV_Node<S, F> *next_leaf) {
+    move_left(node, next_leaf, (next_leaf->nums - node->nums) / 2);
+}
 
-    *next_leaf->data <<= steal_bits;
-    *node->data = *node->data | (steal_data << (BLOCK_SIZE - node->nums - steal_bits));
+// move the first bits of the right 'neighbour' leaf to the end of node; afterwards propagate the changes
+template <size_t S, uint8_t F>
+void BitVector<S, F>::move_left(BV_Node<S, F> *node, BV_Node<S, F> *next_leaf, uint32_t bits) {
+    if (bits == 0)
+        return;
+    uint64_t *words = block_words(node->data);
+    uint64_t *next_words = block_words(next_leaf->data);
 
-    uint32_t ones = steal_data.count();
-    propagate_update(node, NULL, steal_bits, ones);
-    propagate_update(next_leaf, NULL, -steal_bits, -ones);
+    uint32_t ones = copy_bits(words, BLOCK_SIZE - node->nums - bits, next_words, BLOCK_SIZE - bits, bits);
+    copy_bits(next_words, BLOCK_SIZE - next_leaf->nums + bits, next_words, BLOCK_SIZE - next_leaf->nums, next_leaf->nums - bits);
+    clear_bits(next_words, BLOCK_SIZE - next_leaf->nums, bits);
+
+    propagate_update(node, NULL, bits, ones);
+    propagate_update(next_leaf, NULL, -bits, -ones);
 }
 
 // process the changes required after a left merge
-template <size_t S>
-void BitVector<S>::merge_left_pre_update(BV_Node<S> *node, BV_Node<S> *prev_leaf) {
-    *node->data = *prev_leaf->data | (*node->data >> prev_leaf->nums);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::merge_left_pre_update(BV_Node<S, F> *node, BV_Node<S, F> *prev_leaf) {
+    uint64_t *words = block_words(node->data);
+    copy_bits(words, BLOCK_SIZE - node->nums - prev_leaf->nums, words, BLOCK_SIZE - node->nums, node->nums);
+    copy_bits(words, BLOCK_SIZE - prev_leaf->nums, block_words(prev_leaf->data), BLOCK_SIZE - prev_leaf->nums, prev_leaf->nums);
+    if constexpr ((F & BV_ADAPT) != 0)
+        node->hits += prev_leaf->hits;
     propagate_update(node, NULL, prev_leaf->nums, prev_leaf->ones);
     propagate_update(prev_leaf, NULL, -prev_leaf->nums, -prev_leaf->ones);
 }
 
 // process the changes required after a right merge
-template <size_t S>
-void BitVector<S>::merge_right_pre_update(BV_Node<S> *node, BV_Node<S> *next_leaf) {
-    *node->data = *node->data | (*next_leaf->data >> node->nums);
+template <size_t S, uint8_t F>
+void BitVector<S, F>::merge_right_pre_update(BV_Node<S, F> *node, BV_Node<S, F> *next_leaf) {
+    copy_bits(block_words(node->data), BLOCK_SIZE - node->nums - next_leaf->nums,
+              block_words(next_leaf->data), BLOCK_SIZE - next_leaf->nums, next_leaf->nums);
+    if constexpr ((F & BV_ADAPT) != 0)
+        node->hits += next_leaf->hits;
     propagate_update(node, NULL, next_leaf->nums, next_leaf->ones);
     propagate_update(next_leaf, NULL, -next_leaf->nums, -next_leaf->ones);
 }
 
-template <size_t S>
-void BitVector<S>::merge_post_update(BV_Node<S> *node) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::merge_post_update(BV_Node<S, F> *node) {
     propagate_update(node, NULL, 0, 0);
 }
 
-// process the changes required after a left rotation
-template <size_t S>
-void BitVector<S>::rotate_left_update(BV_Node<S> *node) {
+// process the changes required after a left rotation (node is the new top, its left child the old one)
+// the top holds the bits of the old top, so it takes over its summaries; the heights above are fixed by the rebalancing
+template <size_t S, uint8_t F>
+void BitVector<S, F>::rotate_left_update(BV_Node<S, F> *node) {
     node->nums += node->l->nums;
     node->ones += node->l->ones;
-    propagate_update(node->l, NULL, 0, 0);
+    static_cast<BV_Summaries<F> &>(*node) = *node->l;
+    node->l->invalidate();
 }
 
-// process the changes required after a left rotation
-template <size_t S>
-void BitVector<S>::rotate_right_update(BV_Node<S> *node) {
+// process the changes required after a right rotation (node is the new top, its right child the old one)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::rotate_right_update(BV_Node<S, F> *node) {
     node->r->nums -= node->nums;
     node->r->ones -= node->ones;
-    propagate_update(node->r, NULL, 0, 0);
+    static_cast<BV_Summaries<F> &>(*node) = *node->r;
+    node->r->invalidate();
+}
+
+// create a cursor that points to the bit at index
+template <size_t S, uint8_t F>
+typename BitVector<S, F>::Cursor BitVector<S, F>::cursor(uint32_t index) {
+    return Cursor(this, index);
+}
+
+template <size_t S, uint8_t F>
+BitVector<S, F>::Cursor::Cursor(BitVector<S, F> *bv, uint32_t index) : bv(bv) {
+    this->index = std::min(index, bv->size());
+    reseek();
+}
+
+// locate the cursor position by descending from the root
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::reseek() {
+    offset = index;
+    leaf = bv->find_block(bv->root, &offset);
+    bv->trace(leaf, &path);
+}
+
+// move a cursor that points behind the last bit of its leaf to the start of the next leaf
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::normalize() {
+    if (offset < leaf->nums)
+        return;
+    BV_Node<S, F> *next = bv->next_leaf(&path);
+    if (next) {
+        leaf = next;
+        offset = 0;
+    }
+}
+
+template <size_t S, uint8_t F>
+uint32_t BitVector<S, F>::Cursor::position() {
+    return index;
+}
+
+// return whether the cursor points to a bit (and not behind the last bit)
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::Cursor::valid() {
+    return offset < leaf->nums;
+}
+
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::Cursor::access() {
+    if (!valid()) {
+        std::cout << "Invalid cursor for access operation (returning invalid value)" << std::endl;
+        return false;
+    }
+    return (*leaf->data)[bv->BLOCK_SIZE - offset - 1] > 0;
+}
+
+// move the cursor to the next bit; returns false if there is no next bit
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::Cursor::next() {
+    if (!valid())
+        return false;
+    offset++;
+    index++;
+    normalize();
+    return valid();
+}
+
+// move the cursor to the previous bit; returns false if the cursor is already at the first bit
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::Cursor::prev() {
+    if (index == 0)
+        return false;
+    if (offset == 0) {
+        leaf = bv->prev_leaf(&path);
+        offset = leaf->nums;
+    }
+    offset--;
+    index--;
+    return true;
+}
+
+// move the cursor to index using a finger search: only walk up the tree until the subtree contains index
+// the range [lo, hi) of bits covered by the current subtree is tracked on the way up;
+// hi is only computed when the search moves to the right (it is not needed otherwise)
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::seek(uint32_t index) {
+    BV_Node<S, F> *node = leaf;
+    uint32_t lo = this->index - offset;
+    uint32_t hi = lo + leaf->nums;
+    bool hi_known = true;
+
+    bv->follow(path);
+    BV_Node<S, F> *parent = bv->parent(node);
+    while (parent && (index < lo || (hi_known && index >= hi))) {
+        if (parent->l == node) {
+            if (index < lo)
+                hi_known = false;
+            else if (index < hi + parent->r->nums)
+                hi += parent->r->nums;          // index is in the left part of the right subtree
+            else
+                hi += bv->size(parent->r);
+        } else {
+            lo -= parent->nums;
+        }
+        node = parent;
+        parent = bv->parent(node);
+    }
+
+    if (!parent && index > bv->size(node)) {
+        std::cout << "Invalid index for seek operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    offset = index - lo;
+    leaf = bv->find_block(node, &offset);
+    bv->trace(leaf, &path);
+    this->index = index;
+}
+
+// insert value at the cursor position; afterwards the cursor points to the inserted bit
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::insert(bool value) {
+    bv->follow(path);
+    if (bv->insert_block(leaf, offset, value))
+        reseek();
+}
+
+// remove the bit at the cursor position; afterwards the cursor points to the following bit
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::del() {
+    if (!valid()) {
+        std::cout << "Invalid cursor for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv->follow(path);
+    if (bv->del_block(leaf, offset))
+        reseek();
+    else
+        normalize();
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::flip() {
+    if (!valid()) {
+        std::cout << "Invalid cursor for flip operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv->follow(path);
+    bv->flip(leaf, offset);
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::set() {
+    if (!valid()) {
+        std::cout << "Invalid cursor for set operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv->follow(path);
+    bv->set(leaf, offset);
+}
+
+template <size_t S, uint8_t F>
+void BitVector<S, F>::Cursor::unset() {
+    if (!valid()) {
+        std::cout << "Invalid cursor for unset operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv->follow(path);
+    bv->unset(leaf, offset);
 }
 
 #ifdef ADS_DEBUG
-template <size_t S>
-void BitVector<S>::show() {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::show() {
     std::cout << std::endl;
-    show(this->root);
+    show(this->root, 0);
 }
 
-template <size_t S>
-bool BitVector<S>::validate() {
-    bool val = validate(this->root);
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::validate() {
+    bool val = block_layout_valid<S>() && validate(this->root);
     if (!val) {
         std::cout << "Nicht valider Baum" << std::endl;
     }
     return val;
 }
 
-// print the content of the bitvector and the current configuration of tree to std::out
+// print the content of the bitvector and the current configuration of tree to std::out (ht is the depth of node)
 // mainly used for dabugging purposes
-template <size_t S>
-void BitVector<S>::show(BV_Node<S> *node) {
+template <size_t S, uint8_t F>
+void BitVector<S, F>::show(BV_Node<S, F> *node, uint32_t ht) {
     if (!node)
         return;
 
-    uint32_t ht = this->node_depth(node);
     std::string indent1 = "+";
     std::string indent2 = "| ";
     for (uint32_t i = 0; i < 2 * ht; i++) {
@@ -458,7 +2303,7 @@ void BitVector<S>::show(BV_Node<S> *node) {
     else if (this->is_leaf(node))
         std::cout << indent1 << "Leaf" << std::endl;
     else
-        std::cout << indent1 << "BV_Node<S>" << std::endl;
+        std::cout << indent1 << "BV_Node<S, F>" << std::endl;
     std::cout << indent2 << "id  :   " << node->id << std::endl;
     std::cout << indent2 << "nums:   " << node->nums << std::endl;
     std::cout << indent2 << "ones:   " << node->ones << std::endl;
@@ -466,12 +2311,12 @@ void BitVector<S>::show(BV_Node<S> *node) {
     if (node->data != NULL)
         std::cout << indent2 << "data: " << *node->data << std::endl;
     std::cout <<  "|" << std::endl;
-    show(node->l);
-    show(node->r);
+    show(node->l, ht + 1);
+    show(node->r, ht + 1);
 }
 
-template <size_t S>
-bool BitVector<S>::validate(BV_Node<S> *node) {
+template <size_t S, uint8_t F>
+bool BitVector<S, F>::validate(BV_Node<S, F> *node) {
     if (this->is_leaf(node)) {
         if (node->ones == node->data->count())
             return true;
@@ -479,7 +2324,7 @@ bool BitVector<S>::validate(BV_Node<S> *node) {
     }
     uint32_t nums = 0;
     uint32_t ones = 0;
-    BV_Node<S> *iter = node->l;
+    BV_Node<S, F> *iter = node->l;
     while (iter) {
         nums += iter->nums;
         ones += iter->ones;
@@ -492,3 +2337,4 @@ bool BitVector<S>::validate(BV_Node<S> *node) {
 }
 #endif
 
+#endif
@@ -3,13 +3,133 @@
 #define BITVECTOR
 
 #include "avl.hpp"
+#include "bits.hpp"
+#include "numa.hpp"
 
 #include <vector>
 #include <bitset>
+#include <bit>
+#include <unordered_map>
+
+// breakdown of the memory that is used by a bitvector (all sizes in bytes unless stated otherwise)
+struct BV_Memory {
+    uint64_t bits;                      // number of bits stored in the bitvector
+    uint64_t inner_nodes;
+    uint64_t leaves;
+
+    uint64_t object_bytes;              // the bitvector object itself (including the masks)
+    uint64_t inner_node_bytes;          // node structs of the inner nodes
+    uint64_t leaf_node_bytes;           // node structs of the leaves
+    uint64_t leaf_payload_bytes;        // bit blocks of the leaves
+    uint64_t inner_payload_bytes;       // bit blocks still attached to inner nodes (from building the tree)
+    uint64_t allocator_overhead_bytes;  // headers and padding added by the allocator to every allocation
+    uint64_t total_bytes;
+
+    uint64_t slack_bits;                // unused bits in partially filled leaves
+
+    // fill_histogram[i] is the number of leaves with a fill level in [i * 10%, (i + 1) * 10%)
+    // (the last bucket includes completely filled leaves)
+    uint64_t fill_histogram[10];
+
+    double bytes_per_bit() {
+        return bits ? (double) total_bytes / bits : 0;
+    }
+
+    // fraction of the leaf capacity that is in use
+    double mean_fill() {
+        return bits + slack_bits ? (double) bits / (bits + slack_bits) : 0;
+    }
+};
+
+// excess summary of a sequence of parentheses (a set bit is an opening parenthesis)
+// min and max are taken over the excess at all boundaries including the empty prefix
+struct BP_Excess {
+    int32_t excess;
+    int32_t min;
+    int32_t max;
+};
+
+// lengths of the runs of equal bits at the start and at the end of a sequence and of its longest run
+// (every length is stored for runs of zeros at index 0 and for runs of ones at index 1)
+struct BV_Runs {
+    uint32_t prefix[2];
+    uint32_t suffix[2];
+    uint32_t max[2];
+};
+
+// a single insert or delete of a batch (the value of a delete is ignored)
+struct BV_Update {
+    uint32_t index;
+    bool insert;
+    bool value;
+};
+
+// optional summaries that are kept in the nodes of a bitvector (the template parameter F is a combination of these)
+// a bitvector only pays for the memory and the upkeep of the summaries it was instantiated with
+enum BV_Feature : uint8_t {
+    BV_EXCESS = 1,      // excess summaries for the balanced parentheses searches (fwd_search, find_close, ...)
+    BV_RUNS = 2,        // run summaries for the run searches (find_first_run, find_run_near, claim_run)
+    BV_HASH = 4,        // subtree hashes for the comparisons (hash, equals, diff)
+    BV_ADAPT = 8,       // query counters in the leaves for reshaping the tree (adapt, adapt_every)
+};
+
+template <bool>
+struct BV_ExcessSummary {};
+
+template <>
+struct BV_ExcessSummary<true> {
+    // excess summary of the whole subtree; only recomputed on demand once the subtree is marked dirty
+    BP_Excess bp = {0, 0, 0};
+    bool dirty = true;
+};
+
+template <bool>
+struct BV_RunsSummary {};
+
+template <>
+struct BV_RunsSummary<true> {
+    // run summary of the whole subtree; recomputed on demand just like the excess summary
+    BV_Runs runs = {{0, 0}, {0, 0}, {0, 0}};
+    bool runs_dirty = true;
+};
+
+template <bool>
+struct BV_HashSummary {};
+
+template <>
+struct BV_HashSummary<true> {
+    // hash of the bits of the subtree (independent of the shape of the tree); recomputed on demand as well
+    uint64_t hash = 0;
+    bool hash_dirty = true;
+};
+
+template <bool>
+struct BV_HitCounter {};
+
+template <>
+struct BV_HitCounter<true> {
+    // number of queries that ended in the leaf since the last reshape (only counted with adapt_every)
+    uint32_t hits = 0;
+};
+
+// the summaries (and the query counter) of the features in F (empty bases take no space in the node)
+template <uint8_t F>
+struct BV_Summaries : BV_ExcessSummary<(F & BV_EXCESS) != 0>, BV_RunsSummary<(F & BV_RUNS) != 0>,
+                      BV_HashSummary<(F & BV_HASH) != 0>, BV_HitCounter<(F & BV_ADAPT) != 0> {
+    // mark the summaries of the subtree as outdated
+    void invalidate() {
+        if constexpr ((F & BV_EXCESS) != 0)
+            this->dirty = true;
+        if constexpr ((F & BV_RUNS) != 0)
+            this->runs_dirty = true;
+        if constexpr ((F & BV_HASH) != 0)
+            this->hash_dirty = true;
+    }
+};
 
 // encapsualte the members that are needed for the bitvector tree structure
-template <size_t S>
-struct BV_Node : Node<BV_Node<S>> {
+template <size_t S, uint8_t F = 0>
+struct BV_Node : Node<BV_Node<S, F>>, BV_Summaries<F> {
     #ifdef ADS_DEBUG
     uint32_t id;
     #endif
@@ -17,24 +137,35 @@ struct BV_Node : Node<BV_Node<S>> {
     uint32_t ones;
     std::bitset<S> *data;
 
-    BV_Node() {
+    BV_Node() : BV_Node(new std::bitset<S>) {}
+
+    // use the provided block (pooled nodes get their block from a slab of the tree)
+    BV_Node(std::bitset<S> *block) {
         #ifdef ADS_DEBUG
         id = rand() % 99;
         #endif
         nums = 0;
         ones = 0;
-        data = new std::bitset<S>;
+        data = block;
     }
 
     ~BV_Node() {
-        delete data;
+        release_data();
+    }
+
+    // drop the block of the node (blocks of pooled nodes are freed together with their slab)
+    void release_data() {
+        if (!this->pooled)
+            delete data;
+        data = NULL;
     }
 };
 
 // represents a dynamic bitvector that allows for inserts and deletes everywhere
 //  as well as rank and select queries
-template <size_t S = 512>
-class BitVector : public AVL<BV_Node<S>> {
+// the operations that need additional summaries in the nodes are only available with the features in F (see BV_Feature)
+template <size_t S = 512, uint8_t F = 0>
+class BitVector : public AVL<BV_Node<S, F>> {
     private:
         size_t BLOCK_SIZE;
         size_t TARGET_SIZE;
@@ -45,40 +176,166 @@ class BitVector : public AVL<BV_Node<S>> {
         std::bitset<S> MSB_MASK;
         std::bitset<S> LSB_MASK;
 
-        BV_Node<S> *insert(BV_Node<S> *, uint32_t, bool);
-        BV_Node<S> *del(BV_Node<S> *, uint32_t);
-        void flip(BV_Node<S> *, uint32_t);
-        void set(BV_Node<S> *, uint32_t);
-        void unset(BV_Node<S> *, uint32_t);
-        uint32_t rank(BV_Node<S> *, uint32_t, bool);
-        uint32_t select(BV_Node<S> *, uint32_t, bool);
-        bool access(BV_Node<S> *, uint32_t);
-        void complement(BV_Node<S> *);
-        uint32_t size(BV_Node<S> *);
-        BV_Node<S> *find_block(BV_Node<S> *, uint32_t*);
+        BV_Node<S, F> *insert(BV_Node<S, F> *, uint32_t, bool);
+        BV_Node<S, F> *del(BV_Node<S, F> *, uint32_t);
+        bool insert_block(BV_Node<S, F> *, uint32_t, bool);
+        bool del_block(BV_Node<S, F> *, uint32_t);
+        void apply(BV_Node<S, F> *, const std::vector<BV_Update> &, uint32_t *, uint32_t, uint32_t, int32_t *, int32_t *,
+                   BV_Node<S, F> **);
+        void shift_in(BV_Node<S, F> *, uint32_t, bool);
+        bool shift_out(BV_Node<S, F> *, uint32_t);
+        void flip(BV_Node<S, F> *, uint32_t);
+        void set(BV_Node<S, F> *, uint32_t);
+        void unset(BV_Node<S, F> *, uint32_t);
+        uint32_t rank(BV_Node<S, F> *, uint32_t, bool);
+        uint32_t select(BV_Node<S, F> *, uint32_t, bool);
+        bool access(BV_Node<S, F> *, uint32_t);
+        void complement(BV_Node<S, F> *);
+        uint32_t size(BV_Node<S, F> *);
+        BV_Node<S, F> *find_block(BV_Node<S, F> *, uint32_t*);
+        BV_Node<S, F> *find_block(BV_Node<S, F> *, uint32_t*, uint32_t*);
+        BV_Node<S, F> *query_block(BV_Node<S, F> *, uint32_t *, uint32_t *);
+        void memory_usage(BV_Node<S, F> *, BV_Memory *);
+        void recount(BV_Node<S, F> *, uint32_t *, uint32_t *);
+        BV_Node<S, F> *clone(BV_Node<S, F> *, BV_Node<S, F> *, std::unordered_map<BV_Node<S, F> *, BV_Node<S, F> *> &,
+                          BV_Node<S, F> **, std::bitset<S> **);
+        void veb_order(BV_Node<S, F> *, uint32_t, std::vector<BV_Node<S, F> *> *);
+        void veb_roots(BV_Node<S, F> *, uint32_t, std::vector<BV_Node<S, F> *> *);
+        void move_left(BV_Node<S, F> *, BV_Node<S, F> *, uint32_t);
+        void read_block(AVL_Path<BV_Node<S, F>> *, uint32_t *, uint32_t, std::bitset<S> *);
+        uint32_t next_in_block(BV_Node<S, F> *, uint32_t, bool);
+        uint32_t prev_in_block(BV_Node<S, F> *, uint32_t, bool);
+        uint32_t select_block(BV_Node<S, F> *, uint32_t, bool);
+        uint32_t next_bit(uint32_t, bool);
+        uint32_t prev_bit(uint32_t, bool);
+
+        void refresh_excess(BV_Node<S, F> *);
+        void excess_block(BV_Node<S, F> *);
+        uint32_t fwd_block(BV_Node<S, F> *, uint32_t, int32_t *, int32_t);
+        uint32_t bwd_block(BV_Node<S, F> *, uint32_t, int32_t *, int32_t);
+        uint32_t leaf_start(BV_Node<S, F> *);
+        uint32_t fwd_boundary(uint32_t, int32_t);
+        uint32_t bwd_boundary(uint32_t, int32_t);
+        int32_t min_boundary(BV_Node<S, F> *, uint32_t, uint32_t, int32_t, uint32_t, uint32_t);
+
+        void refresh_runs(BV_Node<S, F> *, uint32_t);
+        void runs_block(BV_Node<S, F> *);
+        uint32_t fwd_run_block(BV_Node<S, F> *, uint32_t, uint32_t, uint32_t, bool, uint32_t *);
+        uint32_t bwd_run_block(BV_Node<S, F> *, uint32_t, uint32_t, uint32_t, bool, uint32_t *);
+        uint32_t fwd_run(BV_Node<S, F> *, uint32_t, uint32_t, uint32_t, uint32_t, bool, uint32_t *);
+        uint32_t bwd_run(BV_Node<S, F> *, uint32_t, uint32_t, uint32_t, uint32_t, bool, uint32_t *);
+        void fill(uint32_t, uint32_t, bool);
+
+        void refresh_hash(BV_Node<S, F> *, uint32_t);
+        uint64_t hash_block(BV_Node<S, F> *, uint32_t, uint32_t);
+        uint64_t hash_range(BV_Node<S, F> *, uint32_t, uint32_t, uint32_t, uint32_t);
+        void diff(BV_Node<S, F> *, uint32_t, uint32_t, BitVector<S, F> &, uint32_t, std::vector<std::pair<uint32_t, uint32_t>> *);
+
+        template <typename Op>
+        void combine(const BitVector<S, F> &, Op);
+        template <typename Op>
+        void combine(const BitVector<S, F> &, const BitVector<S, F> &, Op);
+
+        uint32_t compact_cursor;
+
+        uint32_t adapt_period;      // queries between two reshapes (0 if the queries are not counted)
+        uint32_t adapt_queries;     // queries since the last reshape
+        void count_query();
+        void count_hit(BV_Node<S, F> *);
+        BV_Node<S, F> *reshape(std::vector<BV_Node<S, F> *> &, std::vector<uint64_t> &, uint32_t, uint32_t, BV_Node<S, F> *,
+                            std::vector<BV_Node<S, F> *> *);
+
+        NumaPlacement slab_placement;   // placement of the pages of the slabs (see place)
+        template <typename U>
+        U *allocate_placed_slab(size_t);
 
         #ifdef ADS_DEBUG
-        void show(BV_Node<S> *);
-        bool validate(BV_Node<S> *);
+        void show(BV_Node<S, F> *, uint32_t);
+        bool validate(BV_Node<S, F> *);
         #endif
 
-        void propagate_update(BV_Node<S> *, BV_Node<S> *, int32_t, int32_t);
+        void propagate_update(BV_Node<S, F> *, BV_Node<S, F> *, int32_t, int32_t);
 
-        void split_block_update(BV_Node<S> *, BV_Node<S> *, BV_Node<S> *);
+        void split_block_update(BV_Node<S, F> *, BV_Node<S, F> *, BV_Node<S, F> *);
 
-        void steal_left(BV_Node<S> *, BV_Node<S> *);
-        void steal_right(BV_Node<S> *, BV_Node<S> *);
+        void steal_left(BV_Node<S, F> *, BV_Node<S, F> *);
+        void steal_right(BV_Node<S, F> *, BV_Node<S, F> *);
 
-        void merge_left_pre_update(BV_Node<S> *, BV_Node<S> *);
-        void merge_right_pre_update(BV_Node<S> *, BV_Node<S> *);
-        void merge_post_update(BV_Node<S> *);
+        void merge_left_pre_update(BV_Node<S, F> *, BV_Node<S, F> *);
+        void merge_right_pre_update(BV_Node<S, F> *, BV_Node<S, F> *);
+        void merge_post_update(BV_Node<S, F> *);
 
-        void rotate_left_update(BV_Node<S> *);
-        void rotate_right_update(BV_Node<S> *);
+        void rotate_left_update(BV_Node<S, F> *);
+        void rotate_right_update(BV_Node<S, F> *);
 
     public:
+        // remembers a position in the bitvector (the leaf and the offset inside the leaf)
+        // navigation and updates close to the current position do not need to start at the root
+        // a cursor becomes invalid when the bitvector is modified by anything other than the cursor itself
+        // (with ADS_COMPACT_NODES it holds the path to its leaf, so adapt invalidates it as well)
+        class Cursor {
+            private:
+                BitVector<S, F> *bv;
+                BV_Node<S, F> *leaf;
+                AVL_Path<BV_Node<S, F>> path;   // to the leaf (see AVL::first_leaf)
+                uint32_t offset;
+                uint32_t index;
+
+                void reseek();
+                void normalize();
+
+            public:
+                Cursor(BitVector<S, F> *, uint32_t);
+
+                uint32_t position();
+                bool valid();
+                bool access();
+                bool next();
+                bool prev();
+                void seek(uint32_t);
+
+                void insert(bool);
+                void del();
+                void flip();
+                void set();
+                void unset();
+        };
+
+        Cursor cursor(uint32_t);
+
+        // iterates over the positions of all ones in increasing order
+        class OnesIterator {
+            private:
+                BitVector<S, F> *bv;
+                BV_Node<S, F> *leaf;
+                AVL_Path<BV_Node<S, F>> path;   // to the leaf (see AVL::first_leaf)
+                uint32_t offset;
+                uint32_t start;
+
+                void skip();
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = uint32_t;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const uint32_t *;
+                using reference = uint32_t;
+
+                OnesIterator(BitVector<S, F> *, BV_Node<S, F> *);
+
+                uint32_t operator*();
+                OnesIterator &operator++();
+                OnesIterator operator++(int);
+                bool operator==(const OnesIterator &);
+                bool operator!=(const OnesIterator &);
+        };
+
+        OnesIterator ones_begin();
+        OnesIterator ones_end();
+
         void insert(uint32_t, bool);
         void del(uint32_t);
+        void apply(const std::vector<BV_Update> &);
         void flip(uint32_t);
         void set(uint32_t);
         void unset(uint32_t);
@@ -88,6 +345,53 @@ class BitVector : public AVL<BV_Node<S>> {
         void complement();
         uint32_t size();
         std::vector<bool> extract();
+        BV_Memory memory_usage();
+        BitVector<S, F> clone();
+        BitVector<S, F> clone(NumaPlacement);
+        void relayout();
+        void place(NumaPlacement);
+        NumaPlacement placement();
+        void compact();
+        void compact(uint32_t);
+        bool compact_step(uint32_t);
+        bool compact_step(uint32_t, uint32_t);
+        void adapt();
+        void adapt_every(uint32_t);
+
+        bool access_rank(uint32_t, uint32_t *);
+        uint32_t insert_rank(uint32_t, bool);
+        bool del_rank(uint32_t, uint32_t *);
+        uint32_t rank_pair(uint32_t, uint32_t, bool, uint32_t *);
+
+        uint32_t next_one(uint32_t);
+        uint32_t prev_one(uint32_t);
+        uint32_t next_zero(uint32_t);
+        uint32_t prev_zero(uint32_t);
+
+        int32_t excess(uint32_t);
+        uint32_t fwd_search(uint32_t, int32_t);
+        uint32_t bwd_search(uint32_t, int32_t);
+        uint32_t find_close(uint32_t);
+        uint32_t find_open(uint32_t);
+        uint32_t enclose(uint32_t);
+        int32_t min_excess(uint32_t, uint32_t);
+
+        uint32_t find_first_run(uint32_t, bool);
+        uint32_t find_run_near(uint32_t, uint32_t, bool);
+        uint32_t claim_run(uint32_t);
+
+        uint64_t hash();
+        bool equals(BitVector<S, F> &);
+        std::vector<std::pair<uint32_t, uint32_t>> diff(BitVector<S, F> &);
+
+        void and_with(const BitVector<S, F> &);
+        void or_with(const BitVector<S, F> &);
+        void xor_with(const BitVector<S, F> &);
+        void andnot_with(const BitVector<S, F> &);
+        static BitVector<S, F> and_of(const BitVector<S, F> &, const BitVector<S, F> &);
+        static BitVector<S, F> or_of(const BitVector<S, F> &, const BitVector<S, F> &);
+        static BitVector<S, F> xor_of(const BitVector<S, F> &, const BitVector<S, F> &);
+        static BitVector<S, F> andnot_of(const BitVector<S, F> &, const BitVector<S, F> &);
 
         #ifdef ADS_DEBUG
         void show();
@@ -99,6 +403,10 @@ class BitVector : public AVL<BV_Node<S>> {
 
         BitVector();
         BitVector(std::vector<bool>);
+        // moving hands over the tree in O(1); the moved from bitvector is left empty (move construction)
+        // or holds the previous tree of the target (move assignment)
+        BitVector(BitVector<S, F> &&) = default;
+        BitVector<S, F> &operator=(BitVector<S, F> &&) = default;
 };
 
 #endif
@@ -0,0 +1,91 @@
+#ifndef BITS_DEF
+#define BITS_DEF
+
+#include <algorithm>
+#include <bit>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// word level helpers for the blocks of all bitvectors
+// a block is an array of 64 bit words; the bit with the index i is bit i % 64 of word i / 64 (the same numbering as
+// std::bitset). The bitvectors map their positions to these indices in one of two ways:
+//  - BitVector keeps a leaf in a std::bitset<S> with the position i at the index S - i - 1, so the first bit of a
+//    leaf is the most significant bit of the block (shifts towards the end of a leaf are left shifts of the bitset)
+//  - MultiBitVector, PagedBitVector and RRRBitVector keep the position i at the index i (least significant first)
+// the helpers below only work with indices; the callers translate their positions
+
+// access to the 64 bit words of a block for word level operations
+// this relies on the internal layout of std::bitset in libstdc++ and libc++: the bits are kept in an array of
+// unsigned long (or unsigned long long) words without any further members, bit i in bit i % w of word i / w; on a
+// little endian machine this is the same memory as 64 bit words with bit i in bit i % 64 of word i / 64 (also for
+// 32 bit words). The assertions reject other layouts at compile time, block_layout_valid checks the bit order.
+template <size_t S>
+inline uint64_t *block_words(std::bitset<S> *block) {
+    static_assert(sizeof(std::bitset<S>) == (S + 63) / 64 * sizeof(uint64_t), "unsupported std::bitset layout");
+    static_assert(std::endian::native == std::endian::little, "the words of a block need a little endian machine");
+    return reinterpret_cast<uint64_t *>(block);
+}
+
+// whether block_words sees the bits of a block where it expects them
+template <size_t S>
+inline bool block_layout_valid() {
+    std::bitset<S> block;
+    block.set(S - 1);
+    block.set(S / 2 + 1);
+    uint64_t *words = block_words(&block);
+    return words[(S - 1) / 64] >> ((S - 1) % 64) == 1 && ((words[(S / 2 + 1) / 64] >> ((S / 2 + 1) % 64)) & 1);
+}
+
+
+// read len (1 <= len <= 64) bits of the block starting at the bitset index lo
+inline uint64_t read_bits(uint64_t *words, uint32_t lo, uint32_t len) {
+    uint32_t offset = lo % 64;
+    uint64_t value = words[lo / 64] >> offset;
+    if (offset + len > 64)
+        value |= words[lo / 64 + 1] << (64 - offset);
+    return len == 64 ? value : value & ((1ULL << len) - 1);
+}
+
+// overwrite len (1 <= len <= 64) bits of the block starting at the bitset index lo
+inline void write_bits(uint64_t *words, uint32_t lo, uint32_t len, uint64_t value) {
+    uint32_t offset = lo % 64;
+    uint64_t mask = len == 64 ? ~0ULL : (1ULL << len) - 1;
+    words[lo / 64] = (words[lo / 64] & ~(mask << offset)) | (value << offset);
+    if (offset + len > 64) {
+        uint32_t shift = 64 - offset;
+        words[lo / 64 + 1] = (words[lo / 64 + 1] & ~(mask >> shift)) | (value >> shift);
+    }
+}
+
+// copy len bits from the bitset index src of one block to the bitset index dst of another (or the same) block
+// the bits are moved in chunks of 64 bits (the ranges may overlap); returns the number of ones that were copied
+inline uint32_t copy_bits(uint64_t *dst_words, uint32_t dst, uint64_t *src_words, uint32_t src, uint32_t len) {
+    uint32_t ones = 0;
+    if (dst_words == src_words && dst > src) {
+        for (uint32_t end = len; end > 0;) {
+            uint32_t chunk = std::min(end, 64u);
+            end -= chunk;
+            uint64_t value = read_bits(src_words, src + end, chunk);
+            write_bits(dst_words, dst + end, chunk, value);
+            ones += std::popcount(value);
+        }
+    } else {
+        for (uint32_t start = 0; start < len;) {
+            uint32_t chunk = std::min(len - start, 64u);
+            uint64_t value = read_bits(src_words, src + start, chunk);
+            write_bits(dst_words, dst + start, chunk, value);
+            ones += std::popcount(value);
+            start += chunk;
+        }
+    }
+    return ones;
+}
+
+// clear len bits of the block starting at the bitset index lo
+inline void clear_bits(uint64_t *words, uint32_t lo, uint32_t len) {
+    for (uint32_t start = 0; start < len; start += 64)
+        write_bits(words, lo + start, std::min(len - start, 64u), 0);
+}
+
+#endif
@@ -0,0 +1,465 @@
+#ifndef BUFFEREDBITVECTOR_IMPL
+#define BUFFEREDBITVECTOR_IMPL
+
+#include "bit_vector.cpp"
+#include "buffered_bit_vector.hpp"
+
+#include <algorithm>
+
+// capacity is the number of buffered updates that starts a merge
+template <size_t S>
+BufferedBitVector<S>::BufferedBitVector(uint32_t capacity) : capacity(std::max(capacity, 1u)) {
+    nums = 0;
+    batch.reserve(this->capacity);
+    clear();
+}
+
+template <size_t S>
+BufferedBitVector<S>::BufferedBitVector(std::vector<bool> bits, uint32_t capacity)
+    : capacity(std::max(capacity, 1u)), bv(bits) {
+    nums = bits.size();
+    batch.reserve(this->capacity);
+    clear();
+}
+
+// insert the bit at index; the buffer is merged first if it is full
+template <size_t S>
+void BufferedBitVector<S>::insert(uint32_t index, bool value) {
+    if (index > nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+    if (entries >= capacity)
+        flush();
+
+    Slot slot = locate(index);
+    add(slot, {index - shift_at(slot), true, value, true});
+    nums++;
+}
+
+// delete the bit at index; a buffered insert is dropped, the delete of a bit of the tree is buffered
+template <size_t S>
+void BufferedBitVector<S>::del(uint32_t index) {
+    if (index >= nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+    if (entries >= capacity)
+        flush();
+
+    Slot slot = locate(index);
+    if (inserted_at(slot, index)) {
+        remove(slot);
+    } else {
+        uint32_t tree_index = index - shift_at(slot);
+        add(slot, {tree_index, false, false, false});
+        unresolved.push_back(tree_index);
+    }
+    nums--;
+}
+
+// the bits of buffered inserts are changed in the buffer, all others in the tree
+template <size_t S>
+void BufferedBitVector<S>::flip(uint32_t index) {
+    Slot slot = locate(index);
+    if (inserted_at(slot, index)) {
+        BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        entry.value = !entry.value;
+        correct({slot.chunk, slot.pos + 1}, 0, entry.value ? 1 : -1);
+    } else {
+        bv.flip(index - shift_at(slot));
+    }
+}
+
+template <size_t S>
+void BufferedBitVector<S>::set(uint32_t index) {
+    Slot slot = locate(index);
+    if (inserted_at(slot, index)) {
+        BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        if (!entry.value)
+            correct({slot.chunk, slot.pos + 1}, 0, 1);
+        entry.value = true;
+    } else {
+        bv.set(index - shift_at(slot));
+    }
+}
+
+template <size_t S>
+void BufferedBitVector<S>::unset(uint32_t index) {
+    Slot slot = locate(index);
+    if (inserted_at(slot, index)) {
+        BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        if (entry.value)
+            correct({slot.chunk, slot.pos + 1}, 0, -1);
+        entry.value = false;
+    } else {
+        bv.unset(index - shift_at(slot));
+    }
+}
+
+// the ones in the tree in front of the corresponding tree index plus the ones of the buffered updates in front
+template <size_t S>
+uint32_t BufferedBitVector<S>::rank(uint32_t index, bool value) {
+    resolve();
+    Slot slot = locate(index);
+    uint32_t ones = tree_ones(index - shift_at(slot)) + ones_at(slot);
+    return value ? ones : index - ones;
+}
+
+// the occurrence is either a buffered insert or a bit of the tree between two buffered updates; the update in front
+// of which it is located is searched with the ranks of the buffered updates (one rank in the tree per probe)
+template <size_t S>
+uint32_t BufferedBitVector<S>::select(uint32_t num, bool value) {
+    resolve();
+    uint32_t last = order.size() - 1;
+    Slot end = {last, chunk(last).size};
+    uint32_t ones = tree_ones(nums - shift_at(end)) + ones_at(end);
+    if (num == 0 || num > (value ? ones : nums - ones)) {
+        std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+
+    // occurrences of value in front of the update
+    auto before = [&](Slot slot) {
+        uint32_t ones = tree_ones(chunk(slot.chunk).entries[slot.pos].index) + ones_at(slot);
+        return value ? ones : position(slot) - ones;
+    };
+    // occurrences up to the update (including its own bit if it inserts value)
+    auto reaches = [&](Slot slot) {
+        const BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        return before(slot) + (entry.insert && entry.value == value) >= num;
+    };
+    Slot slot = search([&](uint32_t c) { return reaches({c, chunk(c).size - 1}); }, reaches);
+
+    if (slot.pos < chunk(slot.chunk).size) {
+        const BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        if (entry.insert && entry.value == value && before(slot) == num - 1)
+            return position(slot);
+    }
+    int32_t correction = value ? ones_at(slot) : shift_at(slot) - ones_at(slot);
+    return bv.select(num - correction, value) + shift_at(slot);
+}
+
+template <size_t S>
+bool BufferedBitVector<S>::access(uint32_t index) {
+    Slot slot = locate(index);
+    if (inserted_at(slot, index))
+        return chunk(slot.chunk).entries[slot.pos].value;
+    return bv.access(index - shift_at(slot));
+}
+
+template <size_t S>
+uint32_t BufferedBitVector<S>::size() {
+    return nums;
+}
+
+// number of updates that are not merged into the tree yet
+template <size_t S>
+uint32_t BufferedBitVector<S>::buffered() {
+    return entries;
+}
+
+template <size_t S>
+std::vector<bool> BufferedBitVector<S>::extract() {
+    flush();
+    if (nums == 0)
+        return std::vector<bool>();
+    return bv.extract();
+}
+
+// merge the buffered updates into the tree (the index of an update in the batch is its current position, which
+// is its position once the updates in front of it are applied)
+template <size_t S>
+void BufferedBitVector<S>::flush() {
+    if (entries == 0)
+        return;
+    for (uint32_t c = 0; c < order.size(); c++)
+        for (uint32_t i = 0; i < chunk(c).size; i++) {
+            const BBV_Entry &entry = chunk(c).entries[i];
+            batch.push_back({position({c, i}), entry.insert, entry.value});
+        }
+    bv.apply(batch);
+    batch.clear();
+    clear();
+}
+
+template <size_t S>
+bool BufferedBitVector<S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+// the c-th chunk of the buffer
+template <size_t S>
+BBV_Chunk &BufferedBitVector<S>::chunk(uint32_t c) {
+    return pool[order[c]];
+}
+
+// return the first update for which pred holds (pred has to be monotone over the buffer, chunk_pred(c) tells whether
+// it holds for the last update of the c-th chunk); the end of the buffer is returned if it holds for none
+template <size_t S>
+template <typename ChunkPred, typename Pred>
+typename BufferedBitVector<S>::Slot BufferedBitVector<S>::search(ChunkPred chunk_pred, Pred pred) {
+    uint32_t lo = 0;
+    uint32_t hi = order.size() - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (chunk_pred(mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    uint32_t left = 0;
+    uint32_t right = chunk(lo).size;
+    while (left < right) {
+        uint32_t mid = (left + right) / 2;
+        if (pred(Slot{lo, mid}))
+            right = mid;
+        else
+            left = mid + 1;
+    }
+    return {lo, left};
+}
+
+// return the first update behind the bits in front of index; it is the buffered insert of the bit at index
+// if there is one, otherwise the bit at index belongs to the tree and the updates in front of it are skipped
+// (the chunk is the first one whose last key exceeds 2 * index, both positions are found by counting keys)
+template <size_t S>
+typename BufferedBitVector<S>::Slot BufferedBitVector<S>::locate(uint32_t index) {
+    const int64_t key = 2 * (int64_t) index;
+    const int64_t *last = last_key.data();
+    const int32_t *before = shift_before.data();
+    const uint32_t chunks = order.size() - 1;
+    uint32_t c = 0;
+    for (uint32_t i = 0; i < chunks; i++)
+        c += last[i] + 2 * before[i] <= key;
+
+    const int64_t *keys = chunk(c).keys;
+    const int64_t relative = key - 2 * (int64_t) shift_before[c];
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < BBV_Chunk::CAPACITY; i++)
+        pos += keys[i] <= relative;
+    return {c, pos};
+}
+
+// current position of the update (the position of the inserted bit or of the bit behind the deleted one)
+template <size_t S>
+uint32_t BufferedBitVector<S>::position(Slot slot) {
+    return (chunk(slot.chunk).keys[slot.pos] >> 1) + shift_before[slot.chunk];
+}
+
+template <size_t S>
+bool BufferedBitVector<S>::inserted_at(Slot slot, uint32_t index) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    return slot.pos < c.size && c.keys[slot.pos] + 2 * (int64_t) shift_before[slot.chunk] == 2 * (int64_t) index + 1;
+}
+
+// inserts minus deletes in front of the update
+template <size_t S>
+int32_t BufferedBitVector<S>::shift_at(Slot slot) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    return shift_before[slot.chunk] +
+           (slot.pos < c.size ? (c.keys[slot.pos] >> 1) - c.entries[slot.pos].index : c.total_shift);
+}
+
+// inserted minus deleted ones in front of the update (only exact if all deletes are resolved)
+template <size_t S>
+int32_t BufferedBitVector<S>::ones_at(Slot slot) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    return ones_before[slot.chunk] + (slot.pos < c.size ? c.ones[slot.pos] : c.total_ones);
+}
+
+// ones in front of index in the tree
+template <size_t S>
+uint32_t BufferedBitVector<S>::tree_ones(uint32_t index) {
+    return index ? bv.rank(index, true) : 0;
+}
+
+// insert the update in front of slot and correct the counters behind it
+template <size_t S>
+void BufferedBitVector<S>::add(Slot slot, BBV_Entry entry) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    int32_t shift = slot.pos < c.size ? (c.keys[slot.pos] >> 1) - c.entries[slot.pos].index : c.total_shift;
+    int32_t ones = slot.pos < c.size ? c.ones[slot.pos] : c.total_ones;
+    std::copy_backward(c.entries + slot.pos, c.entries + c.size, c.entries + c.size + 1);
+    std::copy_backward(c.keys + slot.pos, c.keys + c.size, c.keys + c.size + 1);
+    std::copy_backward(c.ones + slot.pos, c.ones + c.size, c.ones + c.size + 1);
+    c.entries[slot.pos] = entry;
+    c.keys[slot.pos] = 2 * ((int64_t) entry.index + shift) + entry.insert;
+    c.ones[slot.pos] = ones;
+    c.size++;
+    entries++;
+    correct({slot.chunk, slot.pos + 1}, entry.insert ? 1 : -1, entry.insert ? entry.value : 0);
+    if (c.size == BBV_Chunk::CAPACITY)
+        split(slot.chunk);
+}
+
+// remove the buffered insert at slot (an empty chunk is dropped unless it is the only one)
+template <size_t S>
+void BufferedBitVector<S>::remove(Slot slot) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    bool value = c.entries[slot.pos].value;
+    std::copy(c.entries + slot.pos + 1, c.entries + c.size, c.entries + slot.pos);
+    std::copy(c.keys + slot.pos + 1, c.keys + c.size, c.keys + slot.pos);
+    std::copy(c.ones + slot.pos + 1, c.ones + c.size, c.ones + slot.pos);
+    c.size--;
+    c.keys[c.size] = BBV_Chunk::UNUSED;
+    entries--;
+    correct(slot, -1, -value);
+    if (c.size == 0 && order.size() > 1) {
+        spare.push_back(order[slot.chunk]);
+        order.erase(order.begin() + slot.chunk);
+        shift_before.erase(shift_before.begin() + slot.chunk);
+        ones_before.erase(ones_before.begin() + slot.chunk);
+        last_key.erase(last_key.begin() + slot.chunk);
+    }
+}
+
+// add shift and ones to the counters of the updates from slot on
+template <size_t S>
+void BufferedBitVector<S>::correct(Slot slot, int32_t shift, int32_t ones) {
+    BBV_Chunk &c = chunk(slot.chunk);
+    const uint32_t size = c.size;
+    for (uint32_t i = 0; i < BBV_Chunk::CAPACITY; i++) {
+        bool behind = i >= slot.pos && i < size;
+        c.keys[i] += behind ? 2 * (int64_t) shift : 0;
+        c.ones[i] += behind ? ones : 0;
+    }
+    c.total_shift += shift;
+    c.total_ones += ones;
+    if (size > 0)
+        last_key[slot.chunk] = c.keys[size - 1];
+
+    int32_t *shifts = shift_before.data();
+    int32_t *counts = ones_before.data();
+    const uint32_t chunks = order.size();
+    for (uint32_t i = slot.chunk + 1; i < chunks; i++) {
+        shifts[i] += shift;
+        counts[i] += ones;
+    }
+}
+
+// move the second half of the c-th chunk into a new chunk behind it
+template <size_t S>
+void BufferedBitVector<S>::split(uint32_t c) {
+    if (spare.empty()) {
+        spare.push_back(pool.size());
+        pool.emplace_back();
+    }
+    uint32_t id = spare.back();
+    spare.pop_back();
+
+    BBV_Chunk &first = chunk(c);
+    BBV_Chunk &second = pool[id];
+    uint32_t half = first.size / 2;
+    int32_t shift = (first.keys[half] >> 1) - first.entries[half].index;
+    int32_t ones = first.ones[half];
+    second.size = first.size - half;
+    for (uint32_t i = 0; i < second.size; i++) {
+        second.entries[i] = first.entries[half + i];
+        second.keys[i] = first.keys[half + i] - 2 * (int64_t) shift;
+        second.ones[i] = first.ones[half + i] - ones;
+        first.keys[half + i] = BBV_Chunk::UNUSED;
+    }
+    second.total_shift = first.total_shift - shift;
+    second.total_ones = first.total_ones - ones;
+    first.size = half;
+    first.total_shift = shift;
+    first.total_ones = ones;
+
+    order.insert(order.begin() + c + 1, id);
+    shift_before.insert(shift_before.begin() + c + 1, shift_before[c] + shift);
+    ones_before.insert(ones_before.begin() + c + 1, ones_before[c] + ones);
+    last_key.insert(last_key.begin() + c + 1, second.keys[second.size - 1]);
+    last_key[c] = first.keys[half - 1];
+}
+
+// look up the values of the deletes that are not known yet in the tree and correct the ones behind them
+// (the delete of the bit at index i has the key 2 * i + 1 in the order of the buffer)
+template <size_t S>
+void BufferedBitVector<S>::resolve() {
+    for (uint32_t index : unresolved) {
+        int64_t key = 2 * (int64_t) index + 1;
+        auto reaches = [&](Slot slot) {
+            const BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+            return 2 * (int64_t) entry.index + !entry.insert >= key;
+        };
+        Slot slot = search([&](uint32_t c) { return reaches({c, chunk(c).size - 1}); }, reaches);
+        BBV_Entry &entry = chunk(slot.chunk).entries[slot.pos];
+        entry.value = bv.access(index);
+        entry.known = true;
+        if (entry.value)
+            correct({slot.chunk, slot.pos + 1}, 0, -1);
+    }
+    unresolved.clear();
+}
+
+// empty the buffer (a single empty chunk remains, the others are kept for reuse)
+template <size_t S>
+void BufferedBitVector<S>::clear() {
+    if (pool.empty())
+        pool.emplace_back();
+    for (uint32_t id : order) {
+        BBV_Chunk &c = pool[id];
+        std::fill(c.keys, c.keys + c.size, BBV_Chunk::UNUSED);
+        c.size = 0;
+        c.total_shift = 0;
+        c.total_ones = 0;
+    }
+    spare.clear();
+    for (uint32_t id = pool.size(); id-- > 1;)
+        spare.push_back(id);
+    order.assign(1, 0);
+    shift_before.assign(1, 0);
+    ones_before.assign(1, 0);
+    last_key.assign(1, 0);
+    unresolved.clear();
+    entries = 0;
+}
+
+#ifdef ADS_DEBUG
+// check the tree and that the counters and the order of the buffer match its updates
+template <size_t S>
+bool BufferedBitVector<S>::validate() {
+    uint32_t tree_nums = bv.size();
+    bool val = tree_nums == 0 || bv.validate();
+    bool exact = unresolved.empty();
+    int32_t shift = 0;
+    int32_t ones = 0;
+    uint32_t count = 0;
+    uint32_t unknown = 0;
+    int64_t previous = -1;
+    val &= shift_before.size() == order.size() && ones_before.size() == order.size() && last_key.size() == order.size();
+    for (uint32_t c = 0; c < order.size(); c++) {
+        BBV_Chunk &ch = chunk(c);
+        val &= ch.size < BBV_Chunk::CAPACITY && (ch.size > 0 || order.size() == 1);
+        val &= shift_before[c] == shift && (!exact || ones_before[c] == ones);
+        for (uint32_t i = 0; i < BBV_Chunk::CAPACITY; i++) {
+            if (i >= ch.size) {
+                val &= ch.keys[i] == BBV_Chunk::UNUSED;
+                continue;
+            }
+            BBV_Entry &entry = ch.entries[i];
+            val &= ch.keys[i] == 2 * ((int64_t) entry.index + shift - shift_before[c]) + entry.insert;
+            val &= !exact || ch.ones[i] == ones - ones_before[c];
+            // ascending by tree index, the inserts in front of a bit precede its delete and a bit is deleted once
+            int64_t key = 2 * (int64_t) entry.index + !entry.insert;
+            val &= key >= previous && (entry.insert ? entry.index <= tree_nums : (entry.index < tree_nums && key > previous));
+            previous = key;
+            shift += entry.insert ? 1 : -1;
+            ones += entry.insert ? entry.value : (entry.known ? -entry.value : 0);
+            unknown += !entry.insert && !entry.known;
+        }
+        val &= ch.total_shift == shift - shift_before[c] && (!exact || ch.total_ones == ones - ones_before[c]);
+        val &= ch.size == 0 || last_key[c] == ch.keys[ch.size - 1];
+        count += ch.size;
+    }
+    val &= count == entries && entries <= capacity && unknown == unresolved.size();
+    val &= (int64_t) tree_nums + shift == nums;
+    if (!val)
+        std::cout << "Invalid buffered bitvector" << std::endl;
+    return val;
+}
+#endif
+
+#endif
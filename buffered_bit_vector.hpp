@@ -0,0 +1,110 @@
+#ifndef BUFFEREDBITVECTOR
+#define BUFFEREDBITVECTOR
+
+#include "bit_vector.hpp"
+
+#include <vector>
+#include <limits>
+
+// a buffered update; index is a position in the tree (an insert puts its bit in front of the bit at index,
+// a delete removes the bit at index)
+struct BBV_Entry {
+    uint32_t index;
+    bool insert;
+    bool value;
+    bool known;     // the value of a delete is only looked up in the tree once a rank or select needs it
+};
+
+// a run of consecutive buffered updates; the counters are relative to the updates in front of the run
+// the key of an update is 2 * position + insert, the updates in front of a position are the ones whose key does not
+// exceed 2 * position; the loops over a chunk always cover all slots (the unused keys are larger than every key),
+// so locating a position and correcting the counters behind an update need no branches
+struct alignas(64) BBV_Chunk {
+    static const uint32_t CAPACITY = 64;    // a full chunk is split into two halves
+    static constexpr int64_t UNUSED = std::numeric_limits<int64_t>::max();
+
+    int64_t keys[CAPACITY];
+    int32_t ones[CAPACITY];                 // inserted minus deleted ones in front of the update
+    BBV_Entry entries[CAPACITY];
+    uint32_t size;
+    int32_t total_shift;                    // inserts minus deletes of the run
+    int32_t total_ones;                     // inserted minus deleted ones of the run
+
+    BBV_Chunk() {
+        std::fill(keys, keys + CAPACITY, UNUSED);
+        size = 0;
+        total_shift = 0;
+        total_ones = 0;
+    }
+};
+
+// dynamic bitvector for insert and delete heavy workloads (LSM style write buffer in front of a bitvector)
+// inserts and deletes are collected in a buffer that is sorted by position and merged into the tree with a single
+// batched descent once it holds capacity updates; queries stay exact by correcting the results of the tree with
+// the buffered updates in front of the position
+template <size_t S = 512>
+class BufferedBitVector {
+    private:
+        // the position of an update in the buffer (the chunk in order and the position inside the chunk)
+        struct Slot {
+            uint32_t chunk;
+            uint32_t pos;
+        };
+
+        // the buffer is sorted by the index in the tree, the inserts in front of a bit precede the delete of the bit
+        // the counters of the chunks are kept in arrays next to order, so searching and correcting them stays in cache
+        std::vector<BBV_Chunk> pool;        // allocated chunks (the ones that are not in order are listed in spare)
+        std::vector<uint32_t> spare;
+        std::vector<uint32_t> order;        // the chunks of the buffer in order
+        std::vector<int32_t> shift_before;  // inserts minus deletes of the chunks in front of the chunk
+        std::vector<int32_t> ones_before;   // inserted minus deleted ones of the chunks in front of the chunk
+        std::vector<int64_t> last_key;      // (relative) key of the last update of the chunk
+        std::vector<uint32_t> unresolved;   // indices of the deletes whose value was not looked up yet
+        std::vector<BV_Update> batch;       // the buffer in the form BitVector::apply takes it
+        uint32_t entries;
+        uint32_t capacity;
+        uint32_t nums;                      // size including the buffered updates
+
+        BitVector<S> bv;
+
+        BBV_Chunk &chunk(uint32_t);
+        template <typename ChunkPred, typename Pred>
+        Slot search(ChunkPred, Pred);
+        Slot locate(uint32_t);
+        uint32_t position(Slot);
+        bool inserted_at(Slot, uint32_t);
+        int32_t shift_at(Slot);
+        int32_t ones_at(Slot);
+        uint32_t tree_ones(uint32_t);
+        void add(Slot, BBV_Entry);
+        void remove(Slot);
+        void correct(Slot, int32_t, int32_t);
+        void split(uint32_t);
+        void resolve();
+        void clear();
+
+    public:
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void flip(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        bool access(uint32_t);
+        uint32_t size();
+        uint32_t buffered();
+        std::vector<bool> extract();
+        void flush();
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        BufferedBitVector(uint32_t = 4096);
+        BufferedBitVector(std::vector<bool>, uint32_t = 4096);
+};
+
+#endif
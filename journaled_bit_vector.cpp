@@ -0,0 +1,438 @@
+#ifndef JOURNALEDBITVECTOR_IMPL
+#define JOURNALEDBITVECTOR_IMPL
+
+#include "bit_vector.cpp"
+#include "journaled_bit_vector.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// open the bitvector that is stored in dir (the directory is created if it does not exist yet)
+// group_size operations are committed together, checkpoint_bytes is the journal size that starts a checkpoint
+// in the background (0: only explicit checkpoints)
+template <size_t S>
+JournaledBitVector<S>::JournaledBitVector(std::string dir, uint32_t group_size, BV_Sync sync, uint64_t checkpoint_bytes)
+    : dir(dir), sync(sync), group_size(std::max(group_size, 1u)), checkpoint_bytes(checkpoint_bytes) {
+    nums = 0;
+    journal_fd = -1;
+    generation = 0;
+    journal_size = 0;
+    pending_ops = 0;
+    started = 0;
+    written = 0;
+    finished = 0;
+    failed = false;
+    stats = {0, 0, 0, 0, 0, 0, 0};
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("Could not create the directory " + dir);
+    recover();
+}
+
+// commit the open group and wait for a running checkpoint
+// (errors cannot be thrown from here; the operations of a group that could not be written are lost as in a crash)
+template <size_t S>
+JournaledBitVector<S>::~JournaledBitVector() {
+    try {
+        commit();
+        wait_checkpoint();
+    } catch (const std::exception &) {
+        if (checkpointer.joinable())
+            checkpointer.join();
+    }
+    close(journal_fd);
+}
+
+// 64 bit FNV-1a hash of the bytes
+template <size_t S>
+uint64_t JournaledBitVector<S>::checksum(const uint8_t *bytes, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    return hash;
+}
+
+template <size_t S>
+void JournaledBitVector<S>::write_all(int fd, const uint8_t *bytes, size_t length, const std::string &path) {
+    while (length > 0) {
+        ssize_t count = write(fd, bytes, length);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            throw std::runtime_error("Could not write " + path);
+        bytes += count;
+        length -= count;
+    }
+}
+
+// make created, renamed and removed files in dir durable
+template <size_t S>
+void JournaledBitVector<S>::sync_dir(const std::string &dir) {
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+template <size_t S>
+std::string JournaledBitVector<S>::journal_path(uint64_t gen) {
+    return dir + "/journal." + std::to_string(gen);
+}
+
+template <size_t S>
+std::string JournaledBitVector<S>::snapshot_path() {
+    return dir + "/snapshot";
+}
+
+// open the journal of generation gen for appending (an existing journal is truncated if create is set)
+template <size_t S>
+void JournaledBitVector<S>::open_journal(uint64_t gen, bool create) {
+    std::string path = journal_path(gen);
+    journal_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (create ? O_TRUNC : 0), 0644);
+    if (journal_fd < 0)
+        throw std::runtime_error("Could not open " + path);
+    generation = gen;
+    journal_size = lseek(journal_fd, 0, SEEK_END);
+    if (create && sync != BV_Sync::none)
+        sync_dir(dir);
+}
+
+// load the snapshot and replay the journals of all generations since then
+// journals of older generations are left over by a checkpoint that was interrupted after its snapshot was renamed
+// (the number of bits in the header is checked against the size of the file before the words are read)
+template <size_t S>
+void JournaledBitVector<S>::recover() {
+    std::vector<bool> bits;
+    uint64_t gen = 0;
+    int fd = open(snapshot_path().c_str(), O_RDONLY);
+    if (fd >= 0) {
+        uint64_t header[4];    // magic, generation, number of bits, checksum of the words
+        off_t file_size = lseek(fd, 0, SEEK_END);
+        bool valid = pread(fd, header, sizeof(header), 0) == sizeof(header) && header[0] == SNAPSHOT_MAGIC
+                     && header[2] <= UINT32_MAX && (header[2] + 63) / 64 * sizeof(uint64_t) <= file_size - sizeof(header);
+        std::vector<uint64_t> words(valid ? (header[2] + 63) / 64 : 0);
+        size_t length = words.size() * sizeof(uint64_t);
+        valid = valid && pread(fd, words.data(), length, sizeof(header)) == (ssize_t) length
+                && checksum((const uint8_t *) words.data(), length) == header[3];
+        close(fd);
+        if (!valid)
+            throw std::runtime_error("Could not read the snapshot in " + dir);
+        gen = header[1];
+        bits.resize(header[2]);
+        for (uint64_t i = 0; i < header[2]; i++)
+            bits[i] = (words[i / 64] >> (i % 64)) & 1;
+    }
+    for (uint64_t old = gen; old > 0 && unlink(journal_path(old - 1).c_str()) == 0; old--);
+
+    bv = BitVector<S>(bits);
+    uint64_t last = gen;
+    for (; ::access(journal_path(gen).c_str(), F_OK) == 0; gen++) {
+        uint64_t valid = replay(gen);
+        if (truncate(journal_path(gen).c_str(), valid) != 0)
+            throw std::runtime_error("Could not truncate " + journal_path(gen));
+        last = gen;
+    }
+    nums = bv.size();
+    open_journal(last, false);
+}
+
+// replay the complete frames of the journal of generation gen and return the number of bytes they take
+// (a frame that is cut off or does not match its checksum was not committed completely; it ends the journal)
+// runs of inserts and deletes with ascending indices are collected and applied to the tree as one batch
+template <size_t S>
+uint64_t JournaledBitVector<S>::replay(uint64_t gen) {
+    int fd = open(journal_path(gen).c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open " + journal_path(gen));
+    std::vector<uint8_t> bytes(lseek(fd, 0, SEEK_END));
+    ssize_t count = pread(fd, bytes.data(), bytes.size(), 0);
+    close(fd);
+    if (count != (ssize_t) bytes.size())
+        throw std::runtime_error("Could not read " + journal_path(gen));
+
+    std::vector<BV_Update> batch;
+    size_t frame = 0;
+    while (frame + FRAME_HEADER <= bytes.size()) {
+        uint64_t sum;
+        uint32_t length, ops;
+        std::memcpy(&sum, &bytes[frame], 8);
+        std::memcpy(&length, &bytes[frame + 8], 4);
+        std::memcpy(&ops, &bytes[frame + 12], 4);
+        size_t end = frame + FRAME_HEADER + length;
+        if (end > bytes.size() || checksum(&bytes[frame + 8], FRAME_HEADER - 8 + length) != sum)
+            break;
+
+        for (size_t pos = frame + FRAME_HEADER; pos < end; ) {
+            uint8_t op = bytes[pos++];
+            uint32_t index = 0;
+            for (uint32_t shift = 0; op != COMPLEMENT && pos < end; shift += 7) {
+                index |= (uint32_t) (bytes[pos] & 0x7f) << shift;
+                if (!(bytes[pos++] & 0x80))
+                    break;
+            }
+            bool shift = op == INSERT_ZERO || op == INSERT_ONE || op == DEL;
+            if (!batch.empty() && (!shift || index < batch.back().index || batch.size() >= REPLAY_BATCH)) {
+                bv.apply(batch);
+                batch.clear();
+            }
+            switch (op) {
+                case INSERT_ZERO:
+                case INSERT_ONE:
+                case DEL:
+                    batch.push_back({index, op != DEL, op == INSERT_ONE});
+                    break;
+                case SET:
+                    bv.set(index);
+                    break;
+                case UNSET:
+                    bv.unset(index);
+                    break;
+                case FLIP:
+                    bv.flip(index);
+                    break;
+                case COMPLEMENT:
+                    bv.complement();
+                    break;
+            }
+        }
+        stats.replayed += ops;
+        frame = end;
+    }
+    bv.apply(batch);
+    return frame;
+}
+
+// append the operation to the open group (the group is committed once it holds group_size operations)
+// an operation is encoded as its opcode and the index as a varint (7 bits per byte, the high bit marks more bytes)
+template <size_t S>
+void JournaledBitVector<S>::record(Opcode op, uint32_t index) {
+    if (pending.empty())
+        pending.resize(FRAME_HEADER);
+    pending.push_back(op);
+    if (op != COMPLEMENT) {
+        for (; index >= 0x80; index >>= 7)
+            pending.push_back((index & 0x7f) | 0x80);
+        pending.push_back(index);
+    }
+    pending_ops++;
+    stats.ops++;
+    if (pending_ops >= group_size || sync == BV_Sync::always)
+        commit();
+}
+
+// append the open group to the journal as a single frame (checksum, payload length, operations, payload)
+// the frame is forced to the disk unless the sync policy is none
+template <size_t S>
+void JournaledBitVector<S>::append_group() {
+    if (pending_ops == 0)
+        return;
+    uint32_t length = pending.size() - FRAME_HEADER;
+    std::memcpy(&pending[8], &length, 4);
+    std::memcpy(&pending[12], &pending_ops, 4);
+    uint64_t sum = checksum(&pending[8], pending.size() - 8);
+    std::memcpy(&pending[0], &sum, 8);
+    write_all(journal_fd, pending.data(), pending.size(), journal_path(generation));
+    if (sync != BV_Sync::none) {
+        fsync(journal_fd);
+        stats.syncs++;
+    }
+    journal_size += pending.size();
+    stats.journal_bytes += pending.size();
+    stats.groups++;
+    pending.clear();
+    pending_ops = 0;
+}
+
+// commit the open group; once the journal is as large as a snapshot (or checkpoint_bytes if that is larger) a
+// checkpoint is started, so at most that much journal has to be replayed and every journal byte causes at most one
+// further byte of snapshot
+// (a failed background checkpoint is thrown by the next commit that would start a checkpoint)
+template <size_t S>
+void JournaledBitVector<S>::commit() {
+    append_group();
+    if (checkpoint_bytes > 0 && journal_size >= std::max(checkpoint_bytes, (uint64_t) nums / 8)
+            && (finished == started || failed))
+        checkpoint();
+}
+
+// start a checkpoint: the operations from now on go to the journal of a new generation and the current bits are
+// written as the snapshot of that generation in the background; afterwards the journal of the old generation is
+// removed (the bits are extracted in the foreground because the tree nodes must not be touched by two threads)
+template <size_t S>
+void JournaledBitVector<S>::checkpoint() {
+    wait_checkpoint();
+    append_group();
+    std::vector<bool> bits = bv.extract();
+    close(journal_fd);
+    open_journal(generation + 1, true);
+    started++;
+    checkpointer = std::thread([this, gen = generation, bits = std::move(bits)]() {
+        try {
+            write_snapshot(bits, gen);
+        } catch (const std::exception &) {
+            failure = std::current_exception();
+            failed = true;
+        }
+    });
+}
+
+// write the snapshot of generation gen to a temporary file, force it to the disk and rename it over the previous
+// snapshot; the journal of the previous generation is only removed once the new snapshot is durable
+template <size_t S>
+void JournaledBitVector<S>::write_snapshot(const std::vector<bool> &bits, uint64_t gen) {
+    std::vector<uint64_t> words((bits.size() + 63) / 64 + 4, 0);
+    for (uint64_t i = 0; i < bits.size(); i++)
+        words[4 + i / 64] |= (uint64_t) bits[i] << (i % 64);
+    size_t length = (words.size() - 4) * sizeof(uint64_t);
+    words[0] = SNAPSHOT_MAGIC;
+    words[1] = gen;
+    words[2] = bits.size();
+    words[3] = checksum((const uint8_t *) &words[4], length);
+
+    std::string path = snapshot_path() + ".tmp";
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Could not create " + path);
+    try {
+        write_all(fd, (const uint8_t *) words.data(), words.size() * sizeof(uint64_t), path);
+    } catch (const std::exception &) {
+        close(fd);
+        throw;
+    }
+    fsync(fd);
+    close(fd);
+    if (rename(path.c_str(), snapshot_path().c_str()) != 0)
+        throw std::runtime_error("Could not rename " + path);
+    sync_dir(dir);
+    unlink(journal_path(gen - 1).c_str());
+    written += words.size() * sizeof(uint64_t);
+    finished++;
+}
+
+// wait for a running checkpoint and throw its error if it failed (the journals it would have removed are kept, so
+// the state on the disk stays complete and the next checkpoint starts over)
+template <size_t S>
+void JournaledBitVector<S>::wait_checkpoint() {
+    if (checkpointer.joinable())
+        checkpointer.join();
+    if (failed) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        failed = false;
+        started = finished;
+        std::rethrow_exception(error);
+    }
+}
+
+template <size_t S>
+void JournaledBitVector<S>::insert(uint32_t index, bool value) {
+    if (index > nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv.insert(index, value);
+    nums++;
+    record(value ? INSERT_ONE : INSERT_ZERO, index);
+}
+
+template <size_t S>
+void JournaledBitVector<S>::del(uint32_t index) {
+    if (index >= nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv.del(index);
+    nums--;
+    record(DEL, index);
+}
+
+template <size_t S>
+void JournaledBitVector<S>::flip(uint32_t index) {
+    if (index >= nums) {
+        std::cout << "Invalid index for flip operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv.flip(index);
+    record(FLIP, index);
+}
+
+template <size_t S>
+void JournaledBitVector<S>::set(uint32_t index) {
+    if (index >= nums) {
+        std::cout << "Invalid index for set operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv.set(index);
+    record(SET, index);
+}
+
+template <size_t S>
+void JournaledBitVector<S>::unset(uint32_t index) {
+    if (index >= nums) {
+        std::cout << "Invalid index for unset operation (skipping operation)" << std::endl;
+        return;
+    }
+    bv.unset(index);
+    record(UNSET, index);
+}
+
+template <size_t S>
+void JournaledBitVector<S>::complement() {
+    bv.complement();
+    record(COMPLEMENT, 0);
+}
+
+template <size_t S>
+uint32_t JournaledBitVector<S>::rank(uint32_t index, bool value) {
+    return bv.rank(index, value);
+}
+
+template <size_t S>
+uint32_t JournaledBitVector<S>::select(uint32_t num, bool value) {
+    return bv.select(num, value);
+}
+
+template <size_t S>
+bool JournaledBitVector<S>::access(uint32_t index) {
+    return bv.access(index);
+}
+
+template <size_t S>
+uint32_t JournaledBitVector<S>::size() {
+    return nums;
+}
+
+template <size_t S>
+std::vector<bool> JournaledBitVector<S>::extract() {
+    return bv.extract();
+}
+
+// counters of the journal (the snapshot bytes include the finished background checkpoints only)
+template <size_t S>
+BV_JournalStats JournaledBitVector<S>::statistics() {
+    BV_JournalStats result = stats;
+    result.checkpoints = finished;
+    result.snapshot_bytes = written;
+    return result;
+}
+
+template <size_t S>
+bool JournaledBitVector<S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+#ifdef ADS_DEBUG
+template <size_t S>
+bool JournaledBitVector<S>::validate() {
+    bool val = bv.validate() && bv.size() == nums;
+    if (!val)
+        std::cout << "Invalid journaled bitvector" << std::endl;
+    return val;
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef JOURNALEDBITVECTOR
+#define JOURNALEDBITVECTOR
+
+#include "bit_vector.hpp"
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+// when the journal is forced to the disk with fsync
+enum class BV_Sync : uint8_t {
+    none,       // never (the operating system writes the journal back eventually)
+    group,      // after every group commit
+    always      // after every operation (every operation is committed as a group of its own)
+};
+
+// counters of the journal and the checkpoints
+struct BV_JournalStats {
+    uint64_t ops;               // recorded operations
+    uint64_t groups;            // group commits (one write to the journal each)
+    uint64_t syncs;             // fsync calls on the journal
+    uint64_t journal_bytes;     // bytes appended to the journal
+    uint64_t checkpoints;       // finished checkpoints
+    uint64_t snapshot_bytes;    // bytes written by the finished checkpoints
+    uint64_t replayed;          // operations replayed by the recovery
+
+    // bytes written to the disk per byte of journal
+    double write_amplification() const {
+        return journal_bytes ? (double) (journal_bytes + snapshot_bytes) / journal_bytes : 0;
+    }
+};
+
+// dynamic bitvector whose updates are recorded in a journal in dir, so it survives a restart
+// the state on the disk is the last snapshot plus the journals of the generations since then; every operation is
+// encoded as an opcode and a varint index, the operations are collected in memory and appended as one checksummed
+// frame per group (a torn frame at the end of the journal is discarded by the recovery); a checkpoint starts a new
+// journal generation and writes the snapshot of the bits in the background, afterwards the old journal is removed
+// (the recovery loads the snapshot and replays the journals, applying runs of ascending inserts and deletes as batches)
+// errors of the files throw a std::runtime_error (those of a background checkpoint from wait_checkpoint or checkpoint)
+template <size_t S = 512>
+class JournaledBitVector {
+    private:
+        // opcodes of the journal records
+        enum Opcode : uint8_t {
+            INSERT_ZERO,
+            INSERT_ONE,
+            DEL,
+            SET,
+            UNSET,
+            FLIP,
+            COMPLEMENT
+        };
+
+        static const uint64_t SNAPSHOT_MAGIC = 0x31305350414e5342;   // "BSNAPS01"
+        static const uint32_t FRAME_HEADER = 16;                      // checksum, payload length, operations
+        static const uint32_t REPLAY_BATCH = 4096;                    // inserts and deletes applied together
+
+        BitVector<S> bv;
+        uint32_t nums;
+
+        std::string dir;
+        int journal_fd;
+        uint64_t generation;            // generation of the open journal
+        uint64_t journal_size;          // bytes of the open journal
+        BV_Sync sync;
+        uint32_t group_size;
+        uint64_t checkpoint_bytes;
+
+        std::vector<uint8_t> pending;   // encoded operations of the open group
+        uint32_t pending_ops;
+
+        std::thread checkpointer;
+        uint64_t started;               // started checkpoints
+        std::atomic<uint64_t> written;  // snapshot bytes of the finished checkpoints
+        std::atomic<uint64_t> finished;
+        std::atomic<bool> failed;       // the last checkpoint failed with the error in failure
+        std::exception_ptr failure;
+        BV_JournalStats stats;
+
+        static uint64_t checksum(const uint8_t *, size_t);
+        static void write_all(int, const uint8_t *, size_t, const std::string &);
+        static void sync_dir(const std::string &);
+
+        std::string journal_path(uint64_t);
+        std::string snapshot_path();
+        void record(Opcode, uint32_t);
+        void append_group();
+        void open_journal(uint64_t, bool);
+        void recover();
+        uint64_t replay(uint64_t);
+        void write_snapshot(const std::vector<bool> &, uint64_t);
+
+    public:
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void flip(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        void complement();
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        bool access(uint32_t);
+        uint32_t size();
+        std::vector<bool> extract();
+        void commit();
+        void checkpoint();
+        void wait_checkpoint();
+        BV_JournalStats statistics();
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        JournaledBitVector(std::string, uint32_t = 256, BV_Sync = BV_Sync::group, uint64_t = 1 << 20);
+        ~JournaledBitVector();
+        JournaledBitVector(const JournaledBitVector<S> &) = delete;
+        JournaledBitVector<S> &operator=(const JournaledBitVector<S> &) = delete;
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef MULTIBITVECTOR_IMPL
+#define MULTIBITVECTOR_IMPL
+
+#include "bits.hpp"
+#include "multi_bit_vector.hpp"
+
+template <size_t C, size_t S>
+MultiBitVector<C, S>::MultiBitVector() : AVL<MBV_Node<C, S>>() {
+    BLOCK_SIZE = S;
+    TARGET_SIZE = BLOCK_SIZE / 2;
+    SPLIT_BOUND = (BLOCK_SIZE * 3) / 4;
+    LOWER_BOUND = BLOCK_SIZE / 4;
+}
+
+// insert a row (one bit per column) at index with a single descent
+// in case the leaf is full it is split (and the tree balanced) once for all columns
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::insert(uint32_t index, std::bitset<C> values) {
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &index, 0, &ones);
+
+    if (index > leaf->nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    if (leaf->nums >= BLOCK_SIZE) {
+        leaf = this->split_block(leaf);
+        leaf = find_block(leaf, &index, 0, &ones);
+        this->root = this->fix_tree(leaf);
+    }
+
+    std::array<int32_t, C> diff;
+    for (uint32_t c = 0; c < C; c++) {
+        uint64_t *block = column(leaf, c);
+        copy_bits(block, index + 1, block, index, leaf->nums - index);
+        write_bits(block, index, 1, values[c]);
+        diff[c] = values[c];
+    }
+    propagate_update(leaf, NULL, 1, diff);
+}
+
+// remove the row at index from all columns
+// in case the resulting leaf has too few rows it is required to steal rows or merge with another leaf
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::del(uint32_t index) {
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &index, 0, &ones);
+
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    std::array<int32_t, C> diff;
+    for (uint32_t c = 0; c < C; c++) {
+        uint64_t *block = column(leaf, c);
+        diff[c] = -(int32_t) read_bits(block, index, 1);
+        copy_bits(block, index, block, index + 1, leaf->nums - index - 1);
+        write_bits(block, leaf->nums - 1, 1, 0);
+    }
+    propagate_update(leaf, NULL, -1, diff);
+
+    this->fix_underflow(leaf, LOWER_BOUND, SPLIT_BOUND);
+}
+
+// return the bits of all columns at index
+template <size_t C, size_t S>
+std::bitset<C> MultiBitVector<C, S>::row(uint32_t index) {
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &index, 0, &ones);
+    std::bitset<C> values;
+    for (uint32_t c = 0; c < C; c++)
+        values[c] = read_bits(column(leaf, c), index, 1);
+    return values;
+}
+
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::set(uint32_t col, uint32_t index) {
+    update(col, index, 1);
+}
+
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::unset(uint32_t col, uint32_t index) {
+    update(col, index, 0);
+}
+
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::flip(uint32_t col, uint32_t index) {
+    update(col, index, -1);
+}
+
+// return the bit of the column at index
+template <size_t C, size_t S>
+bool MultiBitVector<C, S>::access(uint32_t col, uint32_t index) {
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &index, col, &ones);
+    return read_bits(column(leaf, col), index, 1);
+}
+
+// count the occurrences of value in the column in front of index
+template <size_t C, size_t S>
+uint32_t MultiBitVector<C, S>::rank(uint32_t col, uint32_t index, bool value) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &offset, col, &ones);
+    if (offset > leaf->nums) {
+        index -= offset - leaf->nums;
+        offset = leaf->nums;
+    }
+
+    uint64_t *block = column(leaf, col);
+    for (uint32_t w = 0; w < offset / 64; w++)
+        ones += std::popcount(block[w]);
+    if (offset % 64)
+        ones += std::popcount(block[offset / 64] & ((1ULL << (offset % 64)) - 1));
+    return value ? ones : index - ones;
+}
+
+// find the position of the num'th occurrence of value in the column
+template <size_t C, size_t S>
+uint32_t MultiBitVector<C, S>::select(uint32_t col, uint32_t num, bool value) {
+    MBV_Node<C, S> *node = this->root;
+    uint32_t index = 0;
+    while (!this->is_leaf(node)) {
+        uint32_t num_val = value ? node->ones[col] : node->nums - node->ones[col];
+        if (num <= num_val) {
+            node = node->l;
+        } else {
+            num -= num_val;
+            index += node->nums;
+            node = node->r;
+        }
+    }
+
+    if (num == 0 || (value ? node->ones[col] : node->nums - node->ones[col]) < num) {
+        std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+    return index + select_block(node, col, num, value);
+}
+
+template <size_t C, size_t S>
+uint32_t MultiBitVector<C, S>::size() {
+    return size(this->root);
+}
+
+// collect all the bits of the column and return them as one consecutive bool vector
+template <size_t C, size_t S>
+std::vector<bool> MultiBitVector<C, S>::extract(uint32_t col) {
+    AVL_Path<MBV_Node<C, S>> path;
+    MBV_Node<C, S> *leaf = this->first_leaf(this->root, &path);
+    std::vector<bool> bits;
+    while (leaf) {
+        uint64_t *block = column(leaf, col);
+        for (uint32_t i = 0; i < leaf->nums; i++)
+            bits.push_back((block[i / 64] >> (i % 64)) & 1);
+        leaf = this->next_leaf(&path);
+    }
+    return bits;
+}
+
+// return the words of the block of the column in the leaf
+template <size_t C, size_t S>
+uint64_t *MultiBitVector<C, S>::column(MBV_Node<C, S> *leaf, uint32_t col) {
+    return leaf->data->data() + col * WORDS;
+}
+
+// find the leaf that contains the row at the position index and count the ones of the column in front of that leaf
+// index is updated as well to locate the row inside the leaf block
+template <size_t C, size_t S>
+MBV_Node<C, S> *MultiBitVector<C, S>::find_block(MBV_Node<C, S> *node, uint32_t *index, uint32_t col, uint32_t *ones) {
+    this->record(node);
+    while (!this->is_leaf(node)) {
+        if (*index < node->nums) {
+            node = node->l;
+        } else {
+            *index -= node->nums;
+            *ones += node->ones[col];
+            node = node->r;
+        }
+        this->record(node);
+    }
+    return node;
+}
+
+// return the position of the num'th occurrence of value inside the block of the column
+template <size_t C, size_t S>
+uint32_t MultiBitVector<C, S>::select_block(MBV_Node<C, S> *leaf, uint32_t col, uint32_t num, bool value) {
+    uint64_t *block = column(leaf, col);
+    for (uint32_t w = 0; w * 64 < leaf->nums; w++) {
+        uint64_t word = value ? block[w] : ~block[w];
+        if ((w + 1) * 64 > leaf->nums)
+            word &= (1ULL << (leaf->nums % 64)) - 1;    // drop the bits behind the last row of the leaf
+        uint32_t count = std::popcount(word);
+        if (num > count) {
+            num -= count;
+            continue;
+        }
+        while (--num)
+            word &= word - 1;
+        return w * 64 + std::countr_zero(word);
+    }
+    return -1;
+}
+
+// set (value 1), unset (value 0) or flip (value -1) the bit of the column at index
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::update(uint32_t col, uint32_t index, int value) {
+    uint32_t ones = 0;
+    MBV_Node<C, S> *leaf = find_block(this->root, &index, col, &ones);
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for update operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    uint64_t *block = column(leaf, col);
+    int32_t old_value = read_bits(block, index, 1);
+    int32_t new_value = value < 0 ? !old_value : value;
+    write_bits(block, index, 1, new_value);
+    std::array<int32_t, C> diff = {};
+    diff[col] = new_value - old_value;
+    propagate_update(leaf, NULL, 0, diff);
+}
+
+template <size_t C, size_t S>
+uint32_t MultiBitVector<C, S>::size(MBV_Node<C, S> *node) {
+    if (!node)
+        return 0;
+    return node->nums + size(node->r);
+}
+
+// copy count rows (all columns) from position from of the source leaf to position to of the target leaf
+// (the ranges may overlap if both leaves are the same); returns the number of copied ones per column
+template <size_t C, size_t S>
+std::array<int32_t, C> MultiBitVector<C, S>::move(MBV_Node<C, S> *target, uint32_t to, MBV_Node<C, S> *source, uint32_t from, uint32_t count) {
+    std::array<int32_t, C> ones;
+    for (uint32_t c = 0; c < C; c++)
+        ones[c] = copy_bits(column(target, c), to, column(source, c), from, count);
+    return ones;
+}
+
+// propagate changes in nodes up the tree to keep the navigation structure correct
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::propagate_update(MBV_Node<C, S> *node, MBV_Node<C, S> *prev_node, int32_t nums, const std::array<int32_t, C> &ones) {
+    this->propagate(node, prev_node, [&](MBV_Node<C, S> *node, bool left) {
+        if (left) {
+            node->nums += nums;
+            for (uint32_t c = 0; c < C; c++)
+                node->ones[c] += ones[c];
+        }
+    });
+}
+
+// update the data in the three nodes (parent and both child nodes) involved in the operation
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::split_block_update(MBV_Node<C, S> *node, MBV_Node<C, S> *left, MBV_Node<C, S> *right) {
+    std::array<int32_t, C> left_ones = move(left, 0, node, 0, TARGET_SIZE);
+    std::array<int32_t, C> right_ones = move(right, 0, node, TARGET_SIZE, node->nums - TARGET_SIZE);
+    left->nums = TARGET_SIZE;
+    right->nums = node->nums - TARGET_SIZE;
+    for (uint32_t c = 0; c < C; c++) {
+        left->ones[c] = left_ones[c];
+        right->ones[c] = right_ones[c];
+    }
+    delete node->data;
+    node->data = NULL;
+    node->nums = left->nums;
+    node->ones = left->ones;
+    propagate_update(node, NULL, 0, {});
+}
+
+// take some rows from the left 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::steal_left(MBV_Node<C, S> *node, MBV_Node<C, S> *prev_leaf) {
+    uint32_t steal = (prev_leaf->nums - node->nums) / 2;
+    move(node, steal, node, 0, node->nums);
+    std::array<int32_t, C> ones = move(node, 0, prev_leaf, prev_leaf->nums - steal, steal);
+    std::array<int32_t, C> lost;
+    for (uint32_t c = 0; c < C; c++) {
+        clear_bits(column(prev_leaf, c), prev_leaf->nums - steal, steal);
+        lost[c] = -ones[c];
+    }
+
+    propagate_update(node, NULL, steal, ones);
+    propagate_update(prev_leaf, NULL, -steal, lost);
+}
+
+// take some rows from the right 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::steal_right(MBV_Node<C, S> *node, MBV_Node<C, S> *next_leaf) {
+    uint32_t steal = (next_leaf->nums - node->nums) / 2;
+    std::array<int32_t, C> ones = move(node, node->nums, next_leaf, 0, steal);
+    move(next_leaf, 0, next_leaf, steal, next_leaf->nums - steal);
+    std::array<int32_t, C> lost;
+    for (uint32_t c = 0; c < C; c++) {
+        clear_bits(column(next_leaf, c), next_leaf->nums - steal, steal);
+        lost[c] = -ones[c];
+    }
+
+    propagate_update(node, NULL, steal, ones);
+    propagate_update(next_leaf, NULL, -steal, lost);
+}
+
+// process the changes required after a left merge
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::merge_left_pre_update(MBV_Node<C, S> *node, MBV_Node<C, S> *prev_leaf) {
+    move(node, prev_leaf->nums, node, 0, node->nums);
+    std::array<int32_t, C> ones = move(node, 0, prev_leaf, 0, prev_leaf->nums);
+    std::array<int32_t, C> lost;
+    for (uint32_t c = 0; c < C; c++)
+        lost[c] = -ones[c];
+    propagate_update(node, NULL, prev_leaf->nums, ones);
+    propagate_update(prev_leaf, NULL, -prev_leaf->nums, lost);
+}
+
+// process the changes required after a right merge
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::merge_right_pre_update(MBV_Node<C, S> *node, MBV_Node<C, S> *next_leaf) {
+    std::array<int32_t, C> ones = move(node, node->nums, next_leaf, 0, next_leaf->nums);
+    std::array<int32_t, C> lost;
+    for (uint32_t c = 0; c < C; c++)
+        lost[c] = -ones[c];
+    propagate_update(node, NULL, next_leaf->nums, ones);
+    propagate_update(next_leaf, NULL, -next_leaf->nums, lost);
+}
+
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::merge_post_update(MBV_Node<C, S> *node) {
+    propagate_update(node, NULL, 0, {});
+}
+
+// process the changes required after a left rotation
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::rotate_left_update(MBV_Node<C, S> *node) {
+    node->nums += node->l->nums;
+    for (uint32_t c = 0; c < C; c++)
+        node->ones[c] += node->l->ones[c];
+}
+
+// process the changes required after a right rotation
+template <size_t C, size_t S>
+void MultiBitVector<C, S>::rotate_right_update(MBV_Node<C, S> *node) {
+    node->r->nums -= node->nums;
+    for (uint32_t c = 0; c < C; c++)
+        node->r->ones[c] -= node->ones[c];
+}
+
+#ifdef ADS_DEBUG
+template <size_t C, size_t S>
+bool MultiBitVector<C, S>::validate() {
+    uint32_t nums;
+    std::array<uint32_t, C> ones;
+    bool val = validate(this->root, &nums, &ones);
+    if (!val)
+        std::cout << "Nicht valider Baum" << std::endl;
+    return val;
+}
+
+// check the counters of all nodes against the blocks; the number of rows and the ones per column are returned
+template <size_t C, size_t S>
+bool MultiBitVector<C, S>::validate(MBV_Node<C, S> *node, uint32_t *nums, std::array<uint32_t, C> *ones) {
+    if (this->is_leaf(node)) {
+        *nums = node->nums;
+        *ones = node->ones;
+        for (uint32_t c = 0; c < C; c++) {
+            uint32_t count = 0;
+            for (uint32_t w = 0; w < WORDS; w++)
+                count += std::popcount(column(node, c)[w]);
+            if (count != node->ones[c])
+                return false;
+        }
+        return node->height == 1;
+    }
+
+    uint32_t nums_r;
+    std::array<uint32_t, C> ones_r;
+    if (!validate(node->l, nums, ones) || !validate(node->r, &nums_r, &ones_r))
+        return false;
+    if (node->nums != *nums || node->ones != *ones || node->height != std::max(node->l->height, node->r->height) + 1)
+        return false;
+    *nums += nums_r;
+    for (uint32_t c = 0; c < C; c++)
+        (*ones)[c] += ones_r[c];
+    return true;
+}
+#endif
+
+#endif
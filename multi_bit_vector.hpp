@@ -0,0 +1,91 @@
+#ifndef MULTIBITVECTOR
+#define MULTIBITVECTOR
+
+#include "avl.hpp"
+
+#include <vector>
+#include <array>
+#include <bitset>
+
+// encapsualte the members that are needed for the multi column bitvector tree structure
+// (inner nodes store the counters of the left subtree, leaves their own counters and the blocks of all columns)
+template <size_t C, size_t S>
+struct MBV_Node : Node<MBV_Node<C, S>> {
+    static const size_t WORDS = (S + 63) / 64;
+
+    uint32_t nums;
+    std::array<uint32_t, C> ones;
+    std::array<uint64_t, C * WORDS> *data;     // the block of column c starts at word c * WORDS
+
+    MBV_Node() {
+        nums = 0;
+        ones.fill(0);
+        data = new std::array<uint64_t, C * WORDS>();
+    }
+
+    ~MBV_Node() {
+        delete data;
+    }
+};
+
+// C parallel bitvectors that share their positions (inserts and deletes always affect all columns)
+// one tree of positions is kept for all columns, its nodes store a ones counter per column
+// (inside a block the bit at position i is stored in bit i % 64 of word i / 64)
+template <size_t C, size_t S = 512>
+class MultiBitVector : public AVL<MBV_Node<C, S>> {
+    static_assert(C >= 1, "at least one column is required");
+
+    private:
+        static const size_t WORDS = MBV_Node<C, S>::WORDS;
+
+        size_t BLOCK_SIZE;
+        size_t TARGET_SIZE;
+        size_t SPLIT_BOUND;
+        size_t LOWER_BOUND;
+
+        uint64_t *column(MBV_Node<C, S> *, uint32_t);
+        MBV_Node<C, S> *find_block(MBV_Node<C, S> *, uint32_t *, uint32_t, uint32_t *);
+        uint32_t select_block(MBV_Node<C, S> *, uint32_t, uint32_t, bool);
+        void update(uint32_t, uint32_t, int);
+        uint32_t size(MBV_Node<C, S> *);
+        std::array<int32_t, C> move(MBV_Node<C, S> *, uint32_t, MBV_Node<C, S> *, uint32_t, uint32_t);
+
+        #ifdef ADS_DEBUG
+        bool validate(MBV_Node<C, S> *, uint32_t *, std::array<uint32_t, C> *);
+        #endif
+
+        void propagate_update(MBV_Node<C, S> *, MBV_Node<C, S> *, int32_t, const std::array<int32_t, C> &);
+
+        void split_block_update(MBV_Node<C, S> *, MBV_Node<C, S> *, MBV_Node<C, S> *);
+
+        void steal_left(MBV_Node<C, S> *, MBV_Node<C, S> *);
+        void steal_right(MBV_Node<C, S> *, MBV_Node<C, S> *);
+
+        void merge_left_pre_update(MBV_Node<C, S> *, MBV_Node<C, S> *);
+        void merge_right_pre_update(MBV_Node<C, S> *, MBV_Node<C, S> *);
+        void merge_post_update(MBV_Node<C, S> *);
+
+        void rotate_left_update(MBV_Node<C, S> *);
+        void rotate_right_update(MBV_Node<C, S> *);
+
+    public:
+        void insert(uint32_t, std::bitset<C>);
+        void del(uint32_t);
+        std::bitset<C> row(uint32_t);
+        void set(uint32_t, uint32_t);
+        void unset(uint32_t, uint32_t);
+        void flip(uint32_t, uint32_t);
+        bool access(uint32_t, uint32_t);
+        uint32_t rank(uint32_t, uint32_t, bool);
+        uint32_t select(uint32_t, uint32_t, bool);
+        uint32_t size();
+        std::vector<bool> extract(uint32_t);
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        MultiBitVector();
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef NUMA_DEF
+#define NUMA_DEF
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// granularity of the memory policies (slabs with a placement own their pages)
+const size_t NUMA_PAGE = 4096;
+
+// where the pages of a slab are placed
+enum class NumaPolicy : uint8_t {
+    local,          // on the node of the thread that touches them first (the default of the system)
+    interleave,     // round robin over all nodes
+    bind            // on a single node
+};
+
+// placement of the slabs of a tree (see NumaTopology for the construction)
+// present holds a bit for every node that exists on this machine; policies for other nodes of a simulated
+// topology are only recorded, so placements and replicas behave the same on a single node machine
+struct NumaPlacement {
+    NumaPolicy policy;
+    uint32_t node;      // node of bind
+    uint32_t nodes;     // number of nodes (interleave spreads over all of them)
+    uint64_t present;
+};
+
+// node the calling thread reads from if it was declared with numa_set_home (-1: the node of its cpu)
+inline thread_local int32_t numa_home = -1;
+
+// declare the node that the calling thread runs on (a thread that is pinned to a socket saves the lookup of its cpu,
+// a simulated topology uses it to spread threads over nodes that do not exist); -1 reverts to the cpu of the thread
+inline void numa_set_home(int32_t node) {
+    numa_home = node;
+}
+
+// parse a list of ranges like "0-3,8,10-11" as it is used by the files in /sys/devices/system/node
+inline std::vector<uint32_t> numa_parse_list(const std::string &list) {
+    std::vector<uint32_t> values;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range[0] < '0' || range[0] > '9')
+            continue;
+        size_t dash = range.find('-');
+        uint32_t first = std::stoul(range.substr(0, dash));
+        uint32_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+        for (uint32_t value = first; value <= last; value++)
+            values.push_back(value);
+    }
+    return values;
+}
+
+// memory nodes (sockets) of the machine and the node of every cpu
+struct NumaTopology {
+    uint32_t nodes;
+    uint64_t present;                   // nodes that exist on this machine (bit per node)
+    std::vector<uint32_t> cpu_node;     // node of every cpu
+
+    // read the topology of this machine (a single node with all cpus if it is not available)
+    static NumaTopology detect() {
+        uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        NumaTopology topology = {1, 1, std::vector<uint32_t>(cpus, 0)};
+        std::string line;
+        std::ifstream online("/sys/devices/system/node/online");
+        if (!std::getline(online, line))
+            return topology;
+        topology.present = 0;
+        for (auto node : numa_parse_list(line)) {
+            if (node >= 64)
+                continue;
+            topology.nodes = std::max(topology.nodes, node + 1);
+            topology.present |= 1ull << node;
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!std::getline(cpulist, line))
+                continue;
+            for (auto cpu : numa_parse_list(line)) {
+                if (cpu >= topology.cpu_node.size())
+                    topology.cpu_node.resize(cpu + 1, 0);
+                topology.cpu_node[cpu] = node;
+            }
+        }
+        if (!topology.present)
+            topology.present = 1;
+        return topology;
+    }
+
+    // a topology of nodes nodes with the cpus of this machine split evenly among them (the nodes that do not exist
+    // on this machine only exist on paper; their threads have to declare their node with numa_set_home)
+    static NumaTopology simulate(uint32_t nodes) {
+        nodes = std::clamp(nodes, 1u, 64u);
+        NumaTopology real = detect();
+        uint32_t cpus = real.cpu_node.size();
+        NumaTopology topology = {nodes, real.present, std::vector<uint32_t>(cpus)};
+        for (uint32_t cpu = 0; cpu < cpus; cpu++)
+            topology.cpu_node[cpu] = (uint64_t) cpu * nodes / cpus;
+        return topology;
+    }
+
+    // node of the calling thread (its home node if it declared one)
+    uint32_t current_node() const {
+        if (numa_home >= 0)
+            return numa_home % nodes;
+        #ifdef __linux__
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (uint32_t) cpu < cpu_node.size())
+            return cpu_node[cpu];
+        #endif
+        return 0;
+    }
+
+    NumaPlacement local() const {
+        return {NumaPolicy::local, 0, nodes, present};
+    }
+
+    NumaPlacement interleave() const {
+        return {NumaPolicy::interleave, 0, nodes, present};
+    }
+
+    NumaPlacement bind(uint32_t node) const {
+        return {NumaPolicy::bind, node % nodes, nodes, present};
+    }
+};
+
+// request the placement for the pages of memory (page aligned) from the kernel before they are touched
+// the placement is a hint: nodes that do not exist (simulated) and failures (e.g. a restricted cpuset) leave the
+// pages where first touch puts them
+inline void numa_place(void *memory, size_t bytes, const NumaPlacement &placement) {
+    #ifdef __linux__
+    unsigned long mask = 0;
+    int mode = MPOL_DEFAULT;
+    if (placement.policy == NumaPolicy::bind) {
+        mask = placement.node < 64 ? (1ull << placement.node) & placement.present : 0;
+        mode = MPOL_BIND;
+    } else if (placement.policy == NumaPolicy::interleave) {
+        mask = (placement.nodes >= 64 ? ~0ull : (1ull << placement.nodes) - 1) & placement.present;
+        mode = MPOL_INTERLEAVE;
+    }
+    if (mask)
+        syscall(SYS_mbind, memory, bytes, mode, &mask, 64, MPOL_MF_MOVE);
+    #else
+    (void) memory;
+    (void) bytes;
+    (void) placement;
+    #endif
+}
+
+// policy that the kernel applies to the page at address (local if it cannot be queried)
+inline NumaPolicy numa_policy_of(void *address) {
+    #ifdef __linux__
+    int mode;
+    unsigned long mask = 0;
+    if (syscall(SYS_get_mempolicy, &mode, &mask, 64, address, MPOL_F_ADDR) == 0) {
+        if (mode == MPOL_BIND)
+            return NumaPolicy::bind;
+        if (mode == MPOL_INTERLEAVE)
+            return NumaPolicy::interleave;
+    }
+    #else
+    (void) address;
+    #endif
+    return NumaPolicy::local;
+}
+
+#endif
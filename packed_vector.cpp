@@ -0,0 +1,386 @@
+#ifndef PACKEDVECTOR_IMPL
+#define PACKEDVECTOR_IMPL
+
+#include "packed_vector.hpp"
+
+#include <algorithm>
+
+template <size_t K, size_t S>
+PackedVector<K, S>::PackedVector() : AVL<PV_Node<K, S>>() {
+    BLOCK_SIZE = S / K;
+    TARGET_SIZE = BLOCK_SIZE / 2;
+    SPLIT_BOUND = (BLOCK_SIZE * 3) / 4;
+    LOWER_BOUND = BLOCK_SIZE / 4;
+}
+
+// construct the packed vector tree structure from the provided integers
+template <size_t K, size_t S>
+PackedVector<K, S>::PackedVector(std::vector<uint64_t> values) : PackedVector() {
+    uint32_t num_leafs = (values.size() + TARGET_SIZE - 1) / TARGET_SIZE;
+
+    this->build_balanced_tree(NULL, num_leafs);
+    AVL_Path<PV_Node<K, S>> path;
+    PV_Node<K, S> *leaf = this->first_leaf(this->root, &path);
+    for (uint32_t i = 0; i < num_leafs; i++) {
+        uint32_t count = 0;
+        uint64_t sum = 0;
+        for (uint32_t j = 0; j < TARGET_SIZE && i * TARGET_SIZE + j < values.size(); j++, count++) {
+            put(leaf, j, values[i * TARGET_SIZE + j]);
+            sum += values[i * TARGET_SIZE + j] & MASK;
+        }
+        leaf->nums = count;
+        leaf->sum = sum;
+        leaf = this->next_leaf(&path);
+    }
+    uint32_t nums;
+    uint64_t sum;
+    recount(this->root, &nums, &sum);
+}
+
+// insert the value at the given index
+// in case the leaf of the insertion block is full this node needs to be split
+template <size_t K, size_t S>
+void PackedVector<K, S>::insert(uint32_t index, uint64_t value) {
+    uint64_t sum = 0;
+    PV_Node<K, S> *leaf = find_block(this->root, &index, &sum);
+
+    if (index > leaf->nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    // block is full; a split is required
+    // it might be necessary to balance the tree afterwards
+    if (leaf->nums >= BLOCK_SIZE) {
+        leaf = this->split_block(leaf);
+        leaf = find_block(leaf, &index, &sum);
+        this->root = this->fix_tree(leaf);
+    }
+
+    value &= MASK;
+    move(leaf, index + 1, leaf, index, leaf->nums - index);
+    put(leaf, index, value);
+    propagate_update(leaf, NULL, 1, value);
+}
+
+// remove the value at the given index
+// in case the resulting leaf has too few elements it is required to steal elements or merge with another leaf
+template <size_t K, size_t S>
+void PackedVector<K, S>::del(uint32_t index) {
+    uint64_t sum = 0;
+    PV_Node<K, S> *leaf = find_block(this->root, &index, &sum);
+
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    uint64_t value = get(leaf, index);
+    move(leaf, index, leaf, index + 1, leaf->nums - index - 1);
+    put(leaf, leaf->nums - 1, 0);
+    propagate_update(leaf, NULL, -1, -value);
+
+    this->fix_underflow(leaf, LOWER_BOUND, SPLIT_BOUND);
+}
+
+// replace the value at the given index
+template <size_t K, size_t S>
+void PackedVector<K, S>::set(uint32_t index, uint64_t value) {
+    uint64_t sum = 0;
+    PV_Node<K, S> *leaf = find_block(this->root, &index, &sum);
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for set operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    value &= MASK;
+    int64_t diff = (int64_t) value - (int64_t) get(leaf, index);
+    put(leaf, index, value);
+    propagate_update(leaf, NULL, 0, diff);
+}
+
+// return the value at the given index
+template <size_t K, size_t S>
+uint64_t PackedVector<K, S>::access(uint32_t index) {
+    uint64_t sum = 0;
+    PV_Node<K, S> *leaf = find_block(this->root, &index, &sum);
+    return get(leaf, index);
+}
+
+// calculate the sum of the values in front of index
+template <size_t K, size_t S>
+uint64_t PackedVector<K, S>::sum(uint32_t index) {
+    uint64_t sum = 0;
+    PV_Node<K, S> *leaf = find_block(this->root, &index, &sum);
+    return sum + block_sum(leaf, 0, std::min(index, leaf->nums));
+}
+
+// find the smallest index at which the prefix sum (including the value at index) reaches x
+// returns -1 if the sum of all values is smaller than x
+template <size_t K, size_t S>
+uint32_t PackedVector<K, S>::search(uint64_t x) {
+    PV_Node<K, S> *node = this->root;
+    uint32_t index = 0;
+    while (!this->is_leaf(node)) {
+        if (x <= node->sum) {
+            node = node->l;
+        } else {
+            x -= node->sum;
+            index += node->nums;
+            node = node->r;
+        }
+    }
+
+    for (uint32_t i = 0; i < node->nums; i++) {
+        uint64_t value = get(node, i);
+        if (x <= value)
+            return index + i;
+        x -= value;
+    }
+    return -1;
+}
+
+template <size_t K, size_t S>
+uint32_t PackedVector<K, S>::size() {
+    return size(this->root);
+}
+
+// collect all the values in the packed vector and return them as one consecutive vector
+template <size_t K, size_t S>
+std::vector<uint64_t> PackedVector<K, S>::extract() {
+    AVL_Path<PV_Node<K, S>> path;
+    PV_Node<K, S> *node = this->first_leaf(this->root, &path);
+    std::vector<uint64_t> values;
+    while (node) {
+        for (uint32_t i = 0; i < node->nums; i++)
+            values.push_back(get(node, i));
+        node = this->next_leaf(&path);
+    }
+    return values;
+}
+
+template <size_t K, size_t S>
+uint64_t PackedVector<K, S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+// read the index'th integer of the leaf block
+template <size_t K, size_t S>
+uint64_t PackedVector<K, S>::get(PV_Node<K, S> *leaf, uint32_t index) {
+    uint64_t *words = leaf->data->data();
+    uint32_t bit = index * K;
+    uint32_t offset = bit % 64;
+    uint64_t value = words[bit / 64] >> offset;
+    if (offset + K > 64)
+        value |= words[bit / 64 + 1] << (64 - offset);
+    return value & MASK;
+}
+
+// write the index'th integer of the leaf block
+template <size_t K, size_t S>
+void PackedVector<K, S>::put(PV_Node<K, S> *leaf, uint32_t index, uint64_t value) {
+    uint64_t *words = leaf->data->data();
+    uint32_t bit = index * K;
+    uint32_t offset = bit % 64;
+    words[bit / 64] = (words[bit / 64] & ~(MASK << offset)) | (value << offset);
+    if (offset + K > 64) {
+        uint32_t shift = 64 - offset;
+        words[bit / 64 + 1] = (words[bit / 64 + 1] & ~(MASK >> shift)) | (value >> shift);
+    }
+}
+
+// copy count integers from position from of the source leaf to position to of the target leaf
+// (the ranges may overlap if both leaves are the same)
+template <size_t K, size_t S>
+void PackedVector<K, S>::move(PV_Node<K, S> *target, uint32_t to, PV_Node<K, S> *source, uint32_t from, uint32_t count) {
+    if (to > from && target == source) {
+        for (uint32_t i = count; i-- > 0;)
+            put(target, to + i, get(source, from + i));
+    } else {
+        for (uint32_t i = 0; i < count; i++)
+            put(target, to + i, get(source, from + i));
+    }
+}
+
+// sum of the integers in [from, to) of the leaf block
+template <size_t K, size_t S>
+uint64_t PackedVector<K, S>::block_sum(PV_Node<K, S> *leaf, uint32_t from, uint32_t to) {
+    uint64_t sum = 0;
+    for (uint32_t i = from; i < to; i++)
+        sum += get(leaf, i);
+    return sum;
+}
+
+// find the leaf that contains the integer at the position index and sum up the integers in front of that leaf
+// index is updated as well to locate the integer inside the leaf block
+template <size_t K, size_t S>
+PV_Node<K, S> *PackedVector<K, S>::find_block(PV_Node<K, S> *node, uint32_t *index, uint64_t *sum) {
+    this->record(node);
+    if (this->is_leaf(node))
+        return node;
+    if (*index < node->nums)
+        return find_block(node->l, index, sum);
+    *index -= node->nums;
+    *sum += node->sum;
+    return find_block(node->r, index, sum);
+}
+
+// calculate the number of integers that are stored in the structure
+template <size_t K, size_t S>
+uint32_t PackedVector<K, S>::size(PV_Node<K, S> *node) {
+    if (!node)
+        return 0;
+    return node->nums + size(node->r);
+}
+
+// recompute the counters (nums, sum, height) of all inner nodes from the leaves in one bottom up pass
+// the number of integers and their sum in the subtree are returned via nums and sum
+template <size_t K, size_t S>
+void PackedVector<K, S>::recount(PV_Node<K, S> *node, uint32_t *nums, uint64_t *sum) {
+    if (this->is_leaf(node)) {
+        node->height = 1;
+        *nums = node->nums;
+        *sum = node->sum;
+        return;
+    }
+
+    uint32_t nums_r;
+    uint64_t sum_r;
+    recount(node->l, &node->nums, &node->sum);
+    recount(node->r, &nums_r, &sum_r);
+    delete node->data;      // inner nodes created by build_balanced_tree still carry a block
+    node->data = NULL;
+    node->height = 1 + std::max(node->l->height, node->r->height);
+    *nums = node->nums + nums_r;
+    *sum = node->sum + sum_r;
+}
+
+// propagate changes in nodes up the tree to keep the navigation structure correct
+template <size_t K, size_t S>
+void PackedVector<K, S>::propagate_update(PV_Node<K, S> *node, PV_Node<K, S> *prev_node, int32_t nums, int64_t sum) {
+    this->propagate(node, prev_node, [&](PV_Node<K, S> *node, bool left) {
+        if (left) {
+            node->nums += nums;
+            node->sum += sum;
+        }
+    });
+}
+
+// update the data in the three nodes (parent and both child nodes) involved in the operation
+template <size_t K, size_t S>
+void PackedVector<K, S>::split_block_update(PV_Node<K, S> *node, PV_Node<K, S> *left, PV_Node<K, S> *right) {
+    move(left, 0, node, 0, TARGET_SIZE);
+    move(right, 0, node, TARGET_SIZE, node->nums - TARGET_SIZE);
+    left->nums = TARGET_SIZE;
+    right->nums = node->nums - TARGET_SIZE;
+    left->sum = block_sum(left, 0, left->nums);
+    right->sum = node->sum - left->sum;
+    delete node->data;
+    node->data = NULL;
+    node->nums = left->nums;
+    node->sum = left->sum;
+    propagate_update(node, NULL, 0, 0);
+}
+
+// take some integers from the left 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t K, size_t S>
+void PackedVector<K, S>::steal_left(PV_Node<K, S> *node, PV_Node<K, S> *prev_leaf) {
+    uint32_t steal = (prev_leaf->nums - node->nums) / 2;
+    uint32_t from = prev_leaf->nums - steal;
+    uint64_t sum = block_sum(prev_leaf, from, prev_leaf->nums);
+
+    move(node, steal, node, 0, node->nums);
+    move(node, 0, prev_leaf, from, steal);
+    for (uint32_t i = from; i < prev_leaf->nums; i++)
+        put(prev_leaf, i, 0);
+
+    propagate_update(node, NULL, steal, sum);
+    propagate_update(prev_leaf, NULL, -steal, -sum);
+}
+
+// take some integers from the right 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t K, size_t S>
+void PackedVector<K, S>::steal_right(PV_Node<K, S> *node, PV_Node<K, S> *next_leaf) {
+    uint32_t steal = (next_leaf->nums - node->nums) / 2;
+    uint64_t sum = block_sum(next_leaf, 0, steal);
+
+    move(node, node->nums, next_leaf, 0, steal);
+    move(next_leaf, 0, next_leaf, steal, next_leaf->nums - steal);
+    for (uint32_t i = next_leaf->nums - steal; i < next_leaf->nums; i++)
+        put(next_leaf, i, 0);
+
+    propagate_update(node, NULL, steal, sum);
+    propagate_update(next_leaf, NULL, -steal, -sum);
+}
+
+// process the changes required after a left merge
+template <size_t K, size_t S>
+void PackedVector<K, S>::merge_left_pre_update(PV_Node<K, S> *node, PV_Node<K, S> *prev_leaf) {
+    move(node, prev_leaf->nums, node, 0, node->nums);
+    move(node, 0, prev_leaf, 0, prev_leaf->nums);
+    propagate_update(node, NULL, prev_leaf->nums, prev_leaf->sum);
+    propagate_update(prev_leaf, NULL, -prev_leaf->nums, -prev_leaf->sum);
+}
+
+// process the changes required after a right merge
+template <size_t K, size_t S>
+void PackedVector<K, S>::merge_right_pre_update(PV_Node<K, S> *node, PV_Node<K, S> *next_leaf) {
+    move(node, node->nums, next_leaf, 0, next_leaf->nums);
+    propagate_update(node, NULL, next_leaf->nums, next_leaf->sum);
+    propagate_update(next_leaf, NULL, -next_leaf->nums, -next_leaf->sum);
+}
+
+template <size_t K, size_t S>
+void PackedVector<K, S>::merge_post_update(PV_Node<K, S> *node) {
+    propagate_update(node, NULL, 0, 0);
+}
+
+// process the changes required after a left rotation
+template <size_t K, size_t S>
+void PackedVector<K, S>::rotate_left_update(PV_Node<K, S> *node) {
+    node->nums += node->l->nums;
+    node->sum += node->l->sum;
+}
+
+// process the changes required after a right rotation
+template <size_t K, size_t S>
+void PackedVector<K, S>::rotate_right_update(PV_Node<K, S> *node) {
+    node->r->nums -= node->nums;
+    node->r->sum -= node->sum;
+}
+
+#ifdef ADS_DEBUG
+template <size_t K, size_t S>
+bool PackedVector<K, S>::validate() {
+    uint32_t nums;
+    uint64_t sum;
+    bool val = validate(this->root, &nums, &sum);
+    if (!val)
+        std::cout << "Nicht valider Baum" << std::endl;
+    return val;
+}
+
+// check the counters of all nodes; the number of integers and their sum in the subtree are returned
+template <size_t K, size_t S>
+bool PackedVector<K, S>::validate(PV_Node<K, S> *node, uint32_t *nums, uint64_t *sum) {
+    if (this->is_leaf(node)) {
+        *nums = node->nums;
+        *sum = node->sum;
+        return node->sum == block_sum(node, 0, node->nums) && node->height == 1;
+    }
+
+    uint32_t nums_r;
+    uint64_t sum_r;
+    if (!validate(node->l, nums, sum) || !validate(node->r, &nums_r, &sum_r))
+        return false;
+    if (node->nums != *nums || node->sum != *sum || node->height != std::max(node->l->height, node->r->height) + 1 || node->data)
+        return false;
+    *nums += nums_r;
+    *sum += sum_r;
+    return true;
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PACKEDVECTOR
+#define PACKEDVECTOR
+
+#include "avl.hpp"
+
+#include <vector>
+#include <array>
+
+// encapsualte the members that are needed for the packed vector tree structure
+// (inner nodes store the number of elements and their sum for the left subtree, leaves for their own block)
+template <size_t K, size_t S>
+struct PV_Node : Node<PV_Node<K, S>> {
+    static const size_t WORDS = (S + 63) / 64;
+
+    uint32_t nums;
+    uint64_t sum;
+    std::array<uint64_t, WORDS> *data;
+
+    PV_Node() {
+        nums = 0;
+        sum = 0;
+        data = new std::array<uint64_t, WORDS>();
+    }
+
+    ~PV_Node() {
+        delete data;
+    }
+};
+
+// represents a dynamic sequence of K bit integers (1 <= K <= 64) that allows for inserts and deletes everywhere
+//  as well as prefix sum and search queries; each leaf packs S / K integers into a block of S bits
+template <size_t K, size_t S = 512>
+class PackedVector : public AVL<PV_Node<K, S>> {
+    static_assert(K >= 1 && K <= 64, "the integers need to have between 1 and 64 bits");
+    static_assert(S / K >= 4, "a block needs to hold at least four integers");
+
+    private:
+        static const uint64_t MASK = K == 64 ? ~0ULL : (1ULL << K) - 1;
+
+        size_t BLOCK_SIZE;
+        size_t TARGET_SIZE;
+        size_t SPLIT_BOUND;
+        size_t LOWER_BOUND;
+
+        uint64_t get(PV_Node<K, S> *, uint32_t);
+        void put(PV_Node<K, S> *, uint32_t, uint64_t);
+        void move(PV_Node<K, S> *, uint32_t, PV_Node<K, S> *, uint32_t, uint32_t);
+        uint64_t block_sum(PV_Node<K, S> *, uint32_t, uint32_t);
+
+        PV_Node<K, S> *find_block(PV_Node<K, S> *, uint32_t *, uint64_t *);
+        uint32_t size(PV_Node<K, S> *);
+        void recount(PV_Node<K, S> *, uint32_t *, uint64_t *);
+
+        #ifdef ADS_DEBUG
+        bool validate(PV_Node<K, S> *, uint32_t *, uint64_t *);
+        #endif
+
+        void propagate_update(PV_Node<K, S> *, PV_Node<K, S> *, int32_t, int64_t);
+
+        void split_block_update(PV_Node<K, S> *, PV_Node<K, S> *, PV_Node<K, S> *);
+
+        void steal_left(PV_Node<K, S> *, PV_Node<K, S> *);
+        void steal_right(PV_Node<K, S> *, PV_Node<K, S> *);
+
+        void merge_left_pre_update(PV_Node<K, S> *, PV_Node<K, S> *);
+        void merge_right_pre_update(PV_Node<K, S> *, PV_Node<K, S> *);
+        void merge_post_update(PV_Node<K, S> *);
+
+        void rotate_left_update(PV_Node<K, S> *);
+        void rotate_right_update(PV_Node<K, S> *);
+
+    public:
+        void insert(uint32_t, uint64_t);
+        void del(uint32_t);
+        void set(uint32_t, uint64_t);
+        uint64_t access(uint32_t);
+        uint64_t sum(uint32_t);
+        uint32_t search(uint64_t);
+        uint32_t size();
+        std::vector<uint64_t> extract();
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        uint64_t operator[](uint32_t);
+
+        PackedVector();
+        PackedVector(std::vector<uint64_t>);
+};
+
+#endif
@@ -0,0 +1,575 @@
+#ifndef PAGEDBITVECTOR_IMPL
+#define PAGEDBITVECTOR_IMPL
+
+#include "bits.hpp"
+#include "paged_bit_vector.hpp"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+// create an anonymous page file in dir (it is removed as soon as it is opened) and frames for the pages
+template <size_t S>
+BufferPool<S>::BufferPool(std::string dir, uint32_t capacity) {
+    std::string path = dir + "/bitvector.XXXXXX";
+    fd = mkstemp(path.data());
+    if (fd < 0)
+        throw std::runtime_error("Could not create a page file in " + dir);
+    unlink(path.c_str());
+
+    pages = 0;
+    stats = {0, 0, 0, 0, 0};
+    frames.resize(capacity);
+    frame_page.assign(capacity, -1);
+    frame_dirty.assign(capacity, false);
+    for (uint32_t frame = 0; frame < capacity; frame++)
+        lru_pos.push_back(lru.insert(lru.end(), frame));
+}
+
+template <size_t S>
+BufferPool<S>::~BufferPool() {
+    close(fd);
+}
+
+// return the block of the page and mark it as most recently used (reading it from the page file if necessary)
+// dirty marks the page as modified; the block stays valid until a further page is fetched or allocated
+template <size_t S>
+std::bitset<S> *BufferPool<S>::fetch(uint32_t page, bool dirty) {
+    stats.fetches++;
+    uint32_t frame;
+    auto buffered = page_frame.find(page);
+    if (buffered != page_frame.end()) {
+        stats.hits++;
+        frame = buffered->second;
+        lru.splice(lru.begin(), lru, lru_pos[frame]);
+    } else {
+        frame = claim_frame();
+        ssize_t bytes = pread(fd, &frames[frame], sizeof(std::bitset<S>), (off_t) page * sizeof(std::bitset<S>));
+        if (bytes != sizeof(std::bitset<S>))
+            throw std::runtime_error("Could not read page " + std::to_string(page) + " of the page file");
+        stats.reads++;
+        frame_page[frame] = page;
+        page_frame[page] = frame;
+    }
+    if (dirty)
+        frame_dirty[frame] = true;
+    return &frames[frame];
+}
+
+// add an empty page (the page is buffered and written back once it is evicted)
+template <size_t S>
+uint32_t BufferPool<S>::allocate() {
+    uint32_t page = pages;
+    if (free_pages.empty()) {
+        pages++;
+    } else {
+        page = free_pages.back();
+        free_pages.pop_back();
+    }
+
+    uint32_t frame = claim_frame();
+    frames[frame].reset();
+    frame_page[frame] = page;
+    frame_dirty[frame] = true;
+    page_frame[page] = frame;
+    return page;
+}
+
+// drop the page; its frame becomes the next one to be reused and the page can be handed out again
+template <size_t S>
+void BufferPool<S>::release(uint32_t page) {
+    auto buffered = page_frame.find(page);
+    if (buffered != page_frame.end()) {
+        uint32_t frame = buffered->second;
+        frame_page[frame] = NO_FRAME;
+        frame_dirty[frame] = false;
+        lru.splice(lru.end(), lru, lru_pos[frame]);
+        page_frame.erase(buffered);
+    }
+    free_pages.push_back(page);
+}
+
+// announce that the page will be fetched soon; the operating system reads it ahead asynchronously
+template <size_t S>
+void BufferPool<S>::prefetch(uint32_t page) {
+    if (page_frame.count(page))
+        return;
+    stats.prefetches++;
+    #ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, (off_t) page * sizeof(std::bitset<S>), sizeof(std::bitset<S>), POSIX_FADV_WILLNEED);
+    #endif
+}
+
+// write all dirty pages back to the page file
+template <size_t S>
+void BufferPool<S>::flush() {
+    for (uint32_t frame = 0; frame < frames.size(); frame++)
+        if (frame_dirty[frame])
+            write_back(frame);
+}
+
+template <size_t S>
+uint32_t BufferPool<S>::capacity() {
+    return frames.size();
+}
+
+template <size_t S>
+BP_Stats BufferPool<S>::statistics() {
+    return stats;
+}
+
+// free the least recently used frame (writing back its page if it is dirty) and mark it as most recently used
+template <size_t S>
+uint32_t BufferPool<S>::claim_frame() {
+    uint32_t frame = lru.back();
+    if (frame_page[frame] != NO_FRAME) {
+        if (frame_dirty[frame])
+            write_back(frame);
+        page_frame.erase(frame_page[frame]);
+        frame_page[frame] = NO_FRAME;
+    }
+    lru.splice(lru.begin(), lru, lru_pos[frame]);
+    return frame;
+}
+
+template <size_t S>
+void BufferPool<S>::write_back(uint32_t frame) {
+    ssize_t bytes = pwrite(fd, &frames[frame], sizeof(std::bitset<S>), (off_t) frame_page[frame] * sizeof(std::bitset<S>));
+    if (bytes != sizeof(std::bitset<S>))
+        throw std::runtime_error("Could not write page " + std::to_string(frame_page[frame]) + " of the page file");
+    stats.writes++;
+    frame_dirty[frame] = false;
+}
+
+// the page file is created in dir; budget is the number of bytes that may be used for buffered blocks
+// (at least four blocks are buffered so that all operations can hold the blocks of two leaves)
+template <size_t S>
+PagedBitVector<S>::PagedBitVector(std::string dir, size_t budget)
+    : AVL<PBV_Node<S>>(), pool(dir, std::max<size_t>(4, budget / sizeof(std::bitset<S>))) {
+    BLOCK_SIZE = S;
+    TARGET_SIZE = BLOCK_SIZE / 2;
+    SPLIT_BOUND = (BLOCK_SIZE * 3) / 4;
+    LOWER_BOUND = BLOCK_SIZE / 4;
+    last_leaf = NULL;
+    following = NULL;
+    sequential = 0;
+}
+
+// insert the bit at index; in case the leaf is full it is split (and the tree balanced) first
+template <size_t S>
+void PagedBitVector<S>::insert(uint32_t index, bool value) {
+    uint32_t ones = 0;
+    PBV_Node<S> *leaf = find_block(this->root, &index, &ones);
+
+    if (index > leaf->nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    if (leaf->nums >= BLOCK_SIZE) {
+        leaf = this->split_block(leaf);
+        leaf = find_block(leaf, &index, &ones);
+        this->root = this->fix_tree(leaf);
+    }
+
+    uint64_t *block = words(leaf, true);
+    copy_bits(block, index + 1, block, index, leaf->nums - index);
+    write_bits(block, index, 1, value);
+    propagate_update(leaf, NULL, 1, value);
+}
+
+// remove the bit at index
+// in case the resulting leaf has too few bits it is required to steal bits or merge with another leaf
+template <size_t S>
+void PagedBitVector<S>::del(uint32_t index) {
+    uint32_t ones = 0;
+    PBV_Node<S> *leaf = find_block(this->root, &index, &ones);
+
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    uint64_t *block = words(leaf, true);
+    int32_t value = read_bits(block, index, 1);
+    copy_bits(block, index, block, index + 1, leaf->nums - index - 1);
+    write_bits(block, leaf->nums - 1, 1, 0);
+    propagate_update(leaf, NULL, -1, -value);
+
+    this->fix_underflow(leaf, LOWER_BOUND, SPLIT_BOUND);
+}
+
+template <size_t S>
+void PagedBitVector<S>::set(uint32_t index) {
+    update(index, 1);
+}
+
+template <size_t S>
+void PagedBitVector<S>::unset(uint32_t index) {
+    update(index, 0);
+}
+
+template <size_t S>
+void PagedBitVector<S>::flip(uint32_t index) {
+    update(index, -1);
+}
+
+// return the bit at index (touches the block of a single leaf)
+template <size_t S>
+bool PagedBitVector<S>::access(uint32_t index) {
+    uint32_t ones = 0;
+    PBV_Node<S> *leaf = find_block(this->root, &index, &ones);
+    return read_bits(words(leaf, false), index, 1);
+}
+
+// count the occurrences of value in front of index (touches the block of a single leaf)
+template <size_t S>
+uint32_t PagedBitVector<S>::rank(uint32_t index, bool value) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    PBV_Node<S> *leaf = find_block(this->root, &offset, &ones);
+    if (offset > leaf->nums) {
+        index -= offset - leaf->nums;
+        offset = leaf->nums;
+    }
+
+    uint64_t *block = words(leaf, false);
+    for (uint32_t w = 0; w < offset / 64; w++)
+        ones += std::popcount(block[w]);
+    if (offset % 64)
+        ones += std::popcount(block[offset / 64] & ((1ULL << (offset % 64)) - 1));
+    return value ? ones : index - ones;
+}
+
+// find the position of the num'th occurrence of value (touches the block of a single leaf)
+template <size_t S>
+uint32_t PagedBitVector<S>::select(uint32_t num, bool value) {
+    PBV_Node<S> *node = this->root;
+    uint32_t index = 0;
+    this->record(node);
+    while (!this->is_leaf(node)) {
+        uint32_t num_val = value ? node->ones : node->nums - node->ones;
+        if (num <= num_val) {
+            node = node->l;
+        } else {
+            num -= num_val;
+            index += node->nums;
+            node = node->r;
+        }
+        this->record(node);
+    }
+
+    if (num == 0 || (value ? node->ones : node->nums - node->ones) < num) {
+        std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+    return index + select_block(node, num, value);
+}
+
+template <size_t S>
+uint32_t PagedBitVector<S>::size() {
+    return size(this->root);
+}
+
+// collect all the bits and return them as one consecutive bool vector (the leaves are visited in order)
+template <size_t S>
+std::vector<bool> PagedBitVector<S>::extract() {
+    AVL_Path<PBV_Node<S>> path;
+    PBV_Node<S> *leaf = this->first_leaf(this->root, &path);
+
+    std::vector<bool> bits;
+    while (leaf) {
+        this->follow(path);
+        uint64_t *block = words(leaf, false);
+        for (uint32_t i = 0; i < leaf->nums; i++)
+            bits.push_back((block[i / 64] >> (i % 64)) & 1);
+        leaf = this->next_leaf(&path);
+    }
+    return bits;
+}
+
+// write all modified blocks back to the page file
+template <size_t S>
+void PagedBitVector<S>::flush() {
+    pool.flush();
+}
+
+template <size_t S>
+BP_Stats PagedBitVector<S>::statistics() {
+    return pool.statistics();
+}
+
+template <size_t S>
+bool PagedBitVector<S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+// return the words of the block of the leaf (a page is allocated for leaves that do not have one yet)
+// dirty has to be set if the block is modified
+template <size_t S>
+uint64_t *PagedBitVector<S>::words(PBV_Node<S> *leaf, bool dirty) {
+    read_ahead(leaf);
+    if (leaf->page == PBV_Node<S>::NO_PAGE)
+        leaf->page = pool.allocate();
+    return block_words(pool.fetch(leaf->page, dirty));
+}
+
+// count the accesses of the leaf after the previous one in a row; once SEQUENTIAL_RUN of them were seen,
+// the pages of the next PREFETCH_DEPTH leaves are announced and the window moves on by one leaf per access
+// (the leaves are reached by paths, with ADS_COMPACT_NODES a leaf that is not on a recorded path starts a new run)
+template <size_t S>
+void PagedBitVector<S>::read_ahead(PBV_Node<S> *leaf) {
+    if (leaf == last_leaf)
+        return;
+    if (last_leaf && following == leaf) {
+        sequential++;
+    } else {
+        sequential = 0;
+        ahead.clear();
+    }
+    last_leaf = leaf;
+    following = NULL;
+    AVL_Path<PBV_Node<S>> path;
+    if (!this->trace(leaf, &path)) {
+        sequential = 0;
+        ahead.clear();
+        return;
+    }
+    following = this->next_leaf(&path);
+    if (sequential < SEQUENTIAL_RUN)
+        return;
+
+    uint32_t steps = 1;
+    if (ahead.empty()) {
+        ahead = path;
+        steps = PREFETCH_DEPTH;
+        if (following) {
+            steps--;
+            if (following->page != PBV_Node<S>::NO_PAGE)
+                pool.prefetch(following->page);
+        }
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+        PBV_Node<S> *next = this->next_leaf(&ahead);
+        if (!next)
+            break;
+        if (next->page != PBV_Node<S>::NO_PAGE)
+            pool.prefetch(next->page);
+    }
+}
+
+// drop the leaves remembered by the read ahead (the structure of the tree is about to change)
+template <size_t S>
+void PagedBitVector<S>::forget_leaves() {
+    last_leaf = NULL;
+    following = NULL;
+    ahead.clear();
+    sequential = 0;
+}
+
+// find the leaf that contains the bit at the position index and count the ones in front of that leaf
+// index is updated as well to locate the bit inside the leaf block
+template <size_t S>
+PBV_Node<S> *PagedBitVector<S>::find_block(PBV_Node<S> *node, uint32_t *index, uint32_t *ones) {
+    this->record(node);
+    while (!this->is_leaf(node)) {
+        if (*index < node->nums) {
+            node = node->l;
+        } else {
+            *index -= node->nums;
+            *ones += node->ones;
+            node = node->r;
+        }
+        this->record(node);
+    }
+    return node;
+}
+
+// return the position of the num'th occurrence of value inside the block of the leaf
+template <size_t S>
+uint32_t PagedBitVector<S>::select_block(PBV_Node<S> *leaf, uint32_t num, bool value) {
+    uint64_t *block = words(leaf, false);
+    for (uint32_t w = 0; w * 64 < leaf->nums; w++) {
+        uint64_t word = value ? block[w] : ~block[w];
+        if ((w + 1) * 64 > leaf->nums)
+            word &= (1ULL << (leaf->nums % 64)) - 1;    // drop the bits behind the last one of the leaf
+        uint32_t count = std::popcount(word);
+        if (num > count) {
+            num -= count;
+            continue;
+        }
+        while (--num)
+            word &= word - 1;
+        return w * 64 + std::countr_zero(word);
+    }
+    return -1;
+}
+
+// set (value 1), unset (value 0) or flip (value -1) the bit at index
+template <size_t S>
+void PagedBitVector<S>::update(uint32_t index, int value) {
+    uint32_t ones = 0;
+    PBV_Node<S> *leaf = find_block(this->root, &index, &ones);
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for update operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    uint64_t *block = words(leaf, true);
+    int32_t old_value = read_bits(block, index, 1);
+    int32_t new_value = value < 0 ? !old_value : value;
+    write_bits(block, index, 1, new_value);
+    propagate_update(leaf, NULL, 0, new_value - old_value);
+}
+
+template <size_t S>
+uint32_t PagedBitVector<S>::size(PBV_Node<S> *node) {
+    if (!node)
+        return 0;
+    return node->nums + size(node->r);
+}
+
+// propagate changes in nodes up the tree to keep the navigation structure correct
+template <size_t S>
+void PagedBitVector<S>::propagate_update(PBV_Node<S> *node, PBV_Node<S> *prev_node, int32_t nums, int32_t ones) {
+    this->propagate(node, prev_node, [&](PBV_Node<S> *node, bool left) {
+        if (left) {
+            node->nums += nums;
+            node->ones += ones;
+        }
+    });
+}
+
+// the left leaf keeps the page of the split leaf, the second half of the bits is moved to a new page
+template <size_t S>
+void PagedBitVector<S>::split_block_update(PBV_Node<S> *node, PBV_Node<S> *left, PBV_Node<S> *right) {
+    left->page = node->page;
+    node->page = PBV_Node<S>::NO_PAGE;
+    uint64_t *left_block = words(left, true);
+    uint64_t *right_block = words(right, true);
+
+    right->nums = node->nums - TARGET_SIZE;
+    right->ones = copy_bits(right_block, 0, left_block, TARGET_SIZE, right->nums);
+    clear_bits(left_block, TARGET_SIZE, right->nums);
+    left->nums = TARGET_SIZE;
+    left->ones = node->ones - right->ones;
+    node->nums = left->nums;
+    node->ones = left->ones;
+    propagate_update(node, NULL, 0, 0);
+    forget_leaves();
+}
+
+// take some bits from the left 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t S>
+void PagedBitVector<S>::steal_left(PBV_Node<S> *node, PBV_Node<S> *prev_leaf) {
+    uint32_t steal_bits = (prev_leaf->nums - node->nums) / 2;
+    uint64_t *block = words(node, true);
+    uint64_t *prev_block = words(prev_leaf, true);
+
+    copy_bits(block, steal_bits, block, 0, node->nums);
+    uint32_t ones = copy_bits(block, 0, prev_block, prev_leaf->nums - steal_bits, steal_bits);
+    clear_bits(prev_block, prev_leaf->nums - steal_bits, steal_bits);
+
+    propagate_update(node, NULL, steal_bits, ones);
+    propagate_update(prev_leaf, NULL, -steal_bits, -ones);
+}
+
+// take some bits from the right 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t S>
+void PagedBitVector<S>::steal_right(PBV_Node<S> *node, PBV_Node<S> *next_leaf) {
+    uint32_t steal_bits = (next_leaf->nums - node->nums) / 2;
+    uint64_t *block = words(node, true);
+    uint64_t *next_block = words(next_leaf, true);
+
+    uint32_t ones = copy_bits(block, node->nums, next_block, 0, steal_bits);
+    copy_bits(next_block, 0, next_block, steal_bits, next_leaf->nums - steal_bits);
+    clear_bits(next_block, next_leaf->nums - steal_bits, steal_bits);
+
+    propagate_update(node, NULL, steal_bits, ones);
+    propagate_update(next_leaf, NULL, -steal_bits, -ones);
+}
+
+// process the changes required after a left merge (the page of the merged leaf is released)
+template <size_t S>
+void PagedBitVector<S>::merge_left_pre_update(PBV_Node<S> *node, PBV_Node<S> *prev_leaf) {
+    uint64_t *block = words(node, true);
+    uint64_t *prev_block = words(prev_leaf, false);
+    copy_bits(block, prev_leaf->nums, block, 0, node->nums);
+    copy_bits(block, 0, prev_block, 0, prev_leaf->nums);
+    pool.release(prev_leaf->page);
+    prev_leaf->page = PBV_Node<S>::NO_PAGE;
+
+    propagate_update(node, NULL, prev_leaf->nums, prev_leaf->ones);
+    propagate_update(prev_leaf, NULL, -prev_leaf->nums, -prev_leaf->ones);
+}
+
+// process the changes required after a right merge (the page of the merged leaf is released)
+template <size_t S>
+void PagedBitVector<S>::merge_right_pre_update(PBV_Node<S> *node, PBV_Node<S> *next_leaf) {
+    uint64_t *block = words(node, true);
+    uint64_t *next_block = words(next_leaf, false);
+    copy_bits(block, node->nums, next_block, 0, next_leaf->nums);
+    pool.release(next_leaf->page);
+    next_leaf->page = PBV_Node<S>::NO_PAGE;
+
+    propagate_update(node, NULL, next_leaf->nums, next_leaf->ones);
+    propagate_update(next_leaf, NULL, -next_leaf->nums, -next_leaf->ones);
+}
+
+template <size_t S>
+void PagedBitVector<S>::merge_post_update(PBV_Node<S> *node) {
+    propagate_update(node, NULL, 0, 0);
+    forget_leaves();
+}
+
+// process the changes required after a left rotation
+template <size_t S>
+void PagedBitVector<S>::rotate_left_update(PBV_Node<S> *node) {
+    node->nums += node->l->nums;
+    node->ones += node->l->ones;
+}
+
+// process the changes required after a right rotation
+template <size_t S>
+void PagedBitVector<S>::rotate_right_update(PBV_Node<S> *node) {
+    node->r->nums -= node->nums;
+    node->r->ones -= node->ones;
+}
+
+#ifdef ADS_DEBUG
+template <size_t S>
+bool PagedBitVector<S>::validate() {
+    uint32_t nums, ones;
+    bool val = validate(this->root, &nums, &ones);
+    if (!val)
+        std::cout << "Nicht valider Baum" << std::endl;
+    return val;
+}
+
+// check the counters of all nodes against the blocks; the number of bits and ones in the subtree are returned
+template <size_t S>
+bool PagedBitVector<S>::validate(PBV_Node<S> *node, uint32_t *nums, uint32_t *ones) {
+    if (this->is_leaf(node)) {
+        *nums = node->nums;
+        *ones = node->ones;
+        uint64_t *block = words(node, false);
+        uint32_t count = 0;
+        for (uint32_t w = 0; w < (S + 63) / 64; w++)
+            count += std::popcount(block[w]);
+        return count == node->ones && node->height == 1;
+    }
+
+    uint32_t nums_r, ones_r;
+    if (node->page != PBV_Node<S>::NO_PAGE || !validate(node->l, nums, ones) || !validate(node->r, &nums_r, &ones_r))
+        return false;
+    if (node->nums != *nums || node->ones != *ones || node->height != std::max(node->l->height, node->r->height) + 1)
+        return false;
+    *nums += nums_r;
+    *ones += ones_r;
+    return true;
+}
+#endif
+
+#endif
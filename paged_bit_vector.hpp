@@ -0,0 +1,150 @@
+#ifndef PAGEDBITVECTOR
+#define PAGEDBITVECTOR
+
+#include "avl.hpp"
+
+#include <vector>
+#include <bitset>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// counters of the buffer pool (a fetch is a hit if the page was already buffered)
+struct BP_Stats {
+    uint64_t fetches;
+    uint64_t hits;
+    uint64_t reads;         // pages read from the page file
+    uint64_t writes;        // dirty pages written back to the page file
+    uint64_t prefetches;    // pages announced for asynchronous read ahead
+};
+
+// buffers pages of a page file (each page holds one block of S bits) in a fixed number of frames
+// the least recently used page is evicted when a frame is needed; dirty pages are written back on eviction
+// (errors of the page file throw a std::runtime_error)
+template <size_t S>
+class BufferPool {
+    private:
+        static const uint32_t NO_FRAME = -1;
+
+        int fd;
+        uint32_t pages;                             // number of pages in the page file
+        std::vector<uint32_t> free_pages;           // released pages that can be reused
+
+        std::vector<std::bitset<S>> frames;
+        std::vector<uint32_t> frame_page;
+        std::vector<bool> frame_dirty;
+        std::list<uint32_t> lru;                    // frames in the order of their last use (most recent first)
+        std::vector<std::list<uint32_t>::iterator> lru_pos;
+        std::unordered_map<uint32_t, uint32_t> page_frame;
+
+        BP_Stats stats;
+
+        uint32_t claim_frame();
+        void write_back(uint32_t);
+
+    public:
+        BufferPool(std::string, uint32_t);
+        ~BufferPool();
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        std::bitset<S> *fetch(uint32_t, bool);
+        uint32_t allocate();
+        void release(uint32_t);
+        void prefetch(uint32_t);
+        void flush();
+
+        uint32_t capacity();
+        BP_Stats statistics();
+};
+
+// encapsualte the members that are needed for the paged bitvector tree structure
+// (inner nodes store the counters of the left subtree, leaves their own counters and the page of their block)
+template <size_t S>
+struct PBV_Node : Node<PBV_Node<S>> {
+    static const uint32_t NO_PAGE = -1;
+
+    uint32_t nums;
+    uint32_t ones;
+    uint32_t page;
+
+    PBV_Node() {
+        nums = 0;
+        ones = 0;
+        page = NO_PAGE;
+    }
+};
+
+// dynamic bitvector for data larger than the main memory
+// the tree with its counters stays in memory while the blocks of the leaves are stored in a page file
+// and accessed through a buffer pool with a fixed memory budget
+// (inside a block the bit at position i is stored in bit i % 64 of word i / 64)
+// once the blocks of a few leaves were accessed in leaf order, the pages of the following leaves are read ahead
+template <size_t S = 32768>
+class PagedBitVector : public AVL<PBV_Node<S>> {
+    private:
+        static const uint32_t PREFETCH_DEPTH = 8;       // leaves read ahead of a sequential access
+        static const uint32_t SEQUENTIAL_RUN = 2;       // accesses of the next leaf in a row that start the read ahead
+
+        size_t BLOCK_SIZE;
+        size_t TARGET_SIZE;
+        size_t SPLIT_BOUND;
+        size_t LOWER_BOUND;
+
+        BufferPool<S> pool;
+
+        PBV_Node<S> *last_leaf;                         // leaf of the previous block access
+        PBV_Node<S> *following;                         // leaf after last_leaf (looked up at the access)
+        AVL_Path<PBV_Node<S>> ahead;                    // to the last leaf whose page was announced for read ahead
+        uint32_t sequential;                            // accesses of the leaf after the previous one in a row
+
+        uint64_t *words(PBV_Node<S> *, bool);
+        void read_ahead(PBV_Node<S> *);
+        void forget_leaves();
+        PBV_Node<S> *find_block(PBV_Node<S> *, uint32_t *, uint32_t *);
+        uint32_t select_block(PBV_Node<S> *, uint32_t, bool);
+        void update(uint32_t, int);
+        uint32_t size(PBV_Node<S> *);
+
+        #ifdef ADS_DEBUG
+        bool validate(PBV_Node<S> *, uint32_t *, uint32_t *);
+        #endif
+
+        void propagate_update(PBV_Node<S> *, PBV_Node<S> *, int32_t, int32_t);
+
+        void split_block_update(PBV_Node<S> *, PBV_Node<S> *, PBV_Node<S> *);
+
+        void steal_left(PBV_Node<S> *, PBV_Node<S> *);
+        void steal_right(PBV_Node<S> *, PBV_Node<S> *);
+
+        void merge_left_pre_update(PBV_Node<S> *, PBV_Node<S> *);
+        void merge_right_pre_update(PBV_Node<S> *, PBV_Node<S> *);
+        void merge_post_update(PBV_Node<S> *);
+
+        void rotate_left_update(PBV_Node<S> *);
+        void rotate_right_update(PBV_Node<S> *);
+
+    public:
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        void flip(uint32_t);
+        bool access(uint32_t);
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        uint32_t size();
+        std::vector<bool> extract();
+        void flush();
+        BP_Stats statistics();
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        PagedBitVector(std::string = "/tmp", size_t = 64 << 20);
+};
+
+#endif
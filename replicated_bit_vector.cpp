@@ -0,0 +1,181 @@
+#ifndef REPLICATEDBITVECTOR_IMPL
+#define REPLICATEDBITVECTOR_IMPL
+
+#include "bit_vector.cpp"
+#include "replicated_bit_vector.hpp"
+
+template <size_t S>
+ReplicatedBitVector<S>::ReplicatedBitVector(NumaTopology topology) : topology(topology) {
+    replicating = false;
+    stale = false;
+}
+
+template <size_t S>
+ReplicatedBitVector<S>::ReplicatedBitVector(std::vector<bool> bits, NumaTopology topology) : topology(topology), bv(bits) {
+    replicating = false;
+    stale = false;
+}
+
+// the tree that answers the queries of the calling thread
+template <size_t S>
+BitVector<S> &ReplicatedBitVector<S>::reader() {
+    if (!replicating || stale)
+        return bv;
+    return replicas[topology.current_node()];
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::updated() {
+    stale = replicating;
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::insert(uint32_t index, bool value) {
+    bv.insert(index, value);
+    updated();
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::del(uint32_t index) {
+    bv.del(index);
+    updated();
+}
+
+// apply the batch to the primary tree and bring the replicas up to date
+template <size_t S>
+void ReplicatedBitVector<S>::apply(const std::vector<BV_Update> &updates) {
+    bv.apply(updates);
+    updated();
+    refresh();
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::flip(uint32_t index) {
+    bv.flip(index);
+    updated();
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::set(uint32_t index) {
+    bv.set(index);
+    updated();
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::unset(uint32_t index) {
+    bv.unset(index);
+    updated();
+}
+
+template <size_t S>
+void ReplicatedBitVector<S>::complement() {
+    bv.complement();
+    updated();
+}
+
+template <size_t S>
+uint32_t ReplicatedBitVector<S>::rank(uint32_t index, bool value) {
+    return reader().rank(index, value);
+}
+
+template <size_t S>
+uint32_t ReplicatedBitVector<S>::select(uint32_t num, bool value) {
+    return reader().select(num, value);
+}
+
+template <size_t S>
+bool ReplicatedBitVector<S>::access(uint32_t index) {
+    return reader().access(index);
+}
+
+template <size_t S>
+uint32_t ReplicatedBitVector<S>::size() {
+    return bv.size();
+}
+
+template <size_t S>
+std::vector<bool> ReplicatedBitVector<S>::extract() {
+    return bv.extract();
+}
+
+// memory of the primary tree plus the bytes of the replicas (the counters of bits and leaves are those of one tree)
+template <size_t S>
+BV_Memory ReplicatedBitVector<S>::memory_usage() {
+    BV_Memory memory = bv.memory_usage();
+    for (auto &replica : replicas) {
+        BV_Memory copy = replica.memory_usage();
+        memory.object_bytes += copy.object_bytes;
+        memory.inner_node_bytes += copy.inner_node_bytes;
+        memory.leaf_node_bytes += copy.leaf_node_bytes;
+        memory.leaf_payload_bytes += copy.leaf_payload_bytes;
+        memory.inner_payload_bytes += copy.inner_payload_bytes;
+        memory.allocator_overhead_bytes += copy.allocator_overhead_bytes;
+        memory.total_bytes += copy.total_bytes;
+    }
+    return memory;
+}
+
+// move the primary tree into slabs with the placement (e.g. interleaved over all nodes for a write heavy phase)
+template <size_t S>
+void ReplicatedBitVector<S>::place(NumaPlacement placement) {
+    bv.place(placement);
+}
+
+// turn the replicas on (they are built right away) or off (their memory is released)
+template <size_t S>
+void ReplicatedBitVector<S>::replicate(bool on) {
+    replicating = on;
+    replicas.clear();
+    stale = on;
+    refresh();
+}
+
+// copy the primary tree into the replica of every node if it was updated since the last refresh
+// (every copy is a single pass over the tree into slabs that are bound to the node before they are written)
+template <size_t S>
+void ReplicatedBitVector<S>::refresh() {
+    if (!replicating || !stale)
+        return;
+    replicas.clear();
+    for (uint32_t node = 0; node < topology.nodes; node++)
+        replicas.push_back(bv.clone(topology.bind(node)));
+    stale = false;
+}
+
+// whether the queries are answered by the replicas
+template <size_t S>
+bool ReplicatedBitVector<S>::replicated() {
+    return replicating && !stale;
+}
+
+// node of the replica that answers the queries of the calling thread (-1 for the primary tree)
+template <size_t S>
+int32_t ReplicatedBitVector<S>::route() {
+    return replicated() ? (int32_t) topology.current_node() : -1;
+}
+
+// the replica of node (only valid while the replicas are on)
+template <size_t S>
+BitVector<S> &ReplicatedBitVector<S>::replica(uint32_t node) {
+    return replicas[node];
+}
+
+template <size_t S>
+bool ReplicatedBitVector<S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+#ifdef ADS_DEBUG
+// validate all trees; up to date replicas have to hold the bits of the primary tree
+template <size_t S>
+bool ReplicatedBitVector<S>::validate() {
+    bool val = bv.validate() && replicas.size() == (replicating ? topology.nodes : 0);
+    for (auto &replica : replicas)
+        val &= replica.validate() && (stale || replica.extract() == bv.extract());
+    if (!val)
+        std::cout << "Invalid replicated bitvector" << std::endl;
+    return val;
+}
+#endif
+
+#endif
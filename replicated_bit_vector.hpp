@@ -0,0 +1,58 @@
+#ifndef REPLICATEDBITVECTOR
+#define REPLICATEDBITVECTOR
+
+#include "bit_vector.hpp"
+#include "numa.hpp"
+
+#include <vector>
+
+// dynamic bitvector with a read replica of the tree on every memory node (socket) for read mostly phases
+// all updates go to the primary tree; while the replicas are up to date, access, rank and select read the replica on
+// the node of the calling thread, otherwise the primary tree; refresh() (or a batch through apply) copies the primary
+// tree into slabs that are bound to the node of each replica
+// (concurrent queries are safe as long as no update runs; the trees do not count their queries)
+template <size_t S = 512>
+class ReplicatedBitVector {
+    private:
+        NumaTopology topology;
+        BitVector<S> bv;
+        std::vector<BitVector<S>> replicas;     // one per node (empty while the replicas are off)
+        bool replicating;
+        bool stale;                             // the primary tree was updated since the last refresh
+
+        BitVector<S> &reader();
+        void updated();
+
+    public:
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void apply(const std::vector<BV_Update> &);
+        void flip(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        void complement();
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        bool access(uint32_t);
+        uint32_t size();
+        std::vector<bool> extract();
+        BV_Memory memory_usage();
+
+        void place(NumaPlacement);
+        void replicate(bool);
+        void refresh();
+        bool replicated();
+        int32_t route();
+        BitVector<S> &replica(uint32_t);
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        ReplicatedBitVector(NumaTopology = NumaTopology::detect());
+        ReplicatedBitVector(std::vector<bool>, NumaTopology = NumaTopology::detect());
+};
+
+#endif
@@ -0,0 +1,658 @@
+#ifndef RRRBITVECTOR_IMPL
+#define RRRBITVECTOR_IMPL
+
+#include "bits.hpp"
+#include "rrr_bit_vector.hpp"
+
+#include <array>
+
+// binomial coefficients n choose k for n, k <= 64 (64 choose 32 still fits into 64 bits)
+inline const std::array<std::array<uint64_t, 65>, 65> &rrr_binomials() {
+    static const std::array<std::array<uint64_t, 65>, 65> table = [] {
+        std::array<std::array<uint64_t, 65>, 65> table = {};
+        for (uint32_t n = 0; n <= 64; n++) {
+            table[n][0] = 1;
+            for (uint32_t k = 1; k <= n; k++)
+                table[n][k] = table[n - 1][k - 1] + (k < n ? table[n - 1][k] : 0);
+        }
+        return table;
+    }();
+    return table;
+}
+
+// number of bits of the offsets of every class (ceil(log2(64 choose class)))
+inline const std::array<uint8_t, 65> &rrr_widths() {
+    static const std::array<uint8_t, 65> table = [] {
+        std::array<uint8_t, 65> table;
+        for (uint32_t k = 0; k <= 64; k++) {
+            uint64_t count = rrr_binomials()[64][k];
+            table[k] = count == 1 ? 0 : 64 - std::countl_zero(count - 1);
+        }
+        return table;
+    }();
+    return table;
+}
+
+// offset of the word among all words with the same number of ones (combinatorial number system)
+// the k'th lowest one at position p contributes p choose k
+inline uint64_t rrr_encode(uint64_t word) {
+    const auto &binomials = rrr_binomials();
+    uint64_t offset = 0;
+    for (uint32_t k = 1; word; k++) {
+        offset += binomials[std::countr_zero(word)][k];
+        word &= word - 1;
+    }
+    return offset;
+}
+
+// word with the given number of ones and offset (the ones are recovered from the highest one downwards)
+inline uint64_t rrr_decode(uint32_t ones, uint64_t offset) {
+    const auto &binomials = rrr_binomials();
+    uint64_t word = 0;
+    uint32_t pos = 64;
+    for (uint32_t k = ones; k > 0; k--) {
+        do {
+            pos--;
+        } while (binomials[pos][k] > offset);
+        word |= 1ULL << pos;
+        offset -= binomials[pos][k];
+    }
+    return word;
+}
+
+template <size_t S>
+RRRBitVector<S>::RRRBitVector() : AVL<RRR_Node<S>>() {
+    BLOCK_SIZE = S;
+    TARGET_SIZE = BLOCK_SIZE / 2;
+    SPLIT_BOUND = (BLOCK_SIZE * 3) / 4;
+    LOWER_BOUND = BLOCK_SIZE / 4;
+}
+
+// append the bits one after another (every append re-encodes only the last sub-block of a leaf)
+template <size_t S>
+RRRBitVector<S>::RRRBitVector(std::vector<bool> bits) : RRRBitVector() {
+    for (uint32_t i = 0; i < bits.size(); i++)
+        insert(i, bits[i]);
+}
+
+// insert the bit at index; the sub-blocks of the leaf behind index are decoded, shifted and encoded again
+// in case the leaf is full it is split first (and the tree balanced)
+template <size_t S>
+void RRRBitVector<S>::insert(uint32_t index, bool value) {
+    uint32_t ones = 0;
+    RRR_Node<S> *leaf = find_block(this->root, &index, &ones);
+
+    if (index > leaf->nums) {
+        std::cout << "Invalid index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    if (leaf->nums >= BLOCK_SIZE) {
+        leaf = this->split_block(leaf);
+        leaf = find_block(leaf, &index, &ones);
+        this->root = this->fix_tree(leaf);
+    }
+
+    std::array<uint64_t, BLOCKS + 1> words;
+    decode(leaf, index / 64, words.data());
+    words[(leaf->nums + 63) / 64] = 0;
+    copy_bits(words.data(), index + 1, words.data(), index, leaf->nums - index);
+    write_bits(words.data(), index, 1, value);
+    encode(leaf, index / 64, words.data(), leaf->nums + 1);
+    propagate_update(leaf, NULL, 1, value);
+}
+
+// remove the bit at index
+// in case the resulting leaf has too few bits it is required to steal bits or merge with another leaf
+template <size_t S>
+void RRRBitVector<S>::del(uint32_t index) {
+    uint32_t ones = 0;
+    RRR_Node<S> *leaf = find_block(this->root, &index, &ones);
+
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    std::array<uint64_t, BLOCKS + 1> words;
+    decode(leaf, index / 64, words.data());
+    int32_t value = read_bits(words.data(), index, 1);
+    copy_bits(words.data(), index, words.data(), index + 1, leaf->nums - index - 1);
+    write_bits(words.data(), leaf->nums - 1, 1, 0);
+    encode(leaf, index / 64, words.data(), leaf->nums - 1);
+    propagate_update(leaf, NULL, -1, -value);
+
+    this->fix_underflow(leaf, LOWER_BOUND, SPLIT_BOUND);
+}
+
+template <size_t S>
+void RRRBitVector<S>::set(uint32_t index) {
+    update(index, 1);
+}
+
+template <size_t S>
+void RRRBitVector<S>::unset(uint32_t index) {
+    update(index, 0);
+}
+
+template <size_t S>
+void RRRBitVector<S>::flip(uint32_t index) {
+    update(index, -1);
+}
+
+// return the bit at index (decodes a single sub-block)
+template <size_t S>
+bool RRRBitVector<S>::access(uint32_t index) {
+    uint32_t ones = 0;
+    RRR_Node<S> *leaf = find_block(this->root, &index, &ones);
+    uint32_t pos;
+    locate(leaf, index / 64, &ones, &pos);
+    return (sub_block(leaf, index / 64, pos) >> (index % 64)) & 1;
+}
+
+// count the occurrences of value in front of index
+// the classes of the sub-blocks in front of the one of index are summed up (starting at the closest sample)
+template <size_t S>
+uint32_t RRRBitVector<S>::rank(uint32_t index, bool value) {
+    uint32_t offset = index;
+    uint32_t ones = 0;
+    RRR_Node<S> *leaf = find_block(this->root, &offset, &ones);
+    if (offset > leaf->nums) {
+        index -= offset - leaf->nums;
+        offset = leaf->nums;
+    }
+
+    uint32_t block_ones, pos;
+    locate(leaf, offset / 64, &block_ones, &pos);
+    ones += block_ones;
+    if (offset % 64)
+        ones += std::popcount(sub_block(leaf, offset / 64, pos) & ((1ULL << (offset % 64)) - 1));
+    return value ? ones : index - ones;
+}
+
+// find the position of the num'th occurrence of value
+template <size_t S>
+uint32_t RRRBitVector<S>::select(uint32_t num, bool value) {
+    RRR_Node<S> *node = this->root;
+    uint32_t index = 0;
+    while (!this->is_leaf(node)) {
+        uint32_t num_val = value ? node->ones : node->nums - node->ones;
+        if (num <= num_val) {
+            node = node->l;
+        } else {
+            num -= num_val;
+            index += node->nums;
+            node = node->r;
+        }
+    }
+
+    if (num == 0 || (value ? node->ones : node->nums - node->ones) < num) {
+        std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+    return index + select_block(node, num, value);
+}
+
+template <size_t S>
+uint32_t RRRBitVector<S>::size() {
+    return size(this->root);
+}
+
+// collect all the bits and return them as one consecutive bool vector
+template <size_t S>
+std::vector<bool> RRRBitVector<S>::extract() {
+    AVL_Path<RRR_Node<S>> path;
+    RRR_Node<S> *leaf = this->first_leaf(this->root, &path);
+    std::vector<bool> bits;
+    std::array<uint64_t, BLOCKS + 1> words;
+    while (leaf) {
+        decode(leaf, 0, words.data());
+        for (uint32_t i = 0; i < leaf->nums; i++)
+            bits.push_back((words[i / 64] >> (i % 64)) & 1);
+        leaf = this->next_leaf(&path);
+    }
+    return bits;
+}
+
+// number of bits used by the encoded leaves (the buffers with the samples, classes and offsets)
+template <size_t S>
+uint64_t RRRBitVector<S>::payload_bits() {
+    return payload_bits(this->root);
+}
+
+template <size_t S>
+bool RRRBitVector<S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+// find the leaf that contains the position index and count the ones in front of that leaf
+// index is updated as well to locate the bit inside the leaf
+template <size_t S>
+RRR_Node<S> *RRRBitVector<S>::find_block(RRR_Node<S> *node, uint32_t *index, uint32_t *ones) {
+    this->record(node);
+    while (!this->is_leaf(node)) {
+        if (*index < node->nums) {
+            node = node->l;
+        } else {
+            *index -= node->nums;
+            *ones += node->ones;
+            node = node->r;
+        }
+        this->record(node);
+    }
+    return node;
+}
+
+// words of the samples of a leaf with the number of sub-blocks (one in front of every SAMPLE_RATE'th and one behind
+// the last)
+template <size_t S>
+uint32_t RRRBitVector<S>::sample_words(uint32_t blocks) {
+    return ((blocks / SAMPLE_RATE + 1) * 32 + 63) / 64;
+}
+
+// words of the classes of a leaf with the number of sub-blocks
+template <size_t S>
+uint32_t RRRBitVector<S>::class_words(uint32_t blocks) {
+    return (blocks * CLASS_BITS + 63) / 64;
+}
+
+template <size_t S>
+uint64_t *RRRBitVector<S>::classes(RRR_Node<S> *leaf) {
+    return leaf->data + sample_words(leaf->blocks);
+}
+
+template <size_t S>
+uint64_t *RRRBitVector<S>::offsets(RRR_Node<S> *leaf) {
+    return leaf->data + sample_words(leaf->blocks) + class_words(leaf->blocks);
+}
+
+template <size_t S>
+uint32_t RRRBitVector<S>::class_of(RRR_Node<S> *leaf, uint32_t block) {
+    return read_bits(classes(leaf), block * CLASS_BITS, CLASS_BITS);
+}
+
+// the sample s of the leaf (ones in the low, offset bits in the high half of 32 bits)
+template <size_t S>
+RRR_Sample RRRBitVector<S>::sample_of(RRR_Node<S> *leaf, uint32_t s) {
+    uint64_t sample = read_bits(leaf->data, s * 32, 32);
+    return {(uint16_t) sample, (uint16_t) (sample >> 16)};
+}
+
+// make the buffer of the leaf hold the number of sub-blocks and bits offset bits; the first keep_blocks classes
+// and keep_bits offset bits are kept (the samples have to be computed again)
+// the buffer is reallocated if the number of sub-blocks changes, it is too small or leaves more than a few words unused
+template <size_t S>
+void RRRBitVector<S>::fit(RRR_Node<S> *leaf, uint32_t blocks, uint32_t bits, uint32_t keep_blocks, uint32_t keep_bits) {
+    uint32_t needed = sample_words(blocks) + class_words(blocks) + (bits + 63) / 64;
+    if (leaf->data && leaf->blocks == blocks && leaf->capacity >= needed && leaf->capacity <= needed + 8)
+        return;
+
+    uint64_t *data = new uint64_t[needed]();
+    if (leaf->data) {
+        copy_bits(data + sample_words(blocks), 0, classes(leaf), 0, keep_blocks * CLASS_BITS);
+        copy_bits(data + sample_words(blocks) + class_words(blocks), 0, offsets(leaf), 0, keep_bits);
+        delete[] leaf->data;
+    }
+    leaf->data = data;
+    leaf->blocks = blocks;
+    leaf->capacity = needed;
+}
+
+// count the ones and the offset bits in front of the sub-block (starting at the closest sample in front of it)
+template <size_t S>
+void RRRBitVector<S>::locate(RRR_Node<S> *leaf, uint32_t block, uint32_t *ones, uint32_t *pos) {
+    *ones = 0;
+    *pos = 0;
+    if (!leaf->data)
+        return;
+
+    const auto &widths = rrr_widths();
+    RRR_Sample sample = sample_of(leaf, block / SAMPLE_RATE);
+    uint64_t *classes = this->classes(leaf);
+    *ones = sample.ones;
+    *pos = sample.pos;
+    for (uint32_t j = block / SAMPLE_RATE * SAMPLE_RATE; j < block; j++) {
+        uint32_t ones_j = read_bits(classes, j * CLASS_BITS, CLASS_BITS);
+        *ones += ones_j;
+        *pos += widths[ones_j];
+    }
+}
+
+// decode the sub-block whose offset starts at bit pos of the offset stream
+template <size_t S>
+uint64_t RRRBitVector<S>::sub_block(RRR_Node<S> *leaf, uint32_t block, uint32_t pos) {
+    uint32_t ones = class_of(leaf, block);
+    uint32_t width = rrr_widths()[ones];
+    return rrr_decode(ones, width ? read_bits(offsets(leaf), pos, width) : 0);
+}
+
+// decode the sub-blocks of the leaf from the sub-block from onwards into words (sub-block j goes to words[j])
+template <size_t S>
+void RRRBitVector<S>::decode(RRR_Node<S> *leaf, uint32_t from, uint64_t *words) {
+    const auto &widths = rrr_widths();
+    uint32_t ones, pos;
+    locate(leaf, from, &ones, &pos);
+    for (uint32_t j = from; j < leaf->blocks; j++) {
+        words[j] = sub_block(leaf, j, pos);
+        pos += widths[class_of(leaf, j)];
+    }
+}
+
+// encode the sub-blocks from the sub-block from onwards again from words, the leaf holds nums bits afterwards
+// (the bits behind nums have to be zero); the sub-blocks in front of from are kept
+// returns the number of ones in the leaf
+template <size_t S>
+uint32_t RRRBitVector<S>::encode(RRR_Node<S> *leaf, uint32_t from, const uint64_t *words, uint32_t nums) {
+    const auto &widths = rrr_widths();
+    uint32_t blocks = (nums + 63) / 64;
+    uint32_t ones, pos;
+    locate(leaf, from, &ones, &pos);
+
+    uint32_t bits = pos;
+    for (uint32_t j = from; j < blocks; j++)
+        bits += widths[std::popcount(words[j])];
+    fit(leaf, blocks, bits, from, pos);
+
+    uint64_t *classes = this->classes(leaf);
+    uint64_t *offsets = this->offsets(leaf);
+    for (uint32_t j = from; j < blocks; j++) {
+        uint32_t ones_j = std::popcount(words[j]);
+        write_bits(classes, j * CLASS_BITS, CLASS_BITS, ones_j);
+        ones += ones_j;
+        if (widths[ones_j])
+            write_bits(offsets, pos, widths[ones_j], rrr_encode(words[j]));
+        pos += widths[ones_j];
+    }
+
+    leaf->bits = bits;
+    sample(leaf);
+    return ones;
+}
+
+// store new content for a single sub-block; the offsets behind it are moved if the width of its offset changes
+template <size_t S>
+void RRRBitVector<S>::replace(RRR_Node<S> *leaf, uint32_t block, uint64_t word) {
+    const auto &widths = rrr_widths();
+    uint32_t ones, pos;
+    locate(leaf, block, &ones, &pos);
+
+    uint32_t old_width = widths[class_of(leaf, block)];
+    uint32_t width = widths[std::popcount(word)];
+    uint32_t bits = leaf->bits - old_width + width;
+    fit(leaf, leaf->blocks, std::max(bits, leaf->bits), leaf->blocks, leaf->bits);
+    copy_bits(offsets(leaf), pos + width, offsets(leaf), pos + old_width, leaf->bits - pos - old_width);
+    if (width)
+        write_bits(offsets(leaf), pos, width, rrr_encode(word));
+    if (width < old_width)
+        fit(leaf, leaf->blocks, bits, leaf->blocks, bits);
+
+    write_bits(classes(leaf), block * CLASS_BITS, CLASS_BITS, std::popcount(word));
+    leaf->bits = bits;
+    sample(leaf);
+}
+
+// recompute the samples of the leaf (one in front of every SAMPLE_RATE'th sub-block and one behind the last)
+template <size_t S>
+void RRRBitVector<S>::sample(RRR_Node<S> *leaf) {
+    const auto &widths = rrr_widths();
+    uint32_t ones = 0, pos = 0;
+    for (uint32_t j = 0; j <= leaf->blocks; j++) {
+        if (j % SAMPLE_RATE == 0)
+            write_bits(leaf->data, j / SAMPLE_RATE * 32, 32, ones | pos << 16);
+        if (j < leaf->blocks) {
+            ones += class_of(leaf, j);
+            pos += widths[class_of(leaf, j)];
+        }
+    }
+}
+
+// set (value 1), unset (value 0) or flip (value -1) the bit at index (only its sub-block is encoded again)
+template <size_t S>
+void RRRBitVector<S>::update(uint32_t index, int value) {
+    uint32_t ones = 0;
+    RRR_Node<S> *leaf = find_block(this->root, &index, &ones);
+    if (index >= leaf->nums) {
+        std::cout << "Invalid index for update operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    uint32_t pos;
+    locate(leaf, index / 64, &ones, &pos);
+    uint64_t word = sub_block(leaf, index / 64, pos);
+    int32_t old_value = (word >> (index % 64)) & 1;
+    int32_t new_value = value < 0 ? !old_value : value;
+    if (old_value == new_value)
+        return;
+    replace(leaf, index / 64, word ^ (1ULL << (index % 64)));
+    propagate_update(leaf, NULL, 0, new_value - old_value);
+}
+
+// return the position of the num'th occurrence of value inside the leaf
+// the samples are skipped until the one in front of the result, then the classes of the sub-blocks are summed up
+template <size_t S>
+uint32_t RRRBitVector<S>::select_block(RRR_Node<S> *leaf, uint32_t num, bool value) {
+    const auto &widths = rrr_widths();
+    uint32_t s = 0;
+    while (s + 1 <= leaf->blocks / SAMPLE_RATE) {
+        uint32_t bits = std::min((s + 1) * SAMPLE_RATE * 64, leaf->nums);
+        uint32_t ones = sample_of(leaf, s + 1).ones;
+        if ((value ? ones : bits - ones) >= num)
+            break;
+        s++;
+    }
+
+    uint32_t j = s * SAMPLE_RATE;
+    RRR_Sample sample = sample_of(leaf, s);
+    uint32_t pos = sample.pos;
+    num -= value ? sample.ones : j * 64 - sample.ones;
+    for (;; j++) {
+        uint32_t bits = std::min(64u, leaf->nums - j * 64);
+        uint32_t ones = class_of(leaf, j);
+        uint32_t count = value ? ones : bits - ones;
+        if (num <= count)
+            break;
+        num -= count;
+        pos += widths[ones];
+    }
+
+    uint64_t word = sub_block(leaf, j, pos);
+    if (!value)
+        word = ~word & (leaf->nums - j * 64 >= 64 ? ~0ULL : (1ULL << (leaf->nums - j * 64)) - 1);
+    while (--num)
+        word &= word - 1;
+    return j * 64 + std::countr_zero(word);
+}
+
+template <size_t S>
+uint32_t RRRBitVector<S>::size(RRR_Node<S> *node) {
+    if (!node)
+        return 0;
+    return node->nums + size(node->r);
+}
+
+template <size_t S>
+uint64_t RRRBitVector<S>::payload_bits(RRR_Node<S> *node) {
+    if (this->is_leaf(node))
+        return node->data ? 64 * (sample_words(node->blocks) + class_words(node->blocks) + (node->bits + 63) / 64) : 0;
+    return payload_bits(node->l) + payload_bits(node->r);
+}
+
+// propagate changes in nodes up the tree to keep the navigation structure correct
+template <size_t S>
+void RRRBitVector<S>::propagate_update(RRR_Node<S> *node, RRR_Node<S> *prev_node, int32_t nums, int32_t ones) {
+    this->propagate(node, prev_node, [&](RRR_Node<S> *node, bool left) {
+        if (left) {
+            node->nums += nums;
+            node->ones += ones;
+        }
+    });
+}
+
+// update the data in the three nodes (parent and both child nodes) involved in the operation
+template <size_t S>
+void RRRBitVector<S>::split_block_update(RRR_Node<S> *node, RRR_Node<S> *left, RRR_Node<S> *right) {
+    std::array<uint64_t, BLOCKS + 1> words = {};
+    std::array<uint64_t, BLOCKS + 1> half = {};
+    decode(node, 0, words.data());
+    uint32_t right_nums = node->nums - TARGET_SIZE;
+    copy_bits(half.data(), 0, words.data(), TARGET_SIZE, right_nums);
+    clear_bits(words.data(), TARGET_SIZE, right_nums);
+
+    left->ones = encode(left, 0, words.data(), TARGET_SIZE);
+    left->nums = TARGET_SIZE;
+    right->ones = encode(right, 0, half.data(), right_nums);
+    right->nums = right_nums;
+
+    node->release_data();
+    node->nums = left->nums;
+    node->ones = left->ones;
+    propagate_update(node, NULL, 0, 0);
+}
+
+// take some bits from the left 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t S>
+void RRRBitVector<S>::steal_left(RRR_Node<S> *node, RRR_Node<S> *prev_leaf) {
+    std::array<uint64_t, BLOCKS + 1> words = {};
+    std::array<uint64_t, BLOCKS + 1> prev_words = {};
+    decode(node, 0, words.data());
+    decode(prev_leaf, 0, prev_words.data());
+
+    uint32_t steal = (prev_leaf->nums - node->nums) / 2;
+    uint32_t keep = prev_leaf->nums - steal;
+    copy_bits(words.data(), steal, words.data(), 0, node->nums);
+    int32_t ones = copy_bits(words.data(), 0, prev_words.data(), keep, steal);
+    clear_bits(prev_words.data(), keep, steal);
+    encode(node, 0, words.data(), node->nums + steal);
+    encode(prev_leaf, keep / 64, prev_words.data(), keep);
+
+    propagate_update(node, NULL, steal, ones);
+    propagate_update(prev_leaf, NULL, -steal, -ones);
+}
+
+// take some bits from the right 'neighbour' leaf and add them to node
+// this ensures that the tree remains balanced; afterwards propagate the changes
+template <size_t S>
+void RRRBitVector<S>::steal_right(RRR_Node<S> *node, RRR_Node<S> *next_leaf) {
+    std::array<uint64_t, BLOCKS + 1> words = {};
+    std::array<uint64_t, BLOCKS + 1> next_words = {};
+    decode(node, 0, words.data());
+    decode(next_leaf, 0, next_words.data());
+
+    uint32_t steal = (next_leaf->nums - node->nums) / 2;
+    int32_t ones = copy_bits(words.data(), node->nums, next_words.data(), 0, steal);
+    copy_bits(next_words.data(), 0, next_words.data(), steal, next_leaf->nums - steal);
+    clear_bits(next_words.data(), next_leaf->nums - steal, steal);
+    encode(node, node->nums / 64, words.data(), node->nums + steal);
+    encode(next_leaf, 0, next_words.data(), next_leaf->nums - steal);
+
+    propagate_update(node, NULL, steal, ones);
+    propagate_update(next_leaf, NULL, -steal, -ones);
+}
+
+// process the changes required after a left merge
+template <size_t S>
+void RRRBitVector<S>::merge_left_pre_update(RRR_Node<S> *node, RRR_Node<S> *prev_leaf) {
+    std::array<uint64_t, BLOCKS + 1> words = {};
+    std::array<uint64_t, BLOCKS + 1> prev_words = {};
+    decode(node, 0, words.data());
+    decode(prev_leaf, 0, prev_words.data());
+
+    copy_bits(words.data(), prev_leaf->nums, words.data(), 0, node->nums);
+    int32_t ones = copy_bits(words.data(), 0, prev_words.data(), 0, prev_leaf->nums);
+    encode(node, 0, words.data(), node->nums + prev_leaf->nums);
+    propagate_update(node, NULL, prev_leaf->nums, ones);
+    propagate_update(prev_leaf, NULL, -prev_leaf->nums, -ones);
+}
+
+// process the changes required after a right merge
+template <size_t S>
+void RRRBitVector<S>::merge_right_pre_update(RRR_Node<S> *node, RRR_Node<S> *next_leaf) {
+    std::array<uint64_t, BLOCKS + 1> words = {};
+    std::array<uint64_t, BLOCKS + 1> next_words = {};
+    decode(node, node->nums / 64, words.data());
+    decode(next_leaf, 0, next_words.data());
+
+    int32_t ones = copy_bits(words.data(), node->nums, next_words.data(), 0, next_leaf->nums);
+    encode(node, node->nums / 64, words.data(), node->nums + next_leaf->nums);
+    propagate_update(node, NULL, next_leaf->nums, ones);
+    propagate_update(next_leaf, NULL, -next_leaf->nums, -ones);
+}
+
+template <size_t S>
+void RRRBitVector<S>::merge_post_update(RRR_Node<S> *node) {
+    propagate_update(node, NULL, 0, 0);
+}
+
+// process the changes required after a left rotation
+template <size_t S>
+void RRRBitVector<S>::rotate_left_update(RRR_Node<S> *node) {
+    node->nums += node->l->nums;
+    node->ones += node->l->ones;
+}
+
+// process the changes required after a right rotation
+template <size_t S>
+void RRRBitVector<S>::rotate_right_update(RRR_Node<S> *node) {
+    node->r->nums -= node->nums;
+    node->r->ones -= node->ones;
+}
+
+#ifdef ADS_DEBUG
+template <size_t S>
+bool RRRBitVector<S>::validate() {
+    uint32_t nums, ones;
+    bool val = validate(this->root, &nums, &ones);
+    if (!val)
+        std::cout << "Nicht valider Baum" << std::endl;
+    return val;
+}
+
+// check the counters of all nodes and the encoding of the leaves; the number of bits and ones are returned
+template <size_t S>
+bool RRRBitVector<S>::validate(RRR_Node<S> *node, uint32_t *nums, uint32_t *ones) {
+    if (this->is_leaf(node)) {
+        *nums = node->nums;
+        *ones = node->ones;
+        // a leaf that was never encoded has no buffer yet
+        if (node->blocks != (node->nums + 63) / 64 || node->height != 1 || (!node->data && node->nums))
+            return false;
+        if (!node->data)
+            return node->ones == 0 && node->bits == 0;
+        if (node->capacity < sample_words(node->blocks) + class_words(node->blocks) + (node->bits + 63) / 64)
+            return false;
+
+        std::array<uint64_t, BLOCKS + 1> words = {};
+        decode(node, 0, words.data());
+        uint32_t count = 0, bits = 0;
+        for (uint32_t j = 0; j < node->blocks; j++) {
+            if ((uint32_t) std::popcount(words[j]) != class_of(node, j))
+                return false;
+            count += class_of(node, j);
+            bits += rrr_widths()[class_of(node, j)];
+        }
+        if (node->nums % 64 && words[node->nums / 64] >> (node->nums % 64))
+            return false;
+
+        std::vector<RRR_Sample> samples;
+        for (uint32_t s = 0; s <= node->blocks / SAMPLE_RATE; s++)
+            samples.push_back(sample_of(node, s));
+        sample(node);
+        for (uint32_t s = 0; s < samples.size(); s++)
+            if (samples[s].ones != sample_of(node, s).ones || samples[s].pos != sample_of(node, s).pos)
+                return false;
+        return count == node->ones && bits == node->bits;
+    }
+
+    uint32_t nums_r, ones_r;
+    if (!validate(node->l, nums, ones) || !validate(node->r, &nums_r, &ones_r))
+        return false;
+    if (node->nums != *nums || node->ones != *ones || node->height != std::max(node->l->height, node->r->height) + 1)
+        return false;
+    *nums += nums_r;
+    *ones += ones_r;
+    return true;
+}
+#endif
+
+#endif
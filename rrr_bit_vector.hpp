@@ -0,0 +1,131 @@
+#ifndef RRRBITVECTOR
+#define RRRBITVECTOR
+
+#include "avl.hpp"
+
+#include <vector>
+
+// ones and offset bits in front of a sampled sub-block of a leaf
+struct RRR_Sample {
+    uint16_t ones;
+    uint16_t pos;
+};
+
+// encapsualte the members that are needed for the compressed bitvector tree structure
+// (inner nodes store the counters of the left subtree, leaves their own counters and the encoded sub-blocks)
+// every sub-block of 64 bits is stored as its class (number of ones) and its offset among all sub-blocks of that
+// class; the offset takes only ceil(log2(64 choose class)) bits, so sparse and dense sub-blocks shrink
+// the samples, the classes and the offsets of a leaf share one buffer that is sized to the encoding
+template <size_t S>
+struct RRR_Node : Node<RRR_Node<S>> {
+    uint32_t nums;
+    uint32_t ones;
+    uint32_t bits;                      // used bits of the offset stream
+    uint16_t blocks;                    // number of encoded sub-blocks
+    uint16_t capacity;                  // words of data
+    uint64_t *data;                     // samples, classes and offsets (NULL until the leaf is encoded)
+
+    RRR_Node() {
+        nums = 0;
+        ones = 0;
+        bits = 0;
+        blocks = 0;
+        capacity = 0;
+        data = NULL;
+    }
+
+    ~RRR_Node() {
+        delete[] data;
+    }
+
+    void release_data() {
+        delete[] data;
+        data = NULL;
+        bits = 0;
+        blocks = 0;
+        capacity = 0;
+    }
+};
+
+// dynamic bitvector with entropy compressed leaves (RRR encoding)
+// the payload takes about nH0 bits plus the classes (7 bits per sub-block) and the samples; access and rank decode a
+// single sub-block, inserts and deletes re-encode the sub-blocks behind the update inside the leaf, flips re-encode
+// the touched sub-block and move the offsets behind it
+// (inside a leaf the bit at position i is bit i % 64 of sub-block i / 64; the buffer of a leaf holds a 32 bit sample
+// for every SAMPLE_RATE'th sub-block, then the classes and then the offsets, each part starting at a new word)
+template <size_t S = 16384>
+class RRRBitVector : public AVL<RRR_Node<S>> {
+    static_assert(S % 64 == 0 && S < 65536, "the block size has to be a multiple of 64 below 65536");
+
+    private:
+        static const uint32_t BLOCKS = S / 64;
+        static const uint32_t SAMPLE_RATE = 32;
+        static const uint32_t CLASS_BITS = 7;       // classes range from 0 to 64
+
+        size_t BLOCK_SIZE;
+        size_t TARGET_SIZE;
+        size_t SPLIT_BOUND;
+        size_t LOWER_BOUND;
+
+        static uint32_t sample_words(uint32_t);
+        static uint32_t class_words(uint32_t);
+        uint64_t *classes(RRR_Node<S> *);
+        uint64_t *offsets(RRR_Node<S> *);
+        uint32_t class_of(RRR_Node<S> *, uint32_t);
+        RRR_Sample sample_of(RRR_Node<S> *, uint32_t);
+        void fit(RRR_Node<S> *, uint32_t, uint32_t, uint32_t, uint32_t);
+
+        RRR_Node<S> *find_block(RRR_Node<S> *, uint32_t *, uint32_t *);
+        void locate(RRR_Node<S> *, uint32_t, uint32_t *, uint32_t *);
+        uint64_t sub_block(RRR_Node<S> *, uint32_t, uint32_t);
+        void decode(RRR_Node<S> *, uint32_t, uint64_t *);
+        uint32_t encode(RRR_Node<S> *, uint32_t, const uint64_t *, uint32_t);
+        void replace(RRR_Node<S> *, uint32_t, uint64_t);
+        void sample(RRR_Node<S> *);
+        void update(uint32_t, int);
+        uint32_t select_block(RRR_Node<S> *, uint32_t, bool);
+        uint32_t size(RRR_Node<S> *);
+        uint64_t payload_bits(RRR_Node<S> *);
+
+        #ifdef ADS_DEBUG
+        bool validate(RRR_Node<S> *, uint32_t *, uint32_t *);
+        #endif
+
+        void propagate_update(RRR_Node<S> *, RRR_Node<S> *, int32_t, int32_t);
+
+        void split_block_update(RRR_Node<S> *, RRR_Node<S> *, RRR_Node<S> *);
+
+        void steal_left(RRR_Node<S> *, RRR_Node<S> *);
+        void steal_right(RRR_Node<S> *, RRR_Node<S> *);
+
+        void merge_left_pre_update(RRR_Node<S> *, RRR_Node<S> *);
+        void merge_right_pre_update(RRR_Node<S> *, RRR_Node<S> *);
+        void merge_post_update(RRR_Node<S> *);
+
+        void rotate_left_update(RRR_Node<S> *);
+        void rotate_right_update(RRR_Node<S> *);
+
+    public:
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        void flip(uint32_t);
+        bool access(uint32_t);
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        uint32_t size();
+        std::vector<bool> extract();
+        uint64_t payload_bits();
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        RRRBitVector();
+        RRRBitVector(std::vector<bool>);
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef RUNTIMEBITVECTOR_IMPL
+#define RUNTIMEBITVECTOR_IMPL
+
+#include "bit_vector.cpp"
+#include "runtime_bit_vector.hpp"
+
+#include <chrono>
+#include <random>
+#include <limits>
+
+// (the members are not templates, so they are defined inline like the helpers in bit_vector.cpp)
+
+inline RuntimeBitVector::RuntimeBitVector(uint32_t block_size) {
+    create(block_size);
+}
+
+inline RuntimeBitVector::RuntimeBitVector(std::vector<bool> bits, uint32_t block_size) {
+    create(block_size, bits);
+}
+
+// replace the bitvector by one with the requested block size that is constructed from args
+template <typename... A>
+void RuntimeBitVector::create(uint32_t block_size, A &&... args) {
+    switch (block_size) {
+        case 64:
+            bv.emplace<BitVector<64>>(std::forward<A>(args)...);
+            return;
+        case 256:
+            bv.emplace<BitVector<256>>(std::forward<A>(args)...);
+            return;
+        case 512:
+            bv.emplace<BitVector<512>>(std::forward<A>(args)...);
+            return;
+        case 1024:
+            bv.emplace<BitVector<1024>>(std::forward<A>(args)...);
+            return;
+        case 4096:
+            bv.emplace<BitVector<4096>>(std::forward<A>(args)...);
+            return;
+    }
+    std::cout << "Invalid block size " << block_size << " (using 512)" << std::endl;
+    bv.emplace<BitVector<512>>(std::forward<A>(args)...);
+}
+
+inline bool RuntimeBitVector::supported(uint32_t block_size) {
+    for (auto size : BLOCK_SIZES)
+        if (size == block_size)
+            return true;
+    return false;
+}
+
+inline void RuntimeBitVector::insert(uint32_t index, bool value) {
+    std::visit([&](auto &v) { v.insert(index, value); }, bv);
+}
+
+inline void RuntimeBitVector::del(uint32_t index) {
+    std::visit([&](auto &v) { v.del(index); }, bv);
+}
+
+inline void RuntimeBitVector::flip(uint32_t index) {
+    std::visit([&](auto &v) { v.flip(index); }, bv);
+}
+
+inline void RuntimeBitVector::set(uint32_t index) {
+    std::visit([&](auto &v) { v.set(index); }, bv);
+}
+
+inline void RuntimeBitVector::unset(uint32_t index) {
+    std::visit([&](auto &v) { v.unset(index); }, bv);
+}
+
+inline uint32_t RuntimeBitVector::rank(uint32_t index, bool value) {
+    return std::visit([&](auto &v) { return v.rank(index, value); }, bv);
+}
+
+inline uint32_t RuntimeBitVector::select(uint32_t num, bool value) {
+    return std::visit([&](auto &v) { return v.select(num, value); }, bv);
+}
+
+inline bool RuntimeBitVector::access(uint32_t index) {
+    return std::visit([&](auto &v) { return v.access(index); }, bv);
+}
+
+inline uint32_t RuntimeBitVector::size() {
+    return std::visit([](auto &v) { return v.size(); }, bv);
+}
+
+inline std::vector<bool> RuntimeBitVector::extract() {
+    return std::visit([](auto &v) { return v.extract(); }, bv);
+}
+
+inline BV_Memory RuntimeBitVector::memory_usage() {
+    return std::visit([](auto &v) { return v.memory_usage(); }, bv);
+}
+
+inline uint32_t RuntimeBitVector::block_size() {
+    return BLOCK_SIZES[bv.index()];
+}
+
+inline bool RuntimeBitVector::operator[](uint32_t index) {
+    return access(index);
+}
+
+#ifdef ADS_DEBUG
+inline bool RuntimeBitVector::validate() {
+    return std::visit([](auto &v) { return v.validate(); }, bv);
+}
+#endif
+
+// apply all operations of the trace and return the mean time per operation in ns
+// (the dispatch over the block sizes happens once for the whole trace, so the time is that of the plain bitvector)
+inline double RuntimeBitVector::replay(const std::vector<BV_Op> &trace) {
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::visit([&](auto &v) {
+        for (auto &op : trace) {
+            switch (op.kind) {
+                case BV_OpKind::insert:
+                    v.insert(op.index, op.value);
+                    break;
+                case BV_OpKind::del:
+                    v.del(op.index);
+                    break;
+                case BV_OpKind::flip:
+                    v.flip(op.index);
+                    break;
+                case BV_OpKind::access:
+                    sink += v.access(op.index);
+                    break;
+                case BV_OpKind::rank:
+                    sink += v.rank(op.index, op.value);
+                    break;
+                case BV_OpKind::select:
+                    sink += v.select(op.index, op.value);
+                    break;
+            }
+        }
+    }, bv);
+    auto end = std::chrono::steady_clock::now();
+    volatile uint64_t keep = sink;     // the queries must not be optimized away
+    (void) keep;
+    return trace.empty() ? 0 : std::chrono::duration<double, std::nano>(end - start).count() / trace.size();
+}
+
+// generate a trace of ops operations on bits (read_percent of them access, rank or select, the rest inserts, deletes
+// and flips at uniformly random positions); the trace is simulated while it is generated so that every index and
+// select num is valid when the trace is replayed on bits
+inline std::vector<BV_Op> RuntimeBitVector::sample_trace(const std::vector<bool> &bits, uint32_t ops, uint32_t read_percent,
+                                                         uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    BitVector<512> sim(bits);
+    uint32_t size = bits.size();
+    uint32_t ones = sim.rank(size, true);
+
+    std::vector<BV_Op> trace;
+    trace.reserve(ops);
+    for (uint32_t i = 0; i < ops; i++) {
+        BV_Op op = {BV_OpKind::access, 0, (bool) (rng() % 2)};
+        uint32_t kind = rng() % 3;
+        if (rng() % 100 < read_percent) {
+            uint32_t count = op.value ? ones : size - ones;
+            if (kind == 2 && count > 0) {
+                op.kind = BV_OpKind::select;
+                op.index = 1 + rng() % count;
+            } else if (kind == 1 || size == 0) {
+                op.kind = BV_OpKind::rank;
+                op.index = rng() % (size + 1);
+            } else {
+                op.index = rng() % size;
+            }
+        } else if (kind == 0 || size == 0) {
+            op.kind = BV_OpKind::insert;
+            op.index = rng() % (size + 1);
+            sim.insert(op.index, op.value);
+            ones += op.value;
+            size++;
+        } else if (kind == 1) {
+            op.kind = BV_OpKind::del;
+            op.index = rng() % size;
+            ones -= sim.access(op.index);
+            sim.del(op.index);
+            size--;
+        } else {
+            op.kind = BV_OpKind::flip;
+            op.index = rng() % size;
+            ones += sim.access(op.index) ? -1 : 1;
+            sim.flip(op.index);
+        }
+        trace.push_back(op);
+    }
+    return trace;
+}
+
+// replay the trace on bits with every supported block size (repeats times each, the fastest run counts)
+inline std::vector<BV_Calibration> RuntimeBitVector::measure(const std::vector<bool> &bits, const std::vector<BV_Op> &trace,
+                                                             uint32_t repeats) {
+    std::vector<BV_Calibration> results;
+    for (auto block_size : BLOCK_SIZES) {
+        BV_Calibration result = {block_size, std::numeric_limits<double>::max(), 0};
+        for (uint32_t i = 0; i < std::max(repeats, 1u); i++) {
+            RuntimeBitVector rbv(bits, block_size);
+            result.ns_per_op = std::min(result.ns_per_op, rbv.replay(trace));
+            result.bytes_per_bit = rbv.memory_usage().bytes_per_bit();
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+// return the block size with the least memory among those that replay the trace in at most max_ns per operation
+// (the fastest block size if none of them is fast enough)
+inline uint32_t RuntimeBitVector::calibrate_latency(const std::vector<bool> &bits, const std::vector<BV_Op> &trace, double max_ns) {
+    std::vector<BV_Calibration> results = measure(bits, trace);
+    BV_Calibration *best = NULL;
+    for (auto &result : results)
+        if (result.ns_per_op <= max_ns && (!best || result.bytes_per_bit < best->bytes_per_bit))
+            best = &result;
+    if (!best)
+        best = &*std::min_element(results.begin(), results.end(),
+                                  [](auto &a, auto &b) { return a.ns_per_op < b.ns_per_op; });
+    return best->block_size;
+}
+
+// return the fastest block size among those that use at most max_bytes_per_bit after replaying the trace
+// (the block size with the least memory if none of them is small enough)
+inline uint32_t RuntimeBitVector::calibrate_memory(const std::vector<bool> &bits, const std::vector<BV_Op> &trace,
+                                                   double max_bytes_per_bit) {
+    std::vector<BV_Calibration> results = measure(bits, trace);
+    BV_Calibration *best = NULL;
+    for (auto &result : results)
+        if (result.bytes_per_bit <= max_bytes_per_bit && (!best || result.ns_per_op < best->ns_per_op))
+            best = &result;
+    if (!best)
+        best = &*std::min_element(results.begin(), results.end(),
+                                  [](auto &a, auto &b) { return a.bytes_per_bit < b.bytes_per_bit; });
+    return best->block_size;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RUNTIMEBITVECTOR
+#define RUNTIMEBITVECTOR
+
+#include "bit_vector.hpp"
+
+#include <variant>
+#include <vector>
+
+// kinds of operations in a calibration trace
+enum class BV_OpKind : uint8_t {
+    insert,
+    del,
+    flip,
+    access,
+    rank,
+    select
+};
+
+// a single operation of a calibration trace
+// (index is the num for select; the value is ignored by del, flip and access)
+struct BV_Op {
+    BV_OpKind kind;
+    uint32_t index;
+    bool value;
+};
+
+// result of replaying a calibration trace with one block size
+struct BV_Calibration {
+    uint32_t block_size;
+    double ns_per_op;       // mean over the trace (best of the repetitions)
+    double bytes_per_bit;   // as reported by memory_usage() after the trace
+};
+
+// dynamic bitvector whose block size is chosen at runtime from BLOCK_SIZES
+// every supported block size is instantiated once and the operations are dispatched over a std::variant; the
+// calibration replays a sample trace with every block size and picks the one that meets a latency or memory target
+class RuntimeBitVector {
+    private:
+        std::variant<BitVector<64>, BitVector<256>, BitVector<512>, BitVector<1024>, BitVector<4096>> bv;
+
+        template <typename... A>
+        void create(uint32_t, A &&...);
+
+    public:
+        // in the order of the alternatives of the variant
+        static constexpr uint32_t BLOCK_SIZES[] = {64, 256, 512, 1024, 4096};
+
+        static bool supported(uint32_t);
+        static std::vector<BV_Op> sample_trace(const std::vector<bool> &, uint32_t, uint32_t, uint64_t = 0);
+        static std::vector<BV_Calibration> measure(const std::vector<bool> &, const std::vector<BV_Op> &, uint32_t = 3);
+        static uint32_t calibrate_latency(const std::vector<bool> &, const std::vector<BV_Op> &, double);
+        static uint32_t calibrate_memory(const std::vector<bool> &, const std::vector<BV_Op> &, double);
+
+        void insert(uint32_t, bool);
+        void del(uint32_t);
+        void flip(uint32_t);
+        void set(uint32_t);
+        void unset(uint32_t);
+        uint32_t rank(uint32_t, bool);
+        uint32_t select(uint32_t, bool);
+        bool access(uint32_t);
+        uint32_t size();
+        std::vector<bool> extract();
+        BV_Memory memory_usage();
+        uint32_t block_size();
+        double replay(const std::vector<BV_Op> &);
+
+        #ifdef ADS_DEBUG
+        bool validate();
+        #endif
+
+        bool operator[](uint32_t);
+
+        RuntimeBitVector(uint32_t = 512);
+        RuntimeBitVector(std::vector<bool>, uint32_t = 512);
+};
+
+#endif
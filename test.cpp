@@ -1,6 +1,18 @@
 #include "bit_vector.cpp"
+#include "wavelet_tree.cpp"
+#include "packed_vector.cpp"
+#include "paged_bit_vector.cpp"
+#include "multi_bit_vector.cpp"
+#include "rrr_bit_vector.cpp"
+#include "runtime_bit_vector.cpp"
+#include "journaled_bit_vector.cpp"
+#include "replicated_bit_vector.cpp"
+#include "buffered_bit_vector.cpp"
 
 #include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 const size_t BLOCK_SIZE = 512;
 
@@ -173,6 +185,32 @@ bool test_bv_rdm_insdel() {
     return fail(name);
 }
 
+template <size_t S>
+bool check_bv_shift(uint32_t n) {
+    BitVector<S> bv;
+    std::vector<bool> bits;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    // shrink the bitvector so that leaves are merged and bits are stolen
+    for (uint32_t i = 0; i < n - n / 8; i++) {
+        uint32_t index = rand() % bits.size();
+        bv.del(index);
+        bits.erase(bits.begin() + index);
+    }
+    return bv.validate() && bv.extract() == bits && bv.rank(bits.size(), true) == std::count(bits.begin(), bits.end(), true);
+}
+
+bool test_bv_shift() {
+    std::string name = "bv word level shifts";
+    if (!check_bv_shift<BLOCK_SIZE>(8000) || !check_bv_shift<100>(3000) || !check_bv_shift<4096>(16000))
+        return fail(name);
+    return succ(name);
+}
+
 bool test_bv_big_insdel() {
     std::string name = "bv big insert/delete";
     auto start = std::chrono::system_clock::now();
@@ -195,75 +233,1311 @@ bool test_bv_big_insdel() {
         return succ(name, time);
     return fail(name);
 }
-#endif
 
-std::pair<long long, long long> benchmark_bv(uint32_t count) {
-    const size_t BLK_SIZE = 8;
-    auto start = std::chrono::system_clock::now();
-    BitVector<BLK_SIZE> bv;
-    for (uint32_t i = 0; i < count; i++)
-        bv.insert(0, i % 2);
-    for (uint32_t i = 0; i < count; i++)
-        bv.rank(i / 2 + 1, i % 2);
+bool test_bv_memory() {
+    std::string name = "bv memory usage";
+    #ifdef __GLIBC__
+    size_t heap_start = mallinfo2().uordblks;
+    #endif
+    BitVector<BLOCK_SIZE> bv;
+    for (int i = 0; i < 100000; i++)
+        bv.insert(rand() % (i + 1), i % 3 == 0);
+    for (int i = 0; i < 50000; i++)
+        bv.del(rand() % (100000 - i));
+    BV_Memory memory = bv.memory_usage();
+
+    uint64_t histogram = 0;
+    for (auto count : memory.fill_histogram)
+        histogram += count;
+    if (memory.bits != bv.size() || histogram != memory.leaves || memory.inner_nodes + 1 != memory.leaves)
+        return fail(name);
+    if (memory.slack_bits != memory.leaves * BLOCK_SIZE - memory.bits)
+        return fail(name);
+    #ifdef __GLIBC__
+    // the accounted heap memory has to match what the allocator reports
+    // (up to the chunks that are cached by the allocator after being freed)
+    int64_t heap = mallinfo2().uordblks - heap_start;
+    int64_t accounted = memory.total_bytes - memory.object_bytes;
+    if (std::abs(heap - accounted) > accounted / 20)
+        return fail(name);
+    #endif
+    return succ(name);
+}
+
+bool test_bv_clone() {
+    std::string name = "bv clone/move";
+    BitVector<BLOCK_SIZE> bv;
+    std::vector<bool> bits;
+    for (int i = 0; i < 12000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+
+    // the copy is independent of the original and can be updated like any other bitvector
+    BitVector<BLOCK_SIZE> copy = bv.clone();
+    std::vector<bool> copy_bits = bits;
+    if (!copy.validate() || copy.extract() != bits)
+        return fail(name);
+    BV_Memory memory = copy.memory_usage();
+    if (memory.inner_nodes + 1 != memory.leaves || memory.bits != bits.size())
+        return fail(name);
+    for (int i = 0; i < 8000; i++) {
+        uint32_t index = rand() % copy_bits.size();
+        copy.del(index);
+        copy_bits.erase(copy_bits.begin() + index);
+        index = rand() % (copy_bits.size() + 1);
+        copy.insert(index, true);
+        copy_bits.insert(copy_bits.begin() + index, true);
+        index = rand() % copy_bits.size();
+        copy.del(index);
+        copy_bits.erase(copy_bits.begin() + index);
+    }
+    bv.flip(0);
+    bits[0] = !bits[0];
+    if (!copy.validate() || copy.extract() != copy_bits || bv.extract() != bits)
+        return fail(name);
+
+    // moving hands over the tree; the moved from bitvector stays usable
+    BitVector<BLOCK_SIZE> moved(std::move(copy));
+    if (moved.extract() != copy_bits || copy.size() != 0)
+        return fail(name);
+    copy.insert(0, true);
+    moved = std::move(bv);
+    if (moved.extract() != bits || bv.extract() != copy_bits || !bv.validate())
+        return fail(name);
+    moved.compact();
+    if (!moved.validate() || moved.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_relayout() {
+    std::string name = "bv relayout";
+    BitVector<BLOCK_SIZE> bv;
+    std::vector<bool> bits;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    uint32_t leaves = bv.memory_usage().leaves;
+    bv.relayout();
+    if (!bv.validate() || bv.extract() != bits || bv.memory_usage().leaves != leaves)
+        return fail(name);
+    for (uint32_t i = 0; i < bits.size(); i += 97)
+        if (bv.rank(i, true) != std::count(bits.begin(), bits.begin() + i, true))
+            return fail(name);
+
+    // updates keep working on the relaid tree (and nodes of the slab are dropped by merges)
+    for (int i = 0; i < 15000; i++) {
+        uint32_t index = rand() % bits.size();
+        bv.del(index);
+        bits.erase(bits.begin() + index);
+        if (i % 4 == 0) {
+            index = rand() % (bits.size() + 1);
+            bv.insert(index, true);
+            bits.insert(bits.begin() + index, true);
+        }
+    }
+    if (!bv.validate() || bv.extract() != bits)
+        return fail(name);
+    bv.relayout();
+    if (!bv.validate() || bv.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_compact() {
+    std::string name = "bv compact";
+    BitVector<BLOCK_SIZE> bv;
+    for (int i = 0; i < 100000; i++)
+        bv.insert(rand() % (i + 1), rand() % 2);
+    for (int i = 0; i < 80000; i++)
+        bv.del(rand() % (100000 - i));
+    std::vector<bool> bits = bv.extract();
+    uint32_t leaves = bv.memory_usage().leaves;
+
+    BitVector<BLOCK_SIZE> inc(bits);
+    while (!inc.compact_step(16))
+        if (!inc.validate())
+            return fail(name);
+    if (!inc.validate() || inc.extract() != bits || inc.memory_usage().mean_fill() < 0.9)
+        return fail(name);
+
+    bv.compact();
+    BV_Memory memory = bv.memory_usage();
+    if (!bv.validate() || bv.extract() != bits || memory.leaves >= leaves || memory.mean_fill() < 0.95)
+        return fail(name);
+    for (int i = 0; i < 1000; i++)
+        bv.insert(rand() % (bits.size() + i + 1), i % 2);
+    if (!bv.validate())
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_rebalance() {
+    std::string name = "bv rebalance";
+    BitVector<64> bv;
+    std::vector<bool> bits;
+    for (int round = 0; round < 4; round++) {
+        bv.reset_rebalance_stats();
+        for (int i = 0; i < 20000; i++) {
+            // grow in the first two rounds and shrink in the last two
+            if (rand() % 4 < (round < 2 ? 3 : 1) || bits.empty()) {
+                uint32_t index = rand() % (bits.size() + 1);
+                bool value = rand() % 2;
+                bv.insert(index, value);
+                bits.insert(bits.begin() + index, value);
+            } else {
+                uint32_t index = rand() % bits.size();
+                bv.del(index);
+                bits.erase(bits.begin() + index);
+            }
+        }
+        AVL_Stats stats = bv.rebalance_stats();
+        if (!bv.validate() || bv.extract() != bits || stats.rotations == 0 || stats.visited == 0)
+            return fail(name);
+        #ifdef ADS_WAVL
+        if (!bv.rank_balanced())
+            return fail(name);
+        #endif
+    }
+    bv.reset_rebalance_stats();
+    if (bv.rebalance_stats().rotations != 0 || bv.rebalance_stats().visited != 0)
+        return fail(name);
+
+    // trees built in one go (and their copies) take part in the rebalancing just the same
+    BitVector<64> built(bits);
+    BitVector<64> copy = built.clone();
+    for (int i = 0; i < 5000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        built.insert(index, i % 2);
+        copy.insert(index, i % 2);
+        bits.insert(bits.begin() + index, i % 2);
+    }
+    if (!built.validate() || !copy.validate() || built.extract() != bits || copy.extract() != bits)
+        return fail(name);
+    #ifdef ADS_WAVL
+    if (!built.rank_balanced() || !copy.rank_balanced())
+        return fail(name);
+    #endif
+    return succ(name);
+}
+
+bool test_bv_adapt() {
+    std::string name = "bv adapt";
+    BitVector<BLOCK_SIZE, BV_ADAPT> bv;
+    std::vector<bool> bits;
+    for (int i = 0; i < 50000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    std::vector<uint32_t> ranks = {0};
+    for (auto bit : bits)
+        ranks.push_back(ranks.back() + bit);
+
+    // most queries hit a small region; the tree is reshaped every 1000 queries
+    bv.adapt_every(1000);
     uint32_t tree_size = bv.tree_size();
-    for (uint32_t i = 0; i < count; i++)
-        bv.select(i / 2 + 1, i % 2);
-    for (uint32_t i = 0; i < count; i++)
-        bv.del(0);
-    auto end = std::chrono::system_clock::now();
-    long long time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    long long size = (tree_size * sizeof(BV_Node<BLK_SIZE>)) * 8 + ((tree_size + 1) / 2) * BLK_SIZE;
-    
-    return std::make_pair(time, size);
+    auto cursor = bv.cursor(2000);
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % 4 ? 1000 + rand() % 2000 : rand() % bits.size();
+        if (bv.access(index) != bits[index] || bv.rank(index, true) != ranks[index])
+            return fail(name);
+        if (bits[index] && bv.select(ranks[index] + 1, true) != index)
+            return fail(name);
+    }
+    // reshaping keeps the leaves (so the cursor stays valid) and only rewires the inner nodes
+    if (!bv.validate() || bv.extract() != bits || bv.tree_size() != tree_size || !cursor.valid() || cursor.access() != bits[2000])
+        return fail(name);
+
+    // updates rebalance the reshaped tree while the queries keep reshaping it
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % bits.size();
+        if (i % 2) {
+            bv.del(index);
+            bits.erase(bits.begin() + index);
+        } else {
+            bv.insert(index, i % 3);
+            bits.insert(bits.begin() + index, i % 3);
+        }
+        index = rand() % 4 ? rand() % 1000 : rand() % bits.size();
+        if (bv.access(index) != bits[index])
+            return fail(name);
+    }
+    bv.adapt();
+    if (!bv.validate() || bv.extract() != bits)
+        return fail(name);
+    bv.adapt_every(0);
+    bv.compact();
+    if (!bv.validate() || bv.extract() != bits)
+        return fail(name);
+    return succ(name);
 }
 
-int main(int argc, char *argv[]) {
+bool test_bv_cursor() {
+    std::string name = "bv cursor";
+    std::vector<bool> bits;
+    for (int i = 0; i < 20000; i++)
+        bits.push_back(rand() % 2);
+    BitVector<BLOCK_SIZE> bv(bits);
+
+    // forward and backward scans
+    auto cursor = bv.cursor(0);
+    for (uint32_t i = 0; i < bits.size(); i++, cursor.next())
+        if (cursor.position() != i || cursor.access() != bits[i])
+            return fail(name);
+    if (cursor.valid() || cursor.next())
+        return fail(name);
+    for (uint32_t i = bits.size(); i-- > 0;)
+        if (!cursor.prev() || cursor.access() != bits[i])
+            return fail(name);
+    if (cursor.prev())
+        return fail(name);
+
+    // finger search to nearby and distant positions
+    for (int i = 0; i < 10000; i++) {
+        uint32_t index = i % 2 ? rand() % bits.size() : std::min<uint32_t>(bits.size() - 1, cursor.position() + rand() % 1000);
+        cursor.seek(index);
+        if (cursor.position() != index || cursor.access() != bits[index])
+            return fail(name);
+    }
+
+    // updates at a moving position
+    cursor.seek(1000);
+    for (int i = 0; i < 5000; i++) {
+        bool value = rand() % 2;
+        cursor.insert(value);
+        bits.insert(bits.begin() + cursor.position(), value);
+        cursor.next();
+    }
+    for (int i = 0; i < 8000; i++) {
+        if (i % 3 == 0)
+            cursor.seek(rand() % bits.size());
+        cursor.del();
+        bits.erase(bits.begin() + cursor.position());
+        if (!cursor.valid())
+            cursor.seek(0);
+        cursor.flip();
+        bits[cursor.position()] = !bits[cursor.position()];
+    }
+
+    // an end cursor points behind the last bit; updates through it are skipped and leave the counters intact
+    cursor.seek(bits.size());
+    uint32_t ones = bv.rank(bits.size(), true);
+    cursor.flip();
+    cursor.set();
+    cursor.unset();
+    if (cursor.valid() || cursor.access() || bv.size() != bits.size() || bv.rank(bits.size(), true) != ones)
+        return fail(name);
+    cursor.insert(true);
+    bits.push_back(true);
+    if (!bv.validate() || bv.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_bitwise() {
+    std::string name = "bv bitwise operations";
+    std::vector<bool> bits_a, bits_b;
+    BitVector<BLOCK_SIZE> a;
+    for (int i = 0; i < 30000; i++) {
+        uint32_t index = rand() % (i + 1);
+        bool value = rand() % 2;
+        a.insert(index, value);
+        bits_a.insert(bits_a.begin() + index, value);
+        bits_b.push_back(rand() % 3 == 0);
+    }
+    BitVector<BLOCK_SIZE> b(bits_b);
+
+    std::vector<bool> expected_and, expected_or, expected_xor, expected_andnot;
+    for (uint32_t i = 0; i < bits_a.size(); i++) {
+        expected_and.push_back(bits_a[i] && bits_b[i]);
+        expected_or.push_back(bits_a[i] || bits_b[i]);
+        expected_xor.push_back(bits_a[i] != bits_b[i]);
+        expected_andnot.push_back(bits_a[i] && !bits_b[i]);
+    }
+
+    BitVector<BLOCK_SIZE> result = BitVector<BLOCK_SIZE>::and_of(a, b);
+    if (!result.validate() || result.extract() != expected_and)
+        return fail(name);
+    result = BitVector<BLOCK_SIZE>::or_of(a, b);
+    if (!result.validate() || result.extract() != expected_or)
+        return fail(name);
+    result = BitVector<BLOCK_SIZE>::xor_of(a, b);
+    if (!result.validate() || result.extract() != expected_xor)
+        return fail(name);
+    result = BitVector<BLOCK_SIZE>::andnot_of(a, b);
+    if (!result.validate() || result.extract() != expected_andnot)
+        return fail(name);
+
+    BitVector<BLOCK_SIZE> c(bits_a);
+    c.xor_with(b);
+    if (!c.validate() || c.extract() != expected_xor)
+        return fail(name);
+    c.xor_with(b);
+    c.andnot_with(b);
+    if (!c.validate() || c.extract() != expected_andnot)
+        return fail(name);
+    a = BitVector<BLOCK_SIZE>::or_of(a, b);
+    if (!a.validate() || a.extract() != expected_or)
+        return fail(name);
+    a.and_with(b);
+    if (!a.validate() || a.extract() != bits_b)
+        return fail(name);
+    return succ(name);
+}
+
+template <size_t S>
+bool check_bv_scan(std::vector<bool> bits) {
+    BitVector<S> bv(bits);
+    for (int i = 0; i < 500; i++)
+        bv.del(rand() % bv.size());
+    bits = bv.extract();
+
+    int32_t n = bits.size();
+    std::vector<uint32_t> ones;
+    for (int32_t i = 0; i < n; i++)
+        if (bits[i])
+            ones.push_back(i);
+    std::vector<uint32_t> iterated(bv.ones_begin(), bv.ones_end());
+    if (iterated != ones)
+        return false;
+
+    for (int32_t i = 0; i < n; i += 1 + rand() % 7) {
+        int32_t next_one = i, next_zero = i, prev_one = i, prev_zero = i;
+        while (next_one < n && !bits[next_one])
+            next_one++;
+        while (next_zero < n && bits[next_zero])
+            next_zero++;
+        while (prev_one >= 0 && !bits[prev_one])
+            prev_one--;
+        while (prev_zero >= 0 && bits[prev_zero])
+            prev_zero--;
+        if (bv.next_one(i) != (next_one == n ? (uint32_t) -1 : next_one)
+            || bv.next_zero(i) != (next_zero == n ? (uint32_t) -1 : next_zero)
+            || bv.prev_one(i) != (uint32_t) prev_one
+            || bv.prev_zero(i) != (uint32_t) prev_zero)
+            return false;
+    }
+    for (uint32_t k = 1; k <= ones.size(); k += 1 + rand() % 13)
+        if (bv.select(k, true) != ones[k - 1])
+            return false;
+    return true;
+}
+
+bool test_bv_scan() {
+    std::string name = "bv next/prev one/zero";
+    std::vector<bool> dense, sparse, runs;
+    for (int i = 0; i < 20000; i++) {
+        dense.push_back(rand() % 2);
+        sparse.push_back(rand() % 3000 == 0);
+        runs.push_back((i / 2500) % 2 ? rand() % 50 != 0 : rand() % 50 == 0);
+    }
+    for (auto bits : {dense, sparse, runs}) {
+        if (!check_bv_scan<BLOCK_SIZE>(bits) || !check_bv_scan<8>(bits) || !check_bv_scan<100>(bits))
+            return fail(name);
+    }
+    return succ(name);
+}
+
+bool test_wt() {
+    std::string name = "wavelet tree";
+    const size_t SIGMA = 5;
+    DynamicWaveletTree<SIGMA, BLOCK_SIZE> wt;
+    std::vector<uint32_t> symbols;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % (symbols.size() + 1);
+        uint32_t symbol = rand() % SIGMA;
+        wt.insert(index, symbol);
+        symbols.insert(symbols.begin() + index, symbol);
+    }
+    for (int i = 0; i < 5000; i++) {
+        uint32_t index = rand() % symbols.size();
+        wt.del(index);
+        symbols.erase(symbols.begin() + index);
+    }
+    if (wt.size() != symbols.size())
+        return fail(name);
 
-    bool benchmark = true;
+    std::vector<uint32_t> counts(SIGMA, 0);
+    for (uint32_t i = 0; i < symbols.size(); i++) {
+        if (wt[i] != symbols[i])
+            return fail(name);
+        if (i % 7 == 0)
+            for (uint32_t c = 0; c < SIGMA; c++)
+                if (wt.rank(c, i) != counts[c])
+                    return fail(name);
+        counts[symbols[i]]++;
+        if (i % 5 == 0 && wt.select(symbols[i], counts[symbols[i]]) != i)
+            return fail(name);
+    }
+    return succ(name);
+}
+
+template <size_t K>
+bool check_pv(uint32_t n) {
+    PackedVector<K, BLOCK_SIZE> pv;
+    std::vector<uint64_t> values;
+    const uint64_t mask = K == 64 ? ~0ULL : (1ULL << K) - 1;
+    // keep the values small enough for 64 bit integers so that the sums do not overflow
+    const uint64_t bound = K == 64 ? 1ULL << 40 : mask;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t index = rand() % (values.size() + 1);
+        uint64_t value = ((uint64_t) rand() << 31 | rand()) % (bound + 1);
+        pv.insert(index, value);
+        values.insert(values.begin() + index, value);
+    }
+    for (uint32_t i = 0; i < n / 4; i++) {
+        uint32_t index = rand() % values.size();
+        pv.del(index);
+        values.erase(values.begin() + index);
+        index = rand() % values.size();
+        values[index] = ((uint64_t) rand() << 31 | rand()) % (bound + 1);
+        pv.set(index, values[index]);
+    }
+    if (!pv.validate() || pv.size() != values.size() || pv.extract() != values)
+        return false;
+    // the bulk constructor builds the same sequence in a balanced tree (without blocks on the inner nodes)
+    PackedVector<K, BLOCK_SIZE> built(values);
+    if (!built.validate() || built.extract() != values)
+        return false;
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < values.size(); i++) {
+        if (pv[i] != (values[i] & mask) || pv.sum(i) != sum)
+            return false;
+        // the first prefix sum that reaches x is the one of the next non zero value
+        if (values[i] > 0 && pv.search(sum + 1) != i)
+            return false;
+        sum += values[i];
+    }
+    return pv.sum(values.size()) == sum && pv.search(sum + 1) == (uint32_t) -1;
+}
+
+bool test_pv() {
+    std::string name = "packed vector";
+    if (!check_pv<5>(20000) || !check_pv<64>(5000) || !check_pv<1>(20000))
+        return fail(name);
+    std::vector<uint64_t> values(1000, 3);
+    PackedVector<7, BLOCK_SIZE> pv(values);
+    if (!pv.validate() || pv.sum(1000) != 3000 || pv.search(1500) != 499)
+        return fail(name);
+    return succ(name);
+}
 
-    if (benchmark) {
+bool test_pbv() {
+    std::string name = "paged bitvector";
+    // a budget of eight blocks forces most operations to evict and reload pages
+    PagedBitVector<BLOCK_SIZE> bv("/tmp", 8 * sizeof(std::bitset<BLOCK_SIZE>));
+    std::vector<bool> bits;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    for (int i = 0; i < 12000; i++) {
+        uint32_t index = rand() % bits.size();
+        bv.del(index);
+        bits.erase(bits.begin() + index);
+        index = rand() % bits.size();
+        bv.flip(index);
+        bits[index] = !bits[index];
+    }
+    if (!bv.validate() || bv.size() != bits.size() || bv.extract() != bits)
+        return fail(name);
 
-        std::vector<int> counts {};
-        for (int i = 10; i < 26; i++)
-            counts.push_back(1 << i);
+    BP_Stats stats = bv.statistics();
+    if (stats.writes == 0 || stats.reads == 0 || stats.prefetches == 0)
+        return fail(name);
 
-        for (auto count : counts) {
-            std::pair<long long, long long> p = benchmark_bv(count);
-            long long time = p.first;
-            long long size = p.second;
-            std::cout << "RESULT"
-                << " time=" << time
-                << " space=" << size
-                << std::endl;
+    // the queries below scan the leaves in order, so the pages of the following leaves are read ahead
+    uint64_t prefetches = bv.statistics().prefetches;
+    uint32_t ones = 0;
+    for (uint32_t i = 0; i < bits.size(); i++) {
+        // queries touch the block of a single leaf
+        uint64_t fetches = bv.statistics().fetches;
+        if (bv[i] != bits[i] || bv.rank(i, true) != ones || bv.rank(i, false) != i - ones)
+            return fail(name);
+        if (bv.statistics().fetches - fetches != 3)
+            return fail(name);
+        if (bits[i] && bv.select(++ones, true) != i)
+            return fail(name);
+        if (!bits[i] && bv.select(i + 1 - ones, false) != i)
+            return fail(name);
+    }
+
+    if (bv.statistics().prefetches == prefetches)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_mbv() {
+    std::string name = "multi column bitvector";
+    const size_t COLUMNS = 12;
+    MultiBitVector<COLUMNS, BLOCK_SIZE> mbv;
+    std::vector<std::vector<bool>> columns(COLUMNS);
+    for (int i = 0; i < 12000; i++) {
+        uint32_t index = rand() % (columns[0].size() + 1);
+        std::bitset<COLUMNS> row(rand());
+        mbv.insert(index, row);
+        for (uint32_t c = 0; c < COLUMNS; c++)
+            columns[c].insert(columns[c].begin() + index, row[c]);
+    }
+    for (int i = 0; i < 8000; i++) {
+        uint32_t index = rand() % columns[0].size();
+        mbv.del(index);
+        for (uint32_t c = 0; c < COLUMNS; c++)
+            columns[c].erase(columns[c].begin() + index);
+        index = rand() % columns[0].size();
+        uint32_t c = rand() % COLUMNS;
+        mbv.flip(c, index);
+        columns[c][index] = !columns[c][index];
+    }
+    if (!mbv.validate() || mbv.size() != columns[0].size())
+        return fail(name);
+
+    for (uint32_t c = 0; c < COLUMNS; c++) {
+        if (mbv.extract(c) != columns[c])
+            return fail(name);
+        uint32_t ones = 0;
+        for (uint32_t i = 0; i < columns[c].size(); i++) {
+            if (mbv.access(c, i) != columns[c][i] || mbv.row(i)[c] != columns[c][i] || mbv.rank(c, i, true) != ones)
+                return fail(name);
+            if (columns[c][i] && mbv.select(c, ++ones, true) != i)
+                return fail(name);
+            if (!columns[c][i] && mbv.select(c, i + 1 - ones, false) != i)
+                return fail(name);
+        }
+    }
+    return succ(name);
+}
+
+template <size_t S>
+bool check_rrr(uint32_t n, uint32_t percent) {
+    RRRBitVector<S> rrr;
+    std::vector<bool> bits;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = (uint32_t) (rand() % 100) < percent;
+        rrr.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t index = rand() % bits.size();
+        switch (rand() % 4) {
+            case 0:
+                rrr.del(index);
+                bits.erase(bits.begin() + index);
+                index = rand() % (bits.size() + 1);
+                rrr.insert(index, (uint32_t) (rand() % 100) < percent);
+                bits.insert(bits.begin() + index, rrr[index]);
+                break;
+            case 1:
+                rrr.flip(index);
+                bits[index] = !bits[index];
+                break;
+            case 2:
+                rrr.set(index);
+                bits[index] = true;
+                break;
+            default:
+                rrr.unset(index);
+                bits[index] = false;
+        }
+    }
+    for (uint32_t i = 0; i < n / 2; i++) {
+        uint32_t index = rand() % bits.size();
+        rrr.del(index);
+        bits.erase(bits.begin() + index);
+    }
+    if (!rrr.validate() || rrr.size() != bits.size() || rrr.extract() != bits)
+        return false;
+
+    uint32_t ones = 0;
+    for (uint32_t i = 0; i < bits.size(); i++) {
+        if (rrr.access(i) != bits[i] || rrr.rank(i, true) != ones || rrr.rank(i, false) != i - ones)
+            return false;
+        if (bits[i] && rrr.select(++ones, true) != i)
+            return false;
+        if (!bits[i] && rrr.select(i + 1 - ones, false) != i)
+            return false;
+    }
+    return true;
+}
+
+bool test_rrr() {
+    std::string name = "rrr bitvector";
+    if (!check_rrr<BLOCK_SIZE>(20000, 10) || !check_rrr<4096>(40000, 5) || !check_rrr<4096>(20000, 50))
+        return fail(name);
+
+    // the payload stays close to the zero order entropy for sparse random bits
+    // (10% density: H0 = 0.469 bits per bit, the classes add 0.109 bits per bit)
+    std::vector<bool> bits;
+    for (int i = 0; i < 200000; i++)
+        bits.push_back(rand() % 10 == 0);
+    RRRBitVector<> rrr(bits);
+    if (!rrr.validate() || rrr.extract() != bits || rrr.payload_bits() > 0.65 * bits.size())
+        return fail(name);
+    return succ(name);
+}
+
+bool test_rbv() {
+    std::string name = "runtime bitvector";
+    for (auto block_size : RuntimeBitVector::BLOCK_SIZES) {
+        RuntimeBitVector rbv(block_size);
+        std::vector<bool> bits;
+        for (int i = 0; i < 20000; i++) {
+            uint32_t index = rand() % (bits.size() + 1);
+            bool value = rand() % 2;
+            rbv.insert(index, value);
+            bits.insert(bits.begin() + index, value);
+        }
+        for (int i = 0; i < 5000; i++) {
+            uint32_t index = rand() % bits.size();
+            if (i % 2) {
+                rbv.del(index);
+                bits.erase(bits.begin() + index);
+            } else {
+                rbv.flip(index);
+                bits[index] = !bits[index];
+            }
+        }
+        if (rbv.block_size() != block_size || !rbv.validate() || rbv.size() != bits.size() || rbv.extract() != bits)
+            return fail(name);
+        uint32_t ones = 0;
+        for (uint32_t i = 0; i < bits.size(); i++) {
+            if (rbv[i] != bits[i] || rbv.rank(i, true) != ones)
+                return fail(name);
+            if (bits[i] && rbv.select(++ones, true) != i)
+                return fail(name);
         }
+    }
+    if (RuntimeBitVector::supported(100) || RuntimeBitVector(100).block_size() != 512)
+        return fail(name);
+
+    // replaying the sample trace on the bits it was generated for only performs valid operations
+    std::vector<bool> bits;
+    for (int i = 0; i < 20000; i++)
+        bits.push_back(rand() % 2);
+    std::vector<BV_Op> trace = RuntimeBitVector::sample_trace(bits, 20000, 50);
+    std::vector<bool> expected = bits;
+    for (auto &op : trace) {
+        if (op.kind == BV_OpKind::insert)
+            expected.insert(expected.begin() + op.index, op.value);
+        else if (op.kind == BV_OpKind::del)
+            expected.erase(expected.begin() + op.index);
+        else if (op.kind == BV_OpKind::flip)
+            expected[op.index] = !expected[op.index];
+        else if (op.kind == BV_OpKind::select && op.index > (uint32_t) std::count(expected.begin(), expected.end(), op.value))
+            return fail(name);
+    }
+    RuntimeBitVector replayed(bits, 64);
+    if (replayed.replay(trace) <= 0 || replayed.extract() != expected)
+        return fail(name);
+
+    // the memory per bit does not depend on the timing, so the memory side of the calibration is deterministic
+    std::vector<BV_Calibration> results = RuntimeBitVector::measure(bits, trace, 1);
+    if (results.size() != std::size(RuntimeBitVector::BLOCK_SIZES))
+        return fail(name);
+    uint32_t smallest = std::min_element(results.begin(), results.end(),
+                                         [](auto &a, auto &b) { return a.bytes_per_bit < b.bytes_per_bit; })->block_size;
+    if (RuntimeBitVector::calibrate_latency(bits, trace, 1e12) != smallest || RuntimeBitVector::calibrate_memory(bits, trace, 0) != smallest)
+        return fail(name);
+    if (!RuntimeBitVector::supported(RuntimeBitVector::calibrate_latency(bits, trace, 0)))
+        return fail(name);
+    return succ(name);
+}
+
+// apply a random update to the journaled bitvector and the expected bits
+template <size_t S>
+void random_journal_update(JournaledBitVector<S> &jbv, std::vector<bool> &bits) {
+    uint32_t kind = rand() % 8;
+    if (bits.empty() || kind < 3) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        jbv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+        return;
+    }
+    uint32_t index = rand() % bits.size();
+    if (kind == 3) {
+        jbv.del(index);
+        bits.erase(bits.begin() + index);
+    } else if (kind == 4) {
+        jbv.flip(index);
+        bits[index] = !bits[index];
+    } else if (kind == 5) {
+        jbv.set(index);
+        bits[index] = true;
+    } else if (kind == 6) {
+        jbv.unset(index);
+        bits[index] = false;
+    } else if (rand() % 100 == 0) {
+        jbv.complement();
+        bits.flip();
     } else {
+        jbv.flip(index);
+        bits[index] = !bits[index];
+    }
+}
 
-        bool test_result = true;
+bool test_jbv() {
+    std::string name = "journaled bitvector";
+    std::string dir = "/tmp/journal.XXXXXX";
+    if (!mkdtemp(dir.data()))
+        return fail(name);
+    std::vector<bool> bits;
 
-        std::cout << "================================" << std::endl << std::endl;;
+    // the open group is committed on destruction, the recovery replays the journal
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::none, 0);
+        for (int i = 0; i < 20000; i++)
+            random_journal_update(jbv, bits);
+        jbv.insert(jbv.size() + 1, true);
+        BV_JournalStats stats = jbv.statistics();
+        if (!jbv.validate() || jbv.extract() != bits || stats.groups != stats.ops / 64 || stats.syncs != 0)
+            return fail(name);
+    }
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::group, 0);
+        if (!jbv.validate() || jbv.extract() != bits || jbv.statistics().replayed != 20000)
+            return fail(name);
+        for (int i = 0; i < 100; i++)
+            random_journal_update(jbv, bits);
+        jbv.commit();
+        if (jbv.statistics().syncs != 2)
+            return fail(name);
+    }
 
-        #ifdef ADS_DEBUG
-        test_result &= test_bv_insert();
-        test_result &= test_bv_select();
-        test_result &= test_bv_rank();
-        test_result &= test_bv_extact();
-        test_result &= test_bv_set();
-        test_result &= test_bv_unset();
-        test_result &= test_bv_flip();
-        test_result &= test_bv_insdel();
-        test_result &= test_bv_rdm_insdel();
-        test_result &= test_bv_big_insdel();
+    // a frame that is cut off is discarded and the journal continues behind the last complete frame
+    std::vector<bool> committed = bits;
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 1000, BV_Sync::none, 0);
+        for (int i = 0; i < 100; i++)
+            random_journal_update(jbv, bits);
+    }
+    std::filesystem::resize_file(dir + "/journal.0", std::filesystem::file_size(dir + "/journal.0") - 3);
+    bits = committed;
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 1000, BV_Sync::none, 0);
+        if (!jbv.validate() || jbv.extract() != bits)
+            return fail(name);
+        for (int i = 0; i < 100; i++)
+            random_journal_update(jbv, bits);
+    }
 
-        #endif
+    // a checkpoint writes the snapshot and removes the journal of the previous generation
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::always, 0);
+        if (jbv.extract() != bits)
+            return fail(name);
+        jbv.checkpoint();
+        for (int i = 0; i < 100; i++)
+            random_journal_update(jbv, bits);
+        jbv.wait_checkpoint();
+        BV_JournalStats stats = jbv.statistics();
+        if (stats.checkpoints != 1 || stats.syncs != stats.ops || stats.groups != stats.ops
+            || std::filesystem::exists(dir + "/journal.0") || !std::filesystem::exists(dir + "/snapshot"))
+            return fail(name);
+    }
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::none, 0);
+        if (!jbv.validate() || jbv.extract() != bits || jbv.statistics().replayed != 100)
+            return fail(name);
+    }
+
+    // the checkpoints in the background keep the journal and the written bytes bounded
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::none, 1024);
+        for (int i = 0; i < 50000; i++)
+            random_journal_update(jbv, bits);
+        jbv.wait_checkpoint();
+        BV_JournalStats stats = jbv.statistics();
+        if (stats.checkpoints < 2 || stats.write_amplification() > 2.5)
+            return fail(name);
+    }
+    {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::none, 0);
+        if (!jbv.validate() || jbv.extract() != bits || jbv.statistics().replayed >= 50000)
+            return fail(name);
+        uint32_t ones = 0;
+        for (uint32_t i = 0; i < bits.size(); i++) {
+            if (jbv[i] != bits[i] || jbv.rank(i, true) != ones)
+                return fail(name);
+            if (bits[i] && jbv.select(++ones, true) != i)
+                return fail(name);
+        }
+    }
+
+    // a snapshot whose header claims more bits than the file holds is rejected before anything is allocated
+    {
+        std::fstream snapshot(dir + "/snapshot", std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t claimed = 1ull << 40;
+        snapshot.seekp(16);
+        snapshot.write((const char *) &claimed, sizeof(claimed));
+    }
+    bool thrown = false;
+    try {
+        JournaledBitVector<BLOCK_SIZE> jbv(dir, 64, BV_Sync::none, 0);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    if (!thrown)
+        return fail(name);
+    std::filesystem::remove_all(dir);
+    return succ(name);
+}
+
+bool test_numa() {
+    std::string name = "numa placement";
+    if (numa_parse_list("0-3,8,10-11\n") != std::vector<uint32_t>{0, 1, 2, 3, 8, 10, 11})
+        return fail(name);
+    NumaTopology real = NumaTopology::detect();
+    NumaTopology topology = NumaTopology::simulate(4);
+    if (real.nodes < 1 || !(real.present & 1) || topology.nodes != 4 || topology.cpu_node.size() != real.cpu_node.size())
+        return fail(name);
+    for (uint32_t cpu = 1; cpu < topology.cpu_node.size(); cpu++)
+        if (topology.cpu_node[cpu] < topology.cpu_node[cpu - 1] || topology.cpu_node[cpu] >= 4)
+            return fail(name);
+    numa_set_home(6);
+    uint32_t home = topology.current_node();
+    numa_set_home(-1);
+    if (home != 2 || topology.current_node() >= 4)
+        return fail(name);
+
+    // the kernel applies the policy to the pages of node 0 (every machine has it)
+    #ifdef __linux__
+    void *page = ::operator new(NUMA_PAGE, std::align_val_t(NUMA_PAGE));
+    numa_place(page, NUMA_PAGE, real.bind(0));
+    bool bound = numa_policy_of(page) == NumaPolicy::bind;
+    ::operator delete(page, std::align_val_t(NUMA_PAGE));
+    if (!bound)
+        return fail(name);
+    #endif
+
+    // a placed bitvector keeps its placement through updates, relayouts and clones
+    std::vector<bool> bits;
+    BitVector<BLOCK_SIZE> bv;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        bv.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    bv.place(topology.interleave());
+    for (int i = 0; i < 5000; i++) {
+        uint32_t index = rand() % bits.size();
+        bv.del(index);
+        bits.erase(bits.begin() + index);
+    }
+    bv.relayout();
+    BitVector<BLOCK_SIZE> copy = bv.clone();
+    if (bv.placement().policy != NumaPolicy::interleave || copy.placement().policy != NumaPolicy::interleave)
+        return fail(name);
+    if (!bv.validate() || !copy.validate() || bv.extract() != bits || copy.extract() != bits)
+        return fail(name);
+    bv.place(topology.bind(3));
+    if (bv.placement().policy != NumaPolicy::bind || bv.placement().node != 3 || !bv.validate() || bv.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_replicas() {
+    std::string name = "read replicas";
+    NumaTopology topology = NumaTopology::simulate(4);
+    std::vector<bool> bits;
+    for (int i = 0; i < 20000; i++)
+        bits.push_back(rand() % 2);
+    ReplicatedBitVector<BLOCK_SIZE> rbv(bits, topology);
+    if (rbv.replicated() || rbv.route() != -1)
+        return fail(name);
+
+    // every thread reads the replica of its node
+    rbv.replicate(true);
+    if (!rbv.replicated() || !rbv.validate() || rbv.memory_usage().total_bytes < 4 * BitVector<BLOCK_SIZE>(bits).memory_usage().total_bytes)
+        return fail(name);
+    for (uint32_t node = 0; node < 4; node++)
+        if (rbv.replica(node).placement().policy != NumaPolicy::bind || rbv.replica(node).placement().node != node)
+            return fail(name);
+    std::vector<uint32_t> ones(bits.size() + 1, 0);
+    for (uint32_t i = 0; i < bits.size(); i++)
+        ones[i + 1] = ones[i] + bits[i];
+    std::vector<int32_t> routes(8, -2);
+    std::vector<bool> correct(8, true);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 8; t++) {
+        threads.emplace_back([&, t]() {
+            numa_set_home(t % 4);
+            routes[t] = rbv.route();
+            for (int i = 0; i < 2000; i++) {
+                uint32_t index = (t * 7919 + i * 104729) % bits.size();
+                if (rbv.rank(index, true) != ones[index] || rbv[index] != bits[index])
+                    correct[t] = false;
+                if (bits[index] && rbv.select(ones[index] + 1, true) != index)
+                    correct[t] = false;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (uint32_t t = 0; t < 8; t++)
+        if (routes[t] != (int32_t) (t % 4) || !correct[t])
+            return fail(name);
+
+    // single updates send the queries to the primary tree until the next refresh, batches refresh by themselves
+    rbv.insert(0, true);
+    rbv.flip(1);
+    bits.insert(bits.begin(), true);
+    bits[1] = !bits[1];
+    if (rbv.replicated() || rbv.route() != -1 || rbv[0] != true || rbv[1] != bits[1] || !rbv.validate())
+        return fail(name);
+    rbv.refresh();
+    if (!rbv.replicated() || !rbv.validate() || rbv.replica(2).extract() != bits)
+        return fail(name);
+    rbv.apply({{0, false, false}, {5, true, true}});
+    bits.erase(bits.begin());
+    bits.insert(bits.begin() + 5, true);
+    if (!rbv.replicated() || !rbv.validate() || rbv.replica(3).extract() != bits || rbv.extract() != bits)
+        return fail(name);
+    for (uint32_t i = 0; i < bits.size(); i++)
+        if (rbv[i] != bits[i])
+            return fail(name);
+
+    rbv.replicate(false);
+    if (rbv.replicated() || rbv.route() != -1 || !rbv.validate() || rbv.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_bp() {
+    std::string name = "bv balanced parentheses";
+    std::vector<bool> bits;
+    int32_t open = 0;
+    for (int i = 0; i < 20000; i++) {
+        bool up = open == 0 || (open < 200 && rand() % 2);
+        bits.push_back(up);
+        open += up ? 1 : -1;
+    }
+    while (open-- > 0)
+        bits.push_back(false);
+
+    BitVector<BLOCK_SIZE, BV_EXCESS> bv(bits);
+    // dynamic updates: insert new leaves "()" and remove matching pairs
+    for (int i = 0; i < 3000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bv.insert(index, false);
+        bv.insert(index, true);
+        bits.insert(bits.begin() + index, {true, false});
+        index = rand() % bits.size();
+        if (bits[index]) {
+            uint32_t close = bv.find_close(index);
+            bv.del(close);
+            bv.del(index);
+            bits.erase(bits.begin() + close);
+            bits.erase(bits.begin() + index);
+        }
+    }
+    if (bv.extract() != bits)
+        return fail(name);
+
+    std::vector<int32_t> excess;
+    int32_t e = 0;
+    for (bool bit : bits)
+        excess.push_back(e += bit ? 1 : -1);
+    int32_t n = bits.size();
+
+    for (int32_t i = 0; i < n; i += 1 + rand() % 5) {
+        if (bv.excess(i) != excess[i])
+            return fail(name);
+        int32_t diff = rand() % 7 - 3;
+        int32_t fwd = i + 1, bwd = i - 1;
+        while (fwd < n && excess[fwd] != excess[i] + diff)
+            fwd++;
+        while (bwd >= 0 && excess[bwd] != excess[i] + diff)
+            bwd--;
+        if (bv.fwd_search(i, diff) != (fwd == n ? (uint32_t) -1 : fwd))
+            return fail(name);
+        if (bwd >= 0 && bv.bwd_search(i, diff) != (uint32_t) bwd)
+            return fail(name);
+
+        // match the parenthesis and find the enclosing pair with a stack free scan
+        if (bits[i]) {
+            int32_t close = i + 1, depth = 1;
+            while ((depth += bits[close] ? 1 : -1) != 0)
+                close++;
+            int32_t parent = i - 1;
+            for (depth = 0; parent >= 0 && (depth += bits[parent] ? -1 : 1) >= 0; parent--);
+            if (bv.find_close(i) != (uint32_t) close || bv.find_open(close) != (uint32_t) i)
+                return fail(name);
+            if (bv.enclose(i) != (parent < 0 ? (uint32_t) -1 : parent))
+                return fail(name);
+        }
+
+        int32_t j = std::min(n - 1, i + rand() % 3000);
+        if (bv.min_excess(i, j) != *std::min_element(excess.begin() + i, excess.begin() + j + 1))
+            return fail(name);
+    }
+    return succ(name);
+}
+
+bool test_bv_runs() {
+    std::string name = "bv free runs";
+    // first run of k bits with value starting at or behind from (brute force reference)
+    auto first_run = [](std::vector<bool> &bits, uint32_t from, uint32_t k, bool value) {
+        for (uint32_t i = from, len = 0; i < bits.size(); i++) {
+            len = bits[i] == value ? len + 1 : 0;
+            if (len == k)
+                return i + 1 - k;
+        }
+        return (uint32_t) -1;
+    };
+
+    // runs of random length so that long runs of both values exist
+    std::vector<bool> bits;
+    while (bits.size() < 30000)
+        bits.insert(bits.end(), 1 + rand() % (rand() % 8 ? 40 : 700), rand() % 2);
+    BitVector<BLOCK_SIZE, BV_RUNS> bv(bits);
+
+    for (int i = 0; i < 1500; i++) {
+        // allocate, free and resize the bitmap
+        uint32_t k = 1 + rand() % 300;
+        uint32_t start = bv.claim_run(k);
+        if (start != first_run(bits, 0, k, false))
+            return fail(name);
+        if (start != (uint32_t) -1)
+            std::fill(bits.begin() + start, bits.begin() + start + k, true);
+        uint32_t index = rand() % bits.size();
+        for (uint32_t j = index; j < std::min((uint32_t) bits.size(), index + rand() % 200); j++) {
+            bv.unset(j);
+            bits[j] = false;
+        }
+        index = rand() % (bits.size() + 1);
+        bv.insert(index, rand() % 2);
+        bits.insert(bits.begin() + index, bv[index]);
+        index = rand() % bits.size();
+        bv.del(index);
+        bits.erase(bits.begin() + index);
+
+        bool value = rand() % 2;
+        k = 1 + rand() % (rand() % 4 ? 64 : 1000);
+        if (bv.find_first_run(k, value) != first_run(bits, 0, k, value))
+            return fail(name);
+
+        // length of the run of value that starts at every position
+        std::vector<uint32_t> runs(bits.size() + 1, 0);
+        for (uint32_t j = bits.size(); j-- > 0;)
+            runs[j] = bits[j] == value ? runs[j + 1] + 1 : 0;
+        index = rand() % bits.size();
+        uint32_t after = -1, before = -1;
+        for (uint32_t j = index; j < bits.size() && after == (uint32_t) -1; j++)
+            after = runs[j] >= k ? j : -1;
+        for (uint32_t j = index + 1; j-- > 0 && before == (uint32_t) -1;)
+            before = runs[j] >= k ? j : -1;
+        uint32_t near = before == (uint32_t) -1 ? after :
+                        after == (uint32_t) -1 ? before : (after - index <= index - before ? after : before);
+        if (bv.find_run_near(index, k, value) != near)
+            return fail(name);
+    }
+    if (bv.extract() != bits || !bv.validate())
+        return fail(name);
+    return succ(name);
+}
+
+bool test_bv_hash() {
+    std::string name = "bv hash and diff";
+    // differing ranges of two bit sequences (brute force reference)
+    auto ranges = [](std::vector<bool> &a, std::vector<bool> &b) {
+        std::vector<std::pair<uint32_t, uint32_t>> result;
+        for (uint32_t i = 0; i < std::max(a.size(), b.size()); i++) {
+            if (i < a.size() && i < b.size() && a[i] == b[i])
+                continue;
+            if (!result.empty() && result.back().second == i)
+                result.back().second++;
+            else
+                result.push_back({i, i + 1});
+        }
+        return result;
+    };
+
+    // the same bits in two differently shaped trees
+    std::vector<bool> bits;
+    BitVector<BLOCK_SIZE, BV_HASH> a;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t index = rand() % (bits.size() + 1);
+        bool value = rand() % 2;
+        a.insert(index, value);
+        bits.insert(bits.begin() + index, value);
+    }
+    BitVector<BLOCK_SIZE, BV_HASH> b(bits);
+    std::vector<bool> other = bits;
+    if (!a.equals(b) || !b.equals(a) || a.hash() != b.hash() || !a.diff(b).empty())
+        return fail(name);
+
+    for (int i = 0; i < 300; i++) {
+        // a few local changes to one replica
+        for (int j = rand() % 4; j > 0; j--) {
+            uint32_t index = rand() % other.size();
+            switch (rand() % 3) {
+                case 0:
+                    b.flip(index);
+                    other[index] = !other[index];
+                    break;
+                case 1:
+                    b.insert(index, rand() % 2);
+                    other.insert(other.begin() + index, b[index]);
+                    break;
+                default:
+                    b.del(index);
+                    other.erase(other.begin() + index);
+            }
+        }
+        if (a.equals(b) != (bits == other) || a.diff(b) != ranges(bits, other) || b.diff(a) != ranges(other, bits))
+            return fail(name);
+
+        // bring the replicas back in sync now and then
+        if (rand() % 10 == 0) {
+            b = a.clone();
+            other = bits;
+            if (!a.equals(b))
+                return fail(name);
+        }
+    }
+    return succ(name);
+}
+
+bool test_bv_apply() {
+    std::string name = "bv apply";
+    BitVector<BLOCK_SIZE> bv;
+    std::vector<bool> bits;
+    for (int round = 0; round < 200; round++) {
+        // a batch sorted by index; every index refers to the bits with the previous updates of the batch applied
+        std::vector<BV_Update> batch;
+        uint32_t index = 0;
+        for (int i = 0; i < 500; i++) {
+            index += rand() % (bits.size() / 200 + 2);
+            if (index > bits.size())
+                break;
+            if (index < bits.size() && rand() % 10 < 4) {
+                batch.push_back({index, false, false});
+                bits.erase(bits.begin() + index);
+            } else {
+                bool value = rand() % 2;
+                batch.push_back({index, true, value});
+                bits.insert(bits.begin() + index, value);
+            }
+        }
+        bv.apply(batch);
+        if (!bv.validate() || bv.size() != bits.size())
+            return fail(name);
+    }
+    if (bv.extract() != bits)
+        return fail(name);
+    return succ(name);
+}
 
-        std::cout << std::endl << "================================" << std::endl;
-        if (test_result)
-            std::cout << "  All tests passed" << std::endl;
-        else
-            std::cout << "  At least one test failed" << std::endl;
+bool test_bbv() {
+    std::string name = "buffered bitvector";
+    // a capacity of 1 merges on every update, 300 leaves partially filled chunks
+    for (uint32_t capacity : {1u, 64u, 300u, 4096u}) {
+        std::vector<bool> bits(1000);
+        for (uint32_t i = 0; i < bits.size(); i++)
+            bits[i] = rand() % 2;
+        BufferedBitVector<BLOCK_SIZE> bbv(bits, capacity);
+        for (int i = 0; i < 20000; i++) {
+            uint32_t op = rand() % 10;
+            if (op < 5 || bits.empty()) {
+                uint32_t index = rand() % (bits.size() + 1);
+                bool value = rand() % 2;
+                bbv.insert(index, value);
+                bits.insert(bits.begin() + index, value);
+            } else if (op < 8) {
+                uint32_t index = rand() % bits.size();
+                bbv.del(index);
+                bits.erase(bits.begin() + index);
+            } else {
+                uint32_t index = rand() % bits.size();
+                bbv.flip(index);
+                bits[index] = !bits[index];
+            }
 
-        return test_result ? 0 : 1;
+            // the queries correct the results of the tree with the buffered updates in front
+            if (i % 50 == 0) {
+                uint32_t index = rand() % (bits.size() + 1);
+                uint32_t ones = std::count(bits.begin(), bits.begin() + index, true);
+                if (bbv.size() != bits.size() || bbv.rank(index, true) != ones || bbv.rank(index, false) != index - ones)
+                    return fail(name);
+                if (index < bits.size()) {
+                    bool value = bits[index];
+                    if (bbv[index] != value || bbv.select(value ? ones + 1 : index - ones + 1, value) != index)
+                        return fail(name);
+                }
+                if (!bbv.validate())
+                    return fail(name);
+            }
+        }
+        if (bbv.extract() != bits || bbv.buffered() != 0 || !bbv.validate())
+            return fail(name);
     }
+    return succ(name);
 }
+#endif
+
+int main(int argc, char *argv[]) {
+
+    bool test_result = true;
 
+    std::cout << "================================" << std::endl << std::endl;;
 
+    #ifdef ADS_DEBUG
+    test_result &= test_bv_insert();
+    test_result &= test_bv_select();
+    test_result &= test_bv_rank();
+    test_result &= test_bv_extact();
+    test_result &= test_bv_set();
+    test_result &= test_bv_unset();
+    test_result &= test_bv_flip();
+    test_result &= test_bv_insdel();
+    test_result &= test_bv_rdm_insdel();
+    test_result &= test_bv_big_insdel();
+    test_result &= test_bv_shift();
+    test_result &= test_bv_memory();
+    test_result &= test_bv_compact();
+    test_result &= test_bv_clone();
+    test_result &= test_bv_relayout();
+    test_result &= test_bv_adapt();
+    test_result &= test_bv_rebalance();
+    test_result &= test_bv_cursor();
+    test_result &= test_bv_bitwise();
+    test_result &= test_bv_scan();
+    test_result &= test_bv_bp();
+    test_result &= test_bv_runs();
+    test_result &= test_bv_hash();
+    test_result &= test_bv_apply();
+    test_result &= test_bbv();
+    test_result &= test_wt();
+    test_result &= test_pv();
+    test_result &= test_pbv();
+    test_result &= test_mbv();
+    test_result &= test_rrr();
+    test_result &= test_rbv();
+    test_result &= test_jbv();
+    test_result &= test_numa();
+    test_result &= test_replicas();
+
+    #endif
+
+    std::cout << std::endl << "================================" << std::endl;
+    if (test_result)
+        std::cout << "  All tests passed" << std::endl;
+    else
+        std::cout << "  At least one test failed" << std::endl;
+
+    return test_result ? 0 : 1;
+}
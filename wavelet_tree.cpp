@@ -0,0 +1,125 @@
+#ifndef WAVELETTREE_IMPL
+#define WAVELETTREE_IMPL
+
+#include "bit_vector.cpp"
+#include "wavelet_tree.hpp"
+
+template <size_t A, size_t S>
+DynamicWaveletTree<A, S>::DynamicWaveletTree() {
+    zeros.fill(0);
+}
+
+// inserts the symbol at the given index
+// each level needs a single descent that inserts the bit and computes the position on the next level
+template <size_t A, size_t S>
+void DynamicWaveletTree<A, S>::insert(uint32_t index, uint32_t symbol) {
+    if (symbol >= A || index > size()) {
+        std::cout << "Invalid symbol or index for insert operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        bool bit = symbol_bit(symbol, level);
+        uint32_t rank = levels[level].insert_rank(index, bit);
+        if (!bit)
+            zeros[level]++;
+        index = map(level, rank, bit);
+    }
+}
+
+// remove the symbol at the given index
+template <size_t A, size_t S>
+void DynamicWaveletTree<A, S>::del(uint32_t index) {
+    if (index >= size()) {
+        std::cout << "Invalid index for delete operation (skipping operation)" << std::endl;
+        return;
+    }
+
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        uint32_t rank;
+        bool bit = levels[level].del_rank(index, &rank);
+        if (!bit)
+            zeros[level]--;
+        index = map(level, rank, bit);
+    }
+}
+
+// return the symbol at the given index
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::access(uint32_t index) {
+    uint32_t symbol = 0;
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        uint32_t rank;
+        bool bit = levels[level].access_rank(index, &rank);
+        symbol = (symbol << 1) | bit;
+        index = map(level, rank, bit);
+    }
+    return symbol;
+}
+
+// calculate the number of occurrences of symbol in the sequence up to index
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::rank(uint32_t symbol, uint32_t index) {
+    if (symbol >= A)
+        return 0;
+
+    // [start, index) is the range of the symbols that share the prefix of symbol up to the current level
+    // (both ends are mapped to the next level with a single descent)
+    uint32_t start = 0;
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        bool bit = symbol_bit(symbol, level);
+        uint32_t start_rank;
+        uint32_t index_rank = levels[level].rank_pair(start, index, bit, &start_rank);
+        start = map(level, start_rank, bit);
+        index = map(level, index_rank, bit);
+    }
+    return index - start;
+}
+
+// calculate the index of the num'th occurrence of symbol in the sequence
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::select(uint32_t symbol, uint32_t num) {
+    if (symbol >= A || num == 0 || rank(symbol, size()) < num) {
+        std::cout << "Invalid num for select operation (returning invalid value)" << std::endl;
+        return -1;
+    }
+
+    // locate the start of the symbol on the last level, afterwards follow the occurrence back to the first level
+    uint32_t start = 0;
+    for (uint32_t level = 0; level < LEVELS; level++) {
+        bool bit = symbol_bit(symbol, level);
+        start = map(level, levels[level].rank(start, bit), bit);
+    }
+
+    uint32_t index = start + num - 1;
+    for (uint32_t level = LEVELS; level-- > 0;) {
+        bool bit = symbol_bit(symbol, level);
+        uint32_t offset = bit ? zeros[level] : 0;
+        index = levels[level].select(index - offset + 1, bit);
+    }
+    return index;
+}
+
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::size() {
+    return levels[0].size();
+}
+
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::operator[](uint32_t index) {
+    return access(index);
+}
+
+// return the bit of symbol that is stored on the given level
+template <size_t A, size_t S>
+bool DynamicWaveletTree<A, S>::symbol_bit(uint32_t symbol, uint32_t level) {
+    return (symbol >> (LEVELS - level - 1)) & 1;
+}
+
+// position on the next level of the element with the given rank (among the elements with the same bit) on level
+template <size_t A, size_t S>
+uint32_t DynamicWaveletTree<A, S>::map(uint32_t level, uint32_t rank, bool bit) {
+    return bit ? zeros[level] + rank : rank;
+}
+
+#endif
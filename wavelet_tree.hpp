@@ -0,0 +1,36 @@
+#ifndef WAVELETTREE
+#define WAVELETTREE
+
+#include "bit_vector.hpp"
+
+#include <array>
+
+// represents a dynamic sequence of symbols from the alphabet [0, A) that allows for inserts and deletes everywhere
+//  as well as access, rank and select queries on symbols
+// the symbols are stored as a wavelet matrix: one bitvector per bit of the symbols (most significant bit first)
+//  where each level is stably partitioned by the bit of the previous level (zeros before ones)
+template <size_t A, size_t S = 512>
+class DynamicWaveletTree {
+    private:
+        static const uint32_t LEVELS = A > 1 ? std::bit_width(A - 1) : 1;
+
+        std::array<BitVector<S>, LEVELS> levels;
+        std::array<uint32_t, LEVELS> zeros;      // number of zeros per level
+
+        bool symbol_bit(uint32_t, uint32_t);
+        uint32_t map(uint32_t, uint32_t, bool);
+
+    public:
+        void insert(uint32_t, uint32_t);
+        void del(uint32_t);
+        uint32_t access(uint32_t);
+        uint32_t rank(uint32_t, uint32_t);
+        uint32_t select(uint32_t, uint32_t);
+        uint32_t size();
+
+        uint32_t operator[](uint32_t);
+
+        DynamicWaveletTree();
+};
+
+#endif